@@ -14,45 +14,10 @@ struct Material
     float shininess;
 }; 
 
-// DIRECTIONAL LIGHT
-
-struct DirLight
-{
-    vec3 direction;
-
-    float ambient;
-    float diffuse;
-    float specular;
-};
-
-// POINT LIGHT
-
-struct PointLight 
-{    
-    vec3 position;
-    
-    // Attenuation constants
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-
-#define NR_POINT_LIGHTS 4  
-
-uniform vec3 viewPos;
 uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-
-// FUNCTIONS
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
+#include "frame_block.glsl"
+#include "lighting.glsl"
 
 void main()
 {
@@ -60,64 +25,23 @@ void main()
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
 
+    vec3 result = vec3(0.0);
+
     // phase 1: Directional lighting
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
+#if USE_DIR_LIGHT
+    result += CalcDirLight(dirLight, norm, viewDir);
+#endif
     
     // phase 2: Point lights
+#if NR_POINT_LIGHTS > 0
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
         result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);    
+#endif
     
-        // phase 3: Spot light
-    //result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
+    // phase 3: Spot light
+#if USE_SPOT_LIGHT
+    result += CalcSpotLight(spotLight, norm, FragPos, viewDir);    
+#endif
     
     FragColor = vec4(result, 1.0);
 }
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    // Minus sign because the direction should be from the fragment to the light source
-    vec3 lightDir = normalize(-light.direction);
-    
-    // Diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    
-    // Specular shading
-    // reflect(incident vec, normal vec) calculates the reflection direction for an incident vector
-    // Why minus sign ? Surely because we want the actual dir of the light rays, from source to frag
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    
-    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    
-    return (ambient + diffuse + specular);
-}
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    
-    // specular shading
-    // Why minus sign ? Surely because we want the actual dir of the light rays, from source to frag
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    
-    // attenuation
-    float distance    = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    
-    // combine results
-    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-
-    ambient  *= attenuation;
-    diffuse  *= attenuation;
-    specular *= attenuation;
-
-    return (ambient + diffuse + specular);
-} 
\ No newline at end of file
@@ -1,16 +1,31 @@
 #version 330 core
 
+// 1: compact vertices (half-float positions, octahedral normals, see PackedVertex.h)
+#ifndef PACKED_VERTEX
+#define PACKED_VERTEX 0
+#endif
+
 layout (location = 0) in vec3 aPos;
+#if PACKED_VERTEX
+// Octahedral normal in xy
+layout (location = 1) in vec4 aNormal;
+#else
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
+// Per-instance attributes (attribute divisor 1), see InstanceBuffer
+layout (location = 5) in mat4 aModel;
+layout (location = 9) in mat3 aNormalMatrix;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frame_block.glsl"
+
+#if PACKED_VERTEX
+#include "packed_vertex.glsl"
+#endif
 
 void main()
 {
@@ -19,19 +34,23 @@ void main()
 	// be used as the output of the vertex shader.
 	// gl_position = the clip-space position of the current vertex 
 	// clip space = normalized device coordinates (NDC), between -1 and 1
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
 
 	// Normal vector expressed in world coordinates using 
 	// a normal matrix, which is derived from the model matrix.
 	// Not multiplied directly by the model matrix, otherwise
 	// in case of non-uniform scaling for instance, normals 
 	// would not be perpendicular to the faces of the cube anymore.
-	// Performance issue: inverting a matrix is costly, so it 
-	// should normally be done on the CPU and then sent to the shader via a uniform
-	Normal = mat3(transpose(inverse(view * model))) * aNormal;
+	// Inverting a matrix is costly, so it is done once per instance
+	// on the CPU and read here as a per-instance attribute
+#if PACKED_VERTEX
+	Normal = aNormalMatrix * octDecode(aNormal.xy);
+#else
+	Normal = aNormalMatrix * aNormal;
+#endif
 	
 	// Fragment position expressed in world coordinates
-	FragPos = vec3(model * vec4(aPos, 1.0));
+	FragPos = vec3(aModel * vec4(aPos, 1.0));
 
 	// Texture coords
 	TexCoords = aTexCoords;
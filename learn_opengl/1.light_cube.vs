@@ -1,12 +1,12 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPos;
+// Per-instance model matrix (attribute divisor 1), see InstanceBuffer
+layout (location = 5) in mat4 aModel;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frame_block.glsl"
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProjection * aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,13 @@
+// PER-FRAME CONSTANTS
+// Included by every stage that needs the camera (see ShaderPreprocessor).
+// Stored in a uniform buffer (std140 layout), mirrored on the CPU by the FrameBlock class,
+// and only re-uploaded when the camera changed.
+
+layout (std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    // projection * view, computed once per camera change instead of once per vertex
+    mat4 viewProjection;
+    vec3 viewPos;
+};
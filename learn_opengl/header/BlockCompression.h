@@ -0,0 +1,40 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+
+// Block-compressed texture formats: the image is cut into 4x4 texel blocks of 8 or 16 bytes,
+// which the texture units decode on the fly. A BC1 map takes 1/8 of its RGBA8 size in VRAM.
+enum class Block_Format
+{
+    // RGB, 8 bytes per block. The encoder writes opaque blocks only.
+    BC1,
+    // RGBA, 16 bytes: alpha as in BC4, then a BC1 color block
+    BC3,
+    // One channel (red), 8 bytes: specular, roughness, height maps
+    BC4,
+    // Two channels (red, green), 16 bytes: tangent-space normal maps
+    BC5,
+    // RGBA, 16 bytes, the best quality. The encoder (and decoder) cover mode 6 only.
+    BC7
+};
+
+const char* getBlockFormatName(Block_Format format);
+// Bytes of one 4x4 block
+size_t getBlockSize(Block_Format format);
+// Bytes of a width x height image, the partial blocks at the edges counting as whole ones
+size_t getCompressedSize(Block_Format format, int width, int height);
+// Channels kept by the format (R, RG, RGB or RGBA), the ones the PSNR is measured on
+int getBlockFormatChannels(Block_Format format);
+
+// Encodes RGBA8 pixels (rows tightly packed). Blocks past the edges repeat the last row / column.
+// "blocks" holds getCompressedSize() bytes.
+void encodeBlocks(Block_Format format, const unsigned char* rgba, int width, int height, unsigned char* blocks);
+// Back to RGBA8, to measure the quality (channels the format lacks are 0, alpha 255)
+void decodeBlocks(Block_Format format, const unsigned char* blocks, int width, int height, unsigned char* rgba);
+
+// Peak signal-to-noise ratio in dB between two RGBA8 images, over their first "channels" channels
+// (+infinity if they are identical)
+double computePSNR(const unsigned char* a, const unsigned char* b, size_t pixelCount, int channels);
+
+#endif
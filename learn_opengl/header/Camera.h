@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -16,6 +18,17 @@ enum class Camera_Movement
     RIGHT
 };
 
+// Depth mapping of the projection
+enum class Depth_Mode
+{
+    // OpenGL default: near plane -> -1, far plane -> 1 in NDC
+    STANDARD,
+    // No far plane, near plane -> 1 and infinity -> 0. Made for a [0, 1] clip depth (glClipControl), 
+    // a GL_GREATER depth test and a floating-point depth buffer: the precision the 1/z mapping loses 
+    // in the distance is given back by the float exponent, which is finest close to 0.
+    REVERSE_Z_INFINITE
+};
+
 // Default camera values
 const float YAW = -90.0f;
 const float PITCH = 0.0f;
@@ -24,7 +37,9 @@ const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
 
 
-// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
+// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL.
+// The view, projection and view-projection matrices are cached: they are only rebuilt after the Process* functions
+// (or SetPerspective) changed something. Code writing the public attributes directly must call MarkDirty().
 class Camera
 {
 public:
@@ -43,7 +58,8 @@ public:
     float Zoom;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), 
+        aspectRatio(1.0f), nearPlane(0.1f), farPlane(100.0f), depthMode(Depth_Mode::STANDARD), viewDirty(true), projectionDirty(true), changeCount(0)
     {
         Position = position;
         WorldUp = up;
@@ -52,7 +68,8 @@ public:
         updateCameraVectors();
     }
     // constructor with scalar values
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), 
+        aspectRatio(1.0f), nearPlane(0.1f), farPlane(100.0f), depthMode(Depth_Mode::STANDARD), viewDirty(true), projectionDirty(true), changeCount(0)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -61,10 +78,68 @@ public:
         updateCameraVectors();
     }
 
+    // sets the perspective projection, the vertical field of view being Zoom
+    void SetPerspective(float aspect, float nearDistance, float farDistance)
+    {
+        if (aspect == aspectRatio && nearDistance == nearPlane && farDistance == farPlane)
+            return;
+        aspectRatio = aspect;
+        nearPlane = nearDistance;
+        farPlane = farDistance;
+        markProjectionDirty();
+    }
+
+    // the far plane is ignored by REVERSE_Z_INFINITE
+    void SetDepthMode(Depth_Mode mode)
+    {
+        if (mode == depthMode)
+            return;
+        depthMode = mode;
+        markProjectionDirty();
+    }
+
+    Depth_Mode GetDepthMode() const
+    {
+        return depthMode;
+    }
+
+    // to call after writing Position, Front, Zoom... directly
+    void MarkDirty()
+    {
+        markViewDirty();
+        markProjectionDirty();
+    }
+
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix()
+    const glm::mat4& GetViewMatrix()
+    {
+        updateMatrices();
+        return view;
+    }
+
+    const glm::mat4& GetProjectionMatrix()
+    {
+        updateMatrices();
+        return projection;
+    }
+
+    const glm::mat4& GetViewProjectionMatrix()
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        updateMatrices();
+        return viewProjection;
+    }
+
+    // returns the world-space planes of the view frustum
+    Frustum GetFrustum()
+    {
+        return Frustum::fromMatrix(GetViewProjectionMatrix(), depthMode == Depth_Mode::REVERSE_Z_INFINITE);
+    }
+
+    // incremented by every change of the view or the projection: data derived from the camera 
+    // (uniform buffer, culling...) is up to date as long as the count it was built with is
+    unsigned int GetChangeCount() const
+    {
+        return changeCount;
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -79,6 +154,7 @@ public:
             Position -= Right * velocity;
         if (direction == Camera_Movement::RIGHT)
             Position += Right * velocity;
+        markViewDirty();
     }
 
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
@@ -101,19 +177,81 @@ public:
 
         // update Front, Right and Up Vectors using the updated Euler angles
         updateCameraVectors();
+        markViewDirty();
     }
 
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
+        float previousZoom = Zoom;
         Zoom -= (float)yoffset;
         if (Zoom < 1.0f)
             Zoom = 1.0f;
         if (Zoom > 45.0f)
             Zoom = 45.0f;
+        // scrolling past the limits changes nothing
+        if (Zoom != previousZoom)
+            markProjectionDirty();
     }
 
 private:
+    // projection parameters
+    float aspectRatio;
+    float nearPlane;
+    float farPlane;
+    Depth_Mode depthMode;
+
+    // cached matrices, rebuilt on first use after a change
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    bool viewDirty;
+    bool projectionDirty;
+    unsigned int changeCount;
+
+    void markViewDirty()
+    {
+        viewDirty = true;
+        changeCount++;
+    }
+
+    void markProjectionDirty()
+    {
+        projectionDirty = true;
+        changeCount++;
+    }
+
+    void updateMatrices()
+    {
+        if (!viewDirty && !projectionDirty)
+            return;
+        if (viewDirty)
+            view = glm::lookAt(Position, Position + Front, Up);
+        if (projectionDirty)
+        {
+            if (depthMode == Depth_Mode::REVERSE_Z_INFINITE)
+                projection = reverseZInfinitePerspective(glm::radians(Zoom), aspectRatio, nearPlane);
+            else
+                projection = glm::perspective(glm::radians(Zoom), aspectRatio, nearPlane, farPlane);
+        }
+        viewProjection = projection * view;
+        viewDirty = false;
+        projectionDirty = false;
+    }
+
+    // glm::perspective with the far plane at infinity and the depth reversed, for a [0, 1] clip depth:
+    // z_clip = near and w_clip = -z_view, so the depth is near / distance (1 on the near plane)
+    static glm::mat4 reverseZInfinitePerspective(float fovy, float aspect, float nearDistance)
+    {
+        float f = 1.0f / tan(fovy / 2.0f);
+        glm::mat4 result(0.0f);
+        result[0][0] = f / aspect;
+        result[1][1] = f;
+        result[2][3] = -1.0f;
+        result[3][2] = nearDistance;
+        return result;
+    }
+
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
     {
@@ -0,0 +1,40 @@
+#ifndef COMPACT_INDICES_H
+#define COMPACT_INDICES_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Part of an index buffer drawn with one call. Its indices are relative to baseVertex
+// (glDrawElementsBaseVertex, core since OpenGL 3.2).
+struct IndexRange
+{
+    GLsizei count;
+    // Offset of the first index in the index buffer, in bytes
+    size_t byteOffset;
+    GLint baseVertex;
+};
+
+// Index buffer in the narrowest type that fits: 16-bit indices take half the memory and half 
+// the index fetch bandwidth of 32-bit ones.
+// - Up to 65,536 vertices: a single 16-bit range.
+// - Larger meshes are split into consecutive ranges, each spanning less than 65,536 vertices 
+//   around its base vertex. The split works best once the vertices are in order of first use 
+//   (optimizeVertexFetch), which keeps the vertices of neighbouring triangles close.
+// - If a single triangle spans more than that, the whole buffer stays 32-bit.
+struct CompactIndices
+{
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum type;
+    // Raw indices of that type, ready for glBufferData
+    std::vector<unsigned char> data;
+    std::vector<IndexRange> ranges;
+};
+
+CompactIndices compactIndices(const std::vector<unsigned int>& indices);
+
+// Draws every range of the bound vertex array
+void drawIndexRanges(GLenum mode, GLenum type, const std::vector<IndexRange>& ranges);
+
+#endif
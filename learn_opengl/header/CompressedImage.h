@@ -0,0 +1,40 @@
+#ifndef COMPRESSED_IMAGE_H
+#define COMPRESSED_IMAGE_H
+
+#include "BlockCompression.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One mip level: its size in texels, and where its blocks are in CompressedImage::data
+struct CompressedLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// A block-compressed 2D image with its mip chain, as stored in a .ktx2 or .dds file.
+// The levels go from the full size down (not necessarily to 1x1).
+struct CompressedImage
+{
+    Block_Format format = Block_Format::BC1;
+    // Color maps are sRGB-encoded, data maps (specular, normals) are not
+    bool sRGB = false;
+    int width = 0;
+    int height = 0;
+    std::vector<CompressedLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+// Reads a .ktx2 (KTX 2.0, no supercompression) or .dds (DX9 FourCC or DX10 header) file, told apart
+// by their magic. 2D images in BC1/BC3/BC4/BC5/BC7 only; false for anything else.
+bool loadCompressedImage(const std::string& path, CompressedImage& image);
+bool parseCompressedImage(const unsigned char* bytes, size_t size, CompressedImage& image);
+
+// Writes a .ktx2 file, with the data format descriptor the format requires
+bool saveKTX2(const std::string& path, const CompressedImage& image);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FRAME_BLOCK_H
+#define FRAME_BLOCK_H
+
+#include <glm/glm.hpp>
+
+#include "../header/Std140.h"
+
+// CPU-side mirror of the "FrameBlock" uniform block of frame_block.glsl, in std140 layout:
+// the per-frame constants shared by every program (camera matrices and position).
+// Like LightBlock, values that did not change leave the block clean, so nothing is uploaded.
+class FrameBlock
+{
+public:
+    // Ctor: builds the layout
+    FrameBlock();
+
+    void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& viewProjection, const glm::vec3& viewPos);
+
+    Std140Buffer& getBuffer();
+
+private:
+    Std140Buffer m_buffer;
+    size_t m_view;
+    size_t m_projection;
+    size_t m_viewProjection;
+    size_t m_viewPos;
+};
+
+#endif
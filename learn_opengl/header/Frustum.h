@@ -0,0 +1,55 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// View frustum as 6 planes (xyz = normal pointing inside, w = distance), in world space when 
+// extracted from projection * view. A point p is inside a plane when dot(xyz, p) + w >= 0.
+struct Frustum
+{
+    // Prefixed: <windows.h> (through glad.h) defines NEAR and FAR as empty macros
+    enum Side { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+
+    // Gribb/Hartmann: the planes are sums and differences of the rows of the matrix.
+    // A plane without direction (the far plane of an infinite projection) never rejects anything.
+    // "zeroToOneDepth" for projections made for a [0, 1] clip depth (glClipControl). With reverse-Z 
+    // the PLANE_NEAR and PLANE_FAR planes are swapped, which does not matter to the intersection tests.
+    static Frustum fromMatrix(const glm::mat4& viewProjection, bool zeroToOneDepth = false);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+    bool intersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+};
+
+// Bounding spheres in SoA layout, so that the culling kernels load 4 or 8 of each component at once
+struct BoundingSphereSoA
+{
+    std::vector<float> x, y, z, radius;
+
+    void resize(size_t count);
+    size_t size() const;
+    void set(size_t i, const glm::vec3& center, float radius);
+};
+
+// Axis-aligned boxes in SoA layout
+struct BoundingBoxSoA
+{
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void resize(size_t count);
+    size_t size() const;
+    void set(size_t i, const glm::vec3& min, const glm::vec3& max);
+};
+
+// Batched kernels: test 8 (AVX) or 4 (SSE) objects per iteration against the 6 planes and write the 
+// indices of the visible ones, in order, to "visible" (resized to fit). Return the visible count.
+size_t cullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, std::vector<uint32_t>& visible);
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& visible);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// glad is generated for the OpenGL 3.3 core profile, without extensions.
+// Entry points from later versions (or the matching extensions) are loaded here at runtime,
+// each feature flag tells whether the driver exposes it. Call GLExt::load right after gladLoadGLLoader.
+
+// ----- TOKENS
+
+// ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// KHR_parallel_shader_compile
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// ARB_clip_control (core in 4.5)
+#ifndef GL_NEGATIVE_ONE_TO_ONE
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#endif
+#ifndef GL_ZERO_TO_ONE
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+
+// ARB_draw_indirect (core in 4.0)
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// EXT_texture_compression_s3tc (BC1, BC3), and its sRGB formats from EXT_texture_sRGB
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// ARB_texture_compression_bptc (BC7, core in 4.2)
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+namespace GLExt
+{
+    // ----- FUNCTION TYPES
+
+    typedef void (APIENTRYP PFNGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP PFNPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP PFNPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+    typedef void (APIENTRYP PFNCLIPCONTROLPROC)(GLenum origin, GLenum depth);
+    typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+    typedef void (APIENTRYP PFNDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)(GLenum mode, GLsizei count, GLenum type, const void* indices, 
+        GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+
+    // ----- FEATURES
+
+    extern bool programBinary;
+    extern bool parallelShaderCompile;
+    // glMultiDrawElementsIndirect (4.3, ARB_multi_draw_indirect)
+    extern bool multiDrawIndirect;
+    // Instanced draws starting at any instance (4.2, ARB_base_instance)
+    extern bool baseInstance;
+    // [0, 1] clip-space depth, needed by reverse-Z (4.5, ARB_clip_control)
+    extern bool clipControl;
+    // BC1 and BC3 textures (EXT_texture_compression_s3tc, never core but on every desktop driver). 
+    // BC4 and BC5 (RGTC) are core in 3.0.
+    extern bool textureCompressionS3TC;
+    // BC7 textures (4.2, ARB_texture_compression_bptc)
+    extern bool textureCompressionBPTC;
+
+    // ----- FUNCTIONS
+
+    extern PFNGETPROGRAMBINARYPROC GetProgramBinary;
+    extern PFNPROGRAMBINARYPROC ProgramBinary;
+    extern PFNPROGRAMPARAMETERIPROC ProgramParameteri;
+    extern PFNMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads;
+    extern PFNCLIPCONTROLPROC ClipControl;
+    extern PFNMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+    extern PFNDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC DrawElementsInstancedBaseVertexBaseInstance;
+
+    // Loads the entry points and fills the feature flags, needs a current context
+    void load(GLADloadproc loader);
+
+    // True if the context version is at least major.minor
+    bool hasVersion(int major, int minor);
+    // True if the driver lists the extension (e.g. "GL_ARB_get_program_binary")
+    bool hasExtension(const char* name);
+}
+
+#endif
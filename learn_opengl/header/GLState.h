@@ -0,0 +1,82 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// The OpenGL calls behind GLState. The default one forwards to the driver; 
+// a mock recording the calls lets the cache be checked without a GPU.
+struct GLStateBackend
+{
+    void (*useProgram)(GLuint program);
+    void (*bindVertexArray)(GLuint vertexArray);
+    void (*bindBuffer)(GLenum target, GLuint buffer);
+    void (*bindBufferBase)(GLenum target, GLuint index, GLuint buffer);
+    void (*activeTexture)(GLenum unit);
+    void (*bindTexture)(GLenum target, GLuint texture);
+
+    static GLStateBackend openGL();
+};
+
+// Shadow of the bindings of one context: program, vertex array, buffers and texture units.
+// A bind that would not change anything is dropped. Everything that binds in the main context goes 
+// through GLState::get(); code that calls OpenGL directly must call invalidate() afterwards.
+// - Only the common targets are shadowed (others are always forwarded, and left out of the counts).
+// - The element array buffer belongs to the vertex array: it is unknown after a vertex array change.
+// - Deleting a bound object unbinds it: report deletions with the forget* functions.
+class GLState
+{
+public:
+    // OpenGL 3.3 guarantees 16 units per stage, units past it are always forwarded
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+    // Ctor: nothing is known about the context yet
+    GLState(const GLStateBackend& backend = GLStateBackend::openGL());
+
+    // State of the main context
+    static GLState& get();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+    // Also binds the buffer to the generic target, like OpenGL does
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void activeTexture(unsigned int unit);
+    // Binds to the active unit
+    void bindTexture(GLenum target, GLuint texture);
+    // Binds to a unit, only activating it if the bind is needed
+    void bindTexture(unsigned int unit, GLenum target, GLuint texture);
+
+    // Deleted objects are unbound by OpenGL, and their names may be reused
+    void forgetVertexArray(GLuint vertexArray);
+    void forgetBuffer(GLuint buffer);
+    void forgetTexture(GLuint texture);
+    // Everything unknown again, e.g. after calls made behind the cache's back
+    void invalidate();
+
+    // Calls forwarded to OpenGL / dropped because the binding was already there
+    unsigned int getIssuedCallCount() const;
+    unsigned int getSavedCallCount() const;
+    void resetCallCounts();
+
+private:
+    static const unsigned int BUFFER_TARGET_COUNT = 8;
+    static const unsigned int TEXTURE_TARGET_COUNT = 3;
+
+    GLStateBackend m_backend;
+
+    GLuint m_program;
+    GLuint m_vertexArray;
+    GLuint m_buffers[BUFFER_TARGET_COUNT];
+    unsigned int m_activeTexture;
+    GLuint m_textures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+
+    unsigned int m_issuedCallCount;
+    unsigned int m_savedCallCount;
+
+    static int getBufferTargetIndex(GLenum target);
+    static int getTextureTargetIndex(GLenum target);
+    // Updates the shadow and the counters, true if the call must be issued
+    bool change(GLuint& shadow, GLuint value);
+};
+
+#endif
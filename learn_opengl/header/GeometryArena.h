@@ -0,0 +1,124 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include "CompactIndices.h"
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <vector>
+
+// First-fit free list over a range of units (vertices, bytes...), free neighbours merged back
+class FreeListAllocator
+{
+public:
+    static const size_t INVALID_OFFSET = (size_t)-1;
+
+    FreeListAllocator(size_t capacity = 0);
+
+    // Offset of a block of "size" units aligned on "alignment", INVALID_OFFSET if no free block is large enough
+    size_t allocate(size_t size, size_t alignment = 1);
+    void free(size_t offset, size_t size);
+    // Adds units at the end of the range
+    void grow(size_t newCapacity);
+    void reset(size_t capacity);
+
+    size_t getCapacity() const;
+    size_t getFreeSize() const;
+    size_t getLargestFreeBlock() const;
+
+private:
+    size_t m_capacity;
+    // Offset -> size of every free block
+    std::map<size_t, size_t> m_freeBlocks;
+};
+
+// Layout read by glMultiDrawElementsIndirect from the draw indirect buffer
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    // In indices, not bytes
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Handle to the geometry of a mesh in an arena, stays valid when the arena grows or is defragmented
+typedef unsigned int GeometryHandle;
+const GeometryHandle INVALID_GEOMETRY = 0xFFFFFFFF;
+
+// One vertex buffer, one index buffer and one VAO shared by every mesh of a vertex format.
+// Meshes are suballocated ranges: drawing all the meshes of a format binds the VAO once, 
+// each draw only passes its offsets (glDrawElementsBaseVertex).
+// - The buffers grow (doubling, by GPU copy) when an allocation does not fit.
+// - Freed ranges are reused; defragment() packs the live ranges at the start of new buffers.
+class GeometryArena
+{
+public:
+    // The attribute setup is called with the arena's VAO and vertex buffer bound, 
+    // e.g. setPackedVertexAttributes(true) for PackedVertex
+    GeometryArena(GLsizei vertexStride, std::function<void()> setVertexAttributes, size_t vertexCapacity = 65536, size_t indexCapacityBytes = 1 << 20);
+    // The GL objects are deleted explicitly, while the context is still alive (like the other buffers of main)
+    void deleteBuffers();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Copies the vertices (vertexCount * stride bytes) and indices into the arena
+    GeometryHandle allocate(const void* vertices, size_t vertexCount, const CompactIndices& indices);
+    void free(GeometryHandle handle);
+
+    // Binds the VAO (once for any number of draws)
+    void bind() const;
+    // Draws a mesh, the arena must be bound
+    void draw(GeometryHandle handle, GLenum mode = GL_TRIANGLES) const;
+
+    // The draws of a mesh as indirect commands (one per index range), all of the index type of the mesh
+    GLenum getIndexType(GeometryHandle handle) const;
+    void appendDrawCommands(GeometryHandle handle, GLuint instanceCount, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) const;
+
+    // Packs the live geometry at the start of new buffers, the handles are unchanged
+    void defragment();
+    // Free space the largest free block does not cover, in [0, 1]: 0 when all the free space is in one piece
+    float getFragmentation() const;
+
+    GLuint getVertexArray() const;
+    GLsizei getVertexStride() const;
+    size_t getVertexBytes() const;
+    size_t getIndexBytes() const;
+
+private:
+    // Index offsets and sizes are in bytes, aligned on 4 so that both index types fit
+    struct Allocation
+    {
+        bool live;
+        size_t vertexOffset;
+        size_t vertexCount;
+        size_t indexOffset;
+        size_t indexSize;
+        GLenum indexType;
+        std::vector<IndexRange> ranges;
+    };
+
+    GLsizei m_vertexStride;
+    std::function<void()> m_setVertexAttributes;
+
+    GLuint m_VAO;
+    GLuint m_VBO;
+    GLuint m_EBO;
+    FreeListAllocator m_vertices;
+    FreeListAllocator m_indices;
+
+    std::vector<Allocation> m_allocations;
+    std::vector<GeometryHandle> m_freeHandles;
+
+    void createBuffers(size_t vertexCapacity, size_t indexCapacityBytes, GLuint& VBO, GLuint& EBO) const;
+    void attachBuffers();
+    void growVertices(size_t minimumCapacity);
+    void growIndices(size_t minimumCapacityBytes);
+};
+
+#endif
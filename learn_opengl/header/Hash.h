@@ -0,0 +1,32 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to key the on-disk and in-memory caches by content.
+// Chain calls by passing the previous hash as "hash" to hash several buffers as one.
+const uint64_t FNV1A_64_OFFSET = 14695981039346656037ULL;
+const uint64_t FNV1A_64_PRIME = 1099511628211ULL;
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV1A_64_OFFSET)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& text, uint64_t hash = FNV1A_64_OFFSET)
+{
+    // The length is hashed too, so that ("ab", "c") and ("a", "bc") differ
+    uint64_t length = text.size();
+    hash = hashBytes(&length, sizeof(length), hash);
+    return hashBytes(text.data(), text.size(), hash);
+}
+
+#endif
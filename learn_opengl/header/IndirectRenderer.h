@@ -0,0 +1,60 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "GeometryArena.h"
+#include "InstanceBuffer.h"
+
+#include <vector>
+
+// Draws any number of objects of one geometry arena in one call per index type:
+// every object becomes a DrawElementsIndirectCommand, submitted with glMultiDrawElementsIndirect.
+// The per-object data (model and normal matrices) is the InstanceData at the command's base instance, 
+// read through the instance attributes: the #version 330 shaders need no change, and objects sharing 
+// a mesh in a row are merged into one instanced command.
+// Drivers without multi-draw indirect get the same commands in a loop of instanced draws.
+class IndirectRenderer
+{
+public:
+    IndirectRenderer(GeometryArena& arena, GLsizei capacity = 1024, bool withNormalMatrix = true);
+    // The GL objects are deleted explicitly, while the context is still alive
+    void deleteBuffers();
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // Forgets the objects of the previous frame
+    void clear();
+    // Adds one visible object
+    void add(GeometryHandle geometry, const InstanceData& instance);
+    // Uploads the commands and instances, then draws everything with the bound program
+    void submit(GLenum mode = GL_TRIANGLES);
+
+    // Objects and commands of the last submit, and the draw calls they cost
+    GLsizei getObjectCount() const;
+    GLsizei getCommandCount() const;
+    unsigned int getDrawCallCount() const;
+
+private:
+    GeometryArena& m_arena;
+    bool m_withNormalMatrix;
+    InstanceBuffer m_instances;
+    GLuint m_commandBuffer;
+    size_t m_commandCapacity;
+
+    std::vector<InstanceData> m_instanceData;
+    // 16-bit commands first in the buffer, then 32-bit ones
+    std::vector<DrawElementsIndirectCommand> m_commands16;
+    std::vector<DrawElementsIndirectCommand> m_commands32;
+    // Commands of the last added object, extended while the same mesh is added again
+    GeometryHandle m_lastGeometry;
+    size_t m_lastCommandCount;
+
+    unsigned int m_drawCallCount;
+
+    void uploadCommands();
+    void drawCommands(GLenum mode, GLenum type, const std::vector<DrawElementsIndirectCommand>& commands, size_t bufferOffset);
+};
+
+#endif
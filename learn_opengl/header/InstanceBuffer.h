@@ -0,0 +1,47 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Per-instance attribute locations, read by 1.colors.vs and 1.light_cube.vs.
+// Locations 0 -> 4 are left to the per-vertex attributes (see Mesh), a mat4 takes 4 locations and a mat3 3.
+const GLuint INSTANCE_MODEL_LOCATION = 5;
+const GLuint INSTANCE_NORMAL_MATRIX_LOCATION = 9;
+
+// Data of one instance, stored interleaved in the instance buffer
+struct InstanceData
+{
+    glm::mat4 model;
+    // Inverse transpose of the upper 3x3 of the model matrix, to bring normals to world space
+    glm::mat3 normalMatrix;
+};
+
+// Vertex buffer holding one InstanceData per drawn object. Once attached to a VAO, 
+// N objects sharing the same geometry cost a single glDrawArraysInstanced/glDrawElementsInstanced.
+class InstanceBuffer
+{
+public:
+    // ID of the buffer object
+    unsigned int m_ID;
+
+    // Ctor: reserves room for "capacity" instances
+    InstanceBuffer(GLsizei capacity = 0);
+
+    // Sets up the per-instance attributes (divisor 1) in the VAO, the normal matrix is optional.
+    // The attributes start at "firstInstance" (for drivers that cannot offset the instances of a draw).
+    void attach(GLuint VAO, bool withNormalMatrix = true, GLsizei firstInstance = 0) const;
+
+    // Replaces the instances, the buffer grows if needed
+    void upload(const std::vector<InstanceData>& instances);
+
+    GLsizei getCount() const;
+
+private:
+    GLsizei m_capacity;
+    GLsizei m_count;
+};
+
+#endif
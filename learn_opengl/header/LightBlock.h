@@ -0,0 +1,90 @@
+#ifndef LIGHT_BLOCK_H
+#define LIGHT_BLOCK_H
+
+#include <glm/glm.hpp>
+
+#include "../header/Std140.h"
+
+// Light types, same members as the structs declared in lighting.glsl
+
+struct DirLight
+{
+    glm::vec3 direction;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+struct PointLight
+{
+    glm::vec3 position;
+
+    // Attenuation constants
+    float constant;
+    float linear;
+    float quadratic;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+struct SpotLight
+{
+    glm::vec3 position;
+    glm::vec3 direction;
+    // Cosines of the inner and outer cone angles
+    float cutOff;
+    float outerCutOff;
+
+    // Attenuation constants
+    float constant;
+    float linear;
+    float quadratic;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+// CPU-side mirror of the "LightBlock" uniform block of lighting.glsl, in std140 layout.
+// Setting a light that did not change leaves the block clean, so nothing is uploaded.
+class LightBlock
+{
+public:
+    // Size of the pointLights array in the shader
+    static const unsigned int MAX_POINT_LIGHTS = 4;
+
+    // Ctor: builds the layout
+    LightBlock();
+
+    void setDirLight(const DirLight& light);
+    void setPointLight(unsigned int index, const PointLight& light);
+    void setSpotLight(const SpotLight& light);
+
+    Std140Buffer& getBuffer();
+
+private:
+    struct DirLightOffsets
+    {
+        size_t direction, ambient, diffuse, specular;
+    };
+
+    struct PointLightOffsets
+    {
+        size_t position, constant, linear, quadratic, ambient, diffuse, specular;
+    };
+
+    struct SpotLightOffsets
+    {
+        size_t position, direction, cutOff, outerCutOff, constant, linear, quadratic, ambient, diffuse, specular;
+    };
+
+    Std140Buffer m_buffer;
+    DirLightOffsets m_dirLight;
+    PointLightOffsets m_pointLights[MAX_POINT_LIGHTS];
+    SpotLightOffsets m_spotLight;
+};
+
+#endif
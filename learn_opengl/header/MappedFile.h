@@ -0,0 +1,51 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a whole file: its bytes are read straight from the page cache,
+// without the copy through a stdio / ifstream buffer. Pages are read on the first touch,
+// unless prefetch() asked for them ahead. mmap on POSIX, a file mapping view on Windows.
+class MappedFile
+{
+public:
+    // Ctor: nothing mapped
+    MappedFile();
+    // Ctor: maps the file (isOpen() tells whether it worked)
+    explicit MappedFile(const std::string& path);
+    // Dtor: unmaps
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void close();
+
+    // An empty file is open, with no data
+    bool isOpen() const;
+    const unsigned char* data() const;
+    size_t size() const;
+
+    // The whole file will be read soon: the kernel starts reading it in the background
+    // (madvise WILLNEED, PrefetchVirtualMemory on Windows 8+). Returns at once.
+    void prefetch() const;
+
+private:
+    const unsigned char* m_data;
+    size_t m_size;
+    bool m_open;
+};
+
+// Maps every file, then asks for all of them at once: the disk sees the reads of the whole batch
+// together instead of one page fault at a time when each file is decoded. Files that cannot be
+// mapped are left closed, in their place.
+std::vector<MappedFile> mapFiles(const std::vector<std::string>& paths, bool prefetch = true);
+
+// stbi_load through a mapping of the file (same arguments and result, free with stbi_image_free)
+unsigned char* loadImageMapped(const std::string& path, int* width, int* height, int* components, int requiredComponents);
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <vector>
+
+// Index and vertex reordering of triangle lists, run once when a mesh is loaded:
+// 1. vertex cache: triangles sharing vertices are drawn close together (Forsyth), so that the 
+//    vertex shader runs once per vertex instead of up to 6 times
+// 2. overdraw: the result is cut into clusters where the cache restarts anyway, and the clusters 
+//    facing outwards are drawn first (Sander et al., "Fast triangle reordering"), so that the depth 
+//    test rejects more of the hidden fragments
+// 3. vertex fetch: vertices are renumbered in order of first use, so that the fetches walk the 
+//    vertex buffer forward
+// None of it needs OpenGL: the results are checked with the cache simulator.
+
+// Post-transform cache efficiency of an index list, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    // Average cache miss ratio: vertex shader runs per triangle (0.5 is ideal on a large grid, 3 the worst)
+    float acmr = 0.0f;
+    // Average transform to vertex ratio: vertex shader runs per referenced vertex (1 is ideal)
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Cache size of the simulator: the FIFO depth of the classic hardware. Recent GPUs batch vertices 
+// differently, but the ratios still rank the orderings the same way.
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+VertexCacheStats simulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the triangles for the vertex cache
+std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Reorders the clusters of a cache-optimized list against overdraw. "threshold" is the ACMR loss 
+// accepted to get smaller clusters (1.05: 5% more vertex shader runs). 
+// Positions are read as 3 floats every "positionStride" bytes.
+std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int>& indices, const float* positions, size_t positionStride, 
+    size_t vertexCount, float threshold = 1.05f);
+
+// Renumbers the vertices in order of first use: rewrites the indices and returns the old -> new 
+// table (unreferenced vertices map to INVALID_VERTEX and are dropped by remapVertices)
+const unsigned int INVALID_VERTEX = 0xFFFFFFFF;
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount);
+
+template <typename VertexType>
+void remapVertices(std::vector<VertexType>& vertices, const std::vector<unsigned int>& remap)
+{
+    size_t usedCount = 0;
+    for (unsigned int newIndex : remap)
+    {
+        if (newIndex != INVALID_VERTEX)
+            usedCount++;
+    }
+
+    std::vector<VertexType> remapped(usedCount);
+    for (size_t i = 0; i < remap.size(); i++)
+    {
+        if (remap[i] != INVALID_VERTEX)
+            remapped[remap[i]] = vertices[i];
+    }
+    vertices.swap(remapped);
+}
+
+// The three passes in order, the vertices reordered to match
+template <typename VertexType>
+MeshOptimizationReport optimizeMesh(std::vector<VertexType>& vertices, std::vector<unsigned int>& indices, 
+    size_t positionOffset, float overdrawThreshold = 1.05f)
+{
+    MeshOptimizationReport report;
+    report.before = simulateVertexCache(indices, vertices.size());
+
+    indices = optimizeVertexCache(indices, vertices.size());
+    const float* positions = (const float*)((const char*)vertices.data() + positionOffset);
+    indices = optimizeOverdraw(indices, positions, sizeof(VertexType), vertices.size(), overdrawThreshold);
+    remapVertices(vertices, optimizeVertexFetch(indices, vertices.size()));
+
+    report.after = simulateVertexCache(indices, vertices.size());
+    return report;
+}
+
+void printMeshOptimizationReport(const char* name, const MeshOptimizationReport& report);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+
+enum class Mip_Filter
+{
+    // 2x2 average, what glGenerateMipmap does on most drivers
+    BOX,
+    // 6x6 Kaiser-windowed sinc: keeps more detail than the box, with less aliasing
+    KAISER
+};
+
+struct MipOptions
+{
+    Mip_Filter filter = Mip_Filter::BOX;
+    // The RGB channels hold sRGB-encoded colors: they are averaged in linear space, then encoded back.
+    // Averaging the encoded values darkens every level (alpha is always linear).
+    bool sRGB = false;
+    // Threads sharing the rows of a level, 0: one per core. Small levels always run on the calling thread.
+    unsigned int threadCount = 0;
+};
+
+struct MipLevel
+{
+    int width;
+    int height;
+    std::vector<unsigned char> rgba;
+};
+
+// The levels below an RGBA8 image (rows tightly packed): width/2 x height/2 down to 1x1, the image itself
+// not included. Each level is filtered from the previous one, kept in float so that the rounding does
+// not pile up down the chain. Odd sizes round down, the last row / column is repeated at the edges.
+std::vector<MipLevel> generateMipChain(const unsigned char* rgba, int width, int height, const MipOptions& options = MipOptions());
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef NORMAL_MATRIX_H
+#define NORMAL_MATRIX_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "../header/InstanceBuffer.h"
+
+// Normal matrix = inverse transpose of the upper 3x3 of the model matrix.
+// Computed on the CPU once per object instead of once per vertex in the shader.
+// The inverse transpose of a 3x3 matrix with columns (a, b, c) is its cofactor matrix 
+// divided by the determinant, whose columns are simply (b x c, c x a, a x b).
+
+// 3x3 matrices in SoA layout: m[column * 3 + row][i] is the element of the i-th matrix
+struct Mat3SoA
+{
+    std::vector<float> m[9];
+
+    void resize(size_t count);
+    size_t size() const;
+};
+
+// One matrix, SSE when available
+glm::mat3 computeNormalMatrix(const glm::mat4& model);
+
+// Batched kernel: processes 8 (AVX) or 4 (SSE) matrices per iteration, "normalMatrices" is resized to fit
+void computeNormalMatrices(const Mat3SoA& models, Mat3SoA& normalMatrices);
+
+// Fills the normalMatrix of every instance from its model matrix, through the batched kernel
+void computeNormalMatrices(std::vector<InstanceData>& instances);
+
+#endif
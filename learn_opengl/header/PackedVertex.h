@@ -0,0 +1,74 @@
+#ifndef PACKED_VERTEX_H
+#define PACKED_VERTEX_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Compact vertex, 20 bytes instead of 56 for the full-float Vertex of Mesh (32 for the cube of main):
+// - position: half floats (w = 1 pads it to 8 bytes)
+// - normal, tangent: octahedral encoding in the x and y of a 10:10:10:2 signed normalized integer.
+//   The 2-bit w of the tangent holds the sign of the bitangent, rebuilt as sign * cross(normal, tangent).
+// - texture coords: 16-bit unsigned normalized, i.e. in [0, 1] only (the values outside are clamped)
+// The vertex shaders decode the directions with octDecode() (packed_vertex.glsl), the rest is
+// converted by the vertex fetch.
+struct PackedVertex
+{
+    uint16_t position[4];
+    uint32_t normal;
+    uint32_t tangent;
+    uint16_t texCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// Worst errors of a packing, measured by decoding every vertex, and the sizes before/after.
+// Bounds: half floats keep 11 significant bits (error <= |x| * 2^-11, 2^-13 for the unit cube), 
+// the octahedral directions are off by less than 0.2 degree, the texture coords by 2^-17.
+struct VertexPackingReport
+{
+    size_t vertexCount = 0;
+    // Bytes of the source vertices and of the packed ones
+    size_t unpackedBytes = 0;
+    size_t packedBytes = 0;
+    // Largest absolute error of a position coordinate
+    float maxPositionError = 0.0f;
+    // Largest angle between a source and a decoded normal or tangent, in degrees
+    float maxDirectionError = 0.0f;
+    // Largest error of a texture coordinate in [0, 1]
+    float maxTexCoordError = 0.0f;
+    // Texture coords outside [0, 1], clamped: the packed layout does not suit repeated textures
+    size_t clampedTexCoordCount = 0;
+    // Positions past the half-float range (65504)
+    size_t overflowedPositionCount = 0;
+};
+
+// Scalar codecs
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+uint16_t packUnorm16(float value);
+float unpackUnorm16(uint16_t value);
+// Unit direction <-> point of the [-1, 1] square
+glm::vec2 octEncode(const glm::vec3& direction);
+glm::vec3 octDecode(const glm::vec2& encoded);
+// Unit direction <-> 10:10:10:2 integer (GL_INT_2_10_10_10_REV), w is -1 or 1
+uint32_t packDirection(const glm::vec3& direction, float w = 1.0f);
+glm::vec3 unpackDirection(uint32_t packed, float* w = nullptr);
+
+// Packs one vertex, the report (if any) gathers the errors and sizes. 
+// The bitangent only gives its sign, it is assumed orthogonal to the normal and the tangent.
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoords,
+    const glm::vec3& tangent = glm::vec3(1.0f, 0.0f, 0.0f), const glm::vec3& bitangent = glm::vec3(0.0f, 1.0f, 0.0f), 
+    VertexPackingReport* report = nullptr);
+void unpackVertex(const PackedVertex& vertex, glm::vec3& position, glm::vec3& normal, glm::vec2& texCoords, 
+    glm::vec3& tangent, glm::vec3& bitangent);
+
+// Attribute pointers of the packed layout for the VBO bound to GL_ARRAY_BUFFER and the bound VAO:
+// 0 position, 1 normal, 2 texture coords, 3 tangent (with the bitangent sign in w)
+void setPackedVertexAttributes(bool withTangent);
+
+void printVertexPackingReport(const char* name, const VertexPackingReport& report);
+
+#endif
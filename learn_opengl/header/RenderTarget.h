@@ -0,0 +1,37 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+// Offscreen framebuffer: an RGBA8 color renderbuffer and a depth renderbuffer of any format.
+// The default framebuffer only offers fixed-point depth; reverse-Z needs GL_DEPTH_COMPONENT32F,
+// so the scene is drawn here and then blitted to the window.
+class RenderTarget
+{
+public:
+    // ID of the framebuffer object
+    unsigned int m_ID;
+
+    RenderTarget(GLsizei width, GLsizei height, GLenum depthFormat = GL_DEPTH_COMPONENT32F);
+    // The GL objects are deleted explicitly, while the context is still alive
+    void deleteBuffers();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // Draw into the target, the viewport is set to its size
+    void bind() const;
+    // Copies the color to the default framebuffer (scaled to the window size) and binds it back
+    void blitToScreen(GLsizei screenWidth, GLsizei screenHeight) const;
+
+    GLsizei getWidth() const;
+    GLsizei getHeight() const;
+
+private:
+    GLsizei m_width;
+    GLsizei m_height;
+    GLuint m_colorBuffer;
+    GLuint m_depthBuffer;
+};
+
+#endif
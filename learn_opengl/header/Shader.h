@@ -8,6 +8,33 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Index into a shader's table of cached uniform locations.
+// Resolve it once with getUniformHandle() and use it in the render loop: 
+// the setters taking a handle do not hash any string nor query OpenGL.
+typedef unsigned int UniformHandle;
+
+// Immediate: the program is compiled and linked in the constructor.
+// Async: the constructor only submits the work (to the driver's compiler threads with 
+// KHR_parallel_shader_compile, or else to the compile worker) and isReady() tells when it is done.
+enum class ShaderBuildMode
+{
+    Immediate,
+    Async
+};
+
+// Preprocessor definitions injected right after the #version line of every stage, 
+// e.g. { "NR_POINT_LIGHTS", "2" } becomes "#define NR_POINT_LIGHTS 2". Sorted by name.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+class ShaderCompileWorker;
+class ShaderFileWatcher;
 
 class Shader
 {
@@ -16,7 +43,26 @@ public:
 	unsigned int m_ID;
 
 	// Ctor
-	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
+	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, ShaderBuildMode buildMode = ShaderBuildMode::Immediate, 
+        const ShaderDefines& defines = ShaderDefines());
+    // Not copyable: an async build keeps a pointer to the shader until it is done
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // False while an async build is running: the program must not be used yet, draw a fallback instead.
+    // Polls the driver (or the compile worker) and completes the build on the main thread when done.
+    bool isReady();
+    // Worker used by async builds when the driver lacks KHR_parallel_shader_compile
+    static void setCompileWorker(ShaderCompileWorker* worker);
+
+    // Hot reload: shaders built while a watcher is set watch their files (includes too).
+    // Call reloadIfChanged() at the start of the frame. When a file changed, the sources are read on 
+    // a background thread, then the program is rebuilt like an async build and swapped in on a later 
+    // call, which returns true: per-program state (sampler units, uniform block bindings) must then be set again.
+    // Without KHR_parallel_shader_compile nor a compile worker the rebuild itself runs in the frame (it says so).
+    // If the new sources do not compile the errors are printed and the current program is kept.
+    static void setFileWatcher(ShaderFileWatcher* watcher);
+    bool reloadIfChanged();
 
 	// Use/activate the shader
 	void use();
@@ -34,8 +80,97 @@ public:
     void setMat3(const std::string& name, const glm::mat3& mat) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // Uniform location cache (filled once after link)
+    UniformHandle getUniformHandle(const std::string& name);
+    GLint getUniformLocation(const std::string& name) const;
+    // Number of by-name lookups since the last reset, to check the render loop only uses handles
+    unsigned int getUniformLookupCount() const;
+    void resetUniformLookupCount();
+
+    // Program binary cache: when a directory is set, linked programs are saved there and loaded back
+    // on the next launch instead of being compiled. Empty (the default) disables the cache.
+    static void setBinaryCacheDirectory(const std::string& directory);
+    // True if the program was loaded from the binary cache instead of being compiled
+    bool isFromBinaryCache() const;
+
+    // Links the uniform block of this program to a uniform buffer binding point
+    void bindUniformBlock(const std::string& blockName, GLuint bindingPoint) const;
+
+    // Utility uniform functions taking a handle (no lookup)
+    void setBool(UniformHandle handle, bool value) const;
+    void setInt(UniformHandle handle, int value) const;
+    void setFloat(UniformHandle handle, float value) const;
+    void setVec2(UniformHandle handle, const glm::vec2& value) const;
+    void setVec3(UniformHandle handle, const glm::vec3& value) const;
+    void setVec3(UniformHandle handle, float x, float y, float z) const;
+    void setVec4(UniformHandle handle, const glm::vec4& value) const;
+    void setMat3(UniformHandle handle, const glm::mat3& mat) const;
+    void setMat4(UniformHandle handle, const glm::mat4& mat) const;
+    // Points a sampler to a texture unit. The program keeps the value: when it already has it, nothing is sent.
+    void setSampler(UniformHandle handle, int unit);
+
 private:
-	void checkCompileErrors(GLuint shader, std::string type);
+    // Location of every active uniform, arrays also registered per element ("lights[2]")
+    std::unordered_map<std::string, GLint> m_uniformLocations;
+    // Handle -> location, plus the handle's name so it can be re-resolved
+    std::vector<GLint> m_handleLocations;
+    std::vector<std::string> m_handleNames;
+    // Handle -> texture unit last given to the sampler, -1 until set (and after a relink)
+    std::vector<int> m_handleSamplerUnits;
+    mutable unsigned int m_uniformLookupCount;
+
+    static std::string s_binaryCacheDirectory;
+    bool m_fromBinaryCache;
+    // Where to save the binary once linked, empty when the cache is disabled
+    std::string m_binaryPath;
+
+    static ShaderCompileWorker* s_compileWorker;
+    bool m_ready;
+    bool m_compileOnWorker;
+    std::atomic<bool> m_compiledOnWorker;
+    // Shader objects, until they are checked and deleted by finishBuild (or finishReload)
+    GLuint m_vertexID, m_fragmentID, m_geometryID;
+
+    static ShaderFileWatcher* s_fileWatcher;
+    // What a reload builds from
+    std::string m_vertexPath, m_fragmentPath, m_geometryPath;
+    ShaderDefines m_defines;
+    // Every file the program is built from, and the watcher's generation when they were read
+    std::vector<std::string> m_dependencies;
+    uint64_t m_watchGeneration;
+    // Program being rebuilt, 0 when no reload is running
+    GLuint m_reloadID;
+
+    // The sources of a build, #includes expanded and defines injected
+    struct ShaderSources
+    {
+        std::string vertexCode, fragmentCode, geometryCode;
+        std::vector<std::string> dependencies;
+        // Watcher generation taken before reading
+        uint64_t watchGeneration;
+        bool read;
+    };
+    // Sources of the reload being read in the background (valid() until they are taken)
+    std::future<ShaderSources> m_reloadSources;
+
+	bool checkCompileErrors(GLuint shader, std::string type);
+    static std::string injectDefines(const std::string& source, const ShaderDefines& defines);
+    static ShaderSources readSources(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath, 
+        const ShaderDefines& defines, uint64_t watchGeneration);
+    void watchSources(const ShaderSources& sources);
+    void cacheUniformLocations();
+    GLuint createProgramObjects(bool hasGeometry);
+    bool submitBuild(GLuint program, const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode, bool async);
+    void compileAndLink(GLuint program, const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode);
+    bool isBuildComplete(GLuint program) const;
+    bool checkAndDeleteStages(GLuint program);
+    void finishBuild();
+    void startReload();
+    bool submitReload(const ShaderSources& sources);
+    bool finishReload();
+    std::string getBinaryCachePath(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode) const;
+    bool loadProgramBinary(const std::string& path);
+    void saveProgramBinary(const std::string& path) const;
 };
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef SHADER_COMPILE_WORKER_H
+#define SHADER_COMPILE_WORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Background thread with its own OpenGL context, shared with the main one, that runs the 
+// compile/link jobs of async shader builds when the driver has no KHR_parallel_shader_compile.
+// The context comes from the window system (e.g. a hidden GLFW window sharing the main window), 
+// so it is handed in as two callbacks run on the worker thread.
+class ShaderCompileWorker
+{
+public:
+    // Ctor: starts the thread, which makes its context current before running any job
+    ShaderCompileWorker(std::function<void()> makeContextCurrent, std::function<void()> releaseContext);
+    // Dtor: finishes the pending jobs, releases the context and joins the thread
+    ~ShaderCompileWorker();
+
+    ShaderCompileWorker(const ShaderCompileWorker&) = delete;
+    ShaderCompileWorker& operator=(const ShaderCompileWorker&) = delete;
+
+    // Queues a job, run in submission order on the worker thread
+    void submit(std::function<void()> job);
+
+private:
+    std::function<void()> m_makeContextCurrent;
+    std::function<void()> m_releaseContext;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_stop;
+
+    std::thread m_thread;
+
+    void run();
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SHADER_FILE_WATCHER_H
+#define SHADER_FILE_WATCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef __linux__
+#include <filesystem>
+#endif
+
+// Background thread watching the source files of the shaders for hot reload.
+// On Linux it sleeps on inotify (the directories are watched, so that editors saving through 
+// a rename are seen too); elsewhere it polls the modification times a few times per second.
+// Every change bumps a generation counter: a shader compares it with the generation of its 
+// last build, a single atomic load per frame while nothing changes.
+class ShaderFileWatcher
+{
+public:
+    // Ctor: starts the thread
+    ShaderFileWatcher();
+    // Dtor: stops and joins the thread
+    ~ShaderFileWatcher();
+
+    ShaderFileWatcher(const ShaderFileWatcher&) = delete;
+    ShaderFileWatcher& operator=(const ShaderFileWatcher&) = delete;
+
+    // Starts watching a file (paths as given by ShaderPreprocessor, watching twice is harmless)
+    void watch(const std::string& path);
+
+    // Incremented on every change of a watched file
+    uint64_t getGeneration() const;
+    // True if one of the files changed after the given generation
+    bool hasChangedSince(const std::vector<std::string>& paths, uint64_t generation) const;
+
+private:
+    mutable std::mutex m_mutex;
+    // Watched file -> generation of its last change (0: unchanged)
+    std::unordered_map<std::string, uint64_t> m_changes;
+    std::atomic<uint64_t> m_generation;
+    std::atomic<bool> m_running;
+
+#ifdef __linux__
+    int m_inotify;
+    // inotify watch descriptor -> directory
+    std::unordered_map<int, std::string> m_directories;
+#else
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+#endif
+
+    std::thread m_thread;
+
+    void run();
+    void onFileChanged(const std::string& path);
+};
+
+#endif
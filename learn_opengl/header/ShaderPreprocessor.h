@@ -0,0 +1,68 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Expands #include "file" directives in GLSL sources, so that common code (lights, BRDFs...)
+// is written once and shared by every program.
+// - Paths are relative to the including file. A file included twice in one program is only expanded
+//   once (like #pragma once).
+// - Every file is read and parsed once per process, however many programs include it: parsed
+//   sources are cached by content hash, and paths map to the hash of their content. A file reloaded
+//   with new content drops its old parsed source, so hot reloads do not pile up versions.
+// - Each file gets a number used as the GLSL source-string number of #line directives, so that
+//   remapErrorLog can turn "3(12) : error" back into "lighting.glsl(12) : error".
+class ShaderPreprocessor
+{
+public:
+    // Expands the file and its includes into "source". Returns false if one of the files cannot be read.
+    // "dependencies", when given, receives the path of every file used (the file itself included).
+    static bool load(const std::string& path, std::string& source, std::vector<std::string>* dependencies = nullptr);
+
+    // Replaces the source-string numbers found at the start of the lines of a compiler log by file paths
+    static std::string remapErrorLog(const std::string& log);
+
+    // Forgets the content of a file, the next load reads it again (parsed again only if it changed)
+    static void invalidate(const std::string& path);
+
+    // Number of files actually read from disk since the start
+    static unsigned int getFileReadCount();
+
+private:
+    // A source split in lines, includes already located: path-independent, shared by content
+    struct ParsedSource
+    {
+        std::vector<std::string> lines;
+        // Line index -> included path as written in the directive
+        std::unordered_map<size_t, std::string> includes;
+    };
+
+    struct FileEntry
+    {
+        std::string path;
+        uint64_t hash;
+        bool loaded;
+    };
+
+    static std::mutex s_mutex;
+    // Files by number (number = index + 1, 0 is left to the code injected around the files)
+    static std::vector<FileEntry> s_files;
+    static std::unordered_map<std::string, size_t> s_fileNumbers;
+    // Content hash -> parsed source, only for the content some file currently has
+    static std::unordered_map<uint64_t, ParsedSource> s_sources;
+    static unsigned int s_fileReadCount;
+
+    static std::string canonicalPath(const std::string& path);
+    static size_t getFileNumber(const std::string& canonical);
+    static const ParsedSource* readFile(size_t fileNumber);
+    static void releaseSource(uint64_t hash);
+    static bool expand(size_t fileNumber, bool isRoot, std::string& source, std::unordered_set<size_t>& included, std::vector<std::string>* dependencies);
+    static ParsedSource parse(const std::string& text);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "../header/Shader.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Every permutation of one set of shader files. Each material/light configuration gets its own program, 
+// specialized by #defines (light counts, enabled features, texture presence) instead of runtime branches.
+// A variant is compiled the first time it is asked for, then cached by its defines.
+class ShaderVariants
+{
+public:
+    // Ctor: nothing is compiled yet
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, ShaderBuildMode buildMode = ShaderBuildMode::Immediate);
+
+    // Returns the variant for these defines, compiling it on first use.
+    // The reference stays valid as long as the ShaderVariants object lives.
+    Shader& get(const ShaderDefines& defines);
+
+    // Number of variants compiled so far
+    size_t getVariantCount() const;
+
+    // Cache key of a set of defines: "NAME=VALUE;" for each define, in name order
+    static std::string makeKey(const ShaderDefines& defines);
+
+private:
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::string m_geometryPath;
+    ShaderBuildMode m_buildMode;
+
+    // Shaders are not movable (async builds point to them), hence the unique_ptr
+    std::unordered_map<std::string, std::unique_ptr<Shader>> m_variants;
+};
+
+#endif
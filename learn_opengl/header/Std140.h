@@ -0,0 +1,60 @@
+#ifndef STD140_H
+#define STD140_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// CPU-side image of a uniform block using the std140 layout rules.
+// The layout is built once by pushing the members in declaration order, each push returns 
+// the byte offset of the member. Values are then written at those offsets: only the bytes 
+// that actually change widen the dirty range, which is all that needs to be uploaded.
+// It does not touch OpenGL, so a layout can be checked without a context.
+class Std140Buffer
+{
+public:
+    // Ctor
+    Std140Buffer();
+
+    // Layout (std140 base alignments: scalar 4, vec2 8, vec3/vec4 16, matrix column 16, struct 16)
+    size_t pushFloat();
+    size_t pushInt();
+    size_t pushVec2();
+    size_t pushVec3();
+    size_t pushVec4();
+    size_t pushMat3();
+    size_t pushMat4();
+    // Struct members are pushed between these two calls, arrays of structs push one struct per element
+    size_t beginStruct();
+    void endStruct();
+
+    // Values
+    void setFloat(size_t offset, float value);
+    void setInt(size_t offset, int value);
+    void setVec2(size_t offset, const glm::vec2& value);
+    void setVec3(size_t offset, const glm::vec3& value);
+    void setVec4(size_t offset, const glm::vec4& value);
+    void setMat3(size_t offset, const glm::mat3& mat);
+    void setMat4(size_t offset, const glm::mat4& mat);
+
+    // Data
+    const unsigned char* data() const;
+    size_t size() const;
+
+    // Dirty range [begin, end), in bytes
+    bool isDirty() const;
+    size_t getDirtyBegin() const;
+    size_t getDirtyEnd() const;
+    void clearDirty();
+
+private:
+    std::vector<unsigned char> m_data;
+    size_t m_dirtyBegin;
+    size_t m_dirtyEnd;
+
+    size_t push(size_t alignment, size_t size);
+    void write(size_t offset, const void* source, size_t size);
+};
+
+#endif
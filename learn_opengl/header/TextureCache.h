@@ -0,0 +1,100 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class TextureStreamer;
+
+struct TextureCacheStats
+{
+    // acquire() calls answered by the path, by the contents (same file under another path), or loading a new texture
+    size_t pathHits = 0;
+    size_t contentHits = 0;
+    size_t misses = 0;
+    // Textures alive, and their GPU size (full mip chain): estimated from the header of the prefetched
+    // files, as uploaded for the others (nothing until then)
+    size_t residentTextures = 0;
+    size_t residentBytes = 0;
+};
+
+// Shares the textures between everything that uses the same image:
+// - The paths are canonicalized ("textures/../textures/a.png" is "textures/a.png").
+// - Different paths to the same contents share one texture too (copied files, same map in two folders),
+//   for the prefetched files: prefetch() hashes them on threads of its own. The other files are shared
+//   by path only, the render thread never reads them (the streamer's threads map and decode them).
+// - Every acquire() is matched by one release(): the texture is deleted with its last reference.
+class TextureCache
+{
+public:
+    // The streamer must outlive the cache
+    TextureCache(TextureStreamer& streamer);
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Maps the files about to be acquired and has the kernel read them all in the background (see mapFiles),
+    // then hashes them on background threads (one per core at most). Call it early in the load: 
+    // acquire() waits for the hash of its file.
+    void prefetch(const std::vector<std::string>& paths);
+    // Texture of the image, loaded on the first acquire (a file that cannot be read keeps the placeholder 
+    // of the streamer, which prints the error)
+    GLuint acquire(const std::string& path);
+    void release(GLuint texture);
+    // Deletes every texture, referenced or not (before the context goes away)
+    void clear();
+
+    TextureCacheStats getStats() const;
+
+private:
+    struct Entry
+    {
+        // Only the prefetched files are hashed
+        bool hashed;
+        uint64_t contentHash;
+        unsigned int references;
+        // Estimated from the header, 0 when the file was not prefetched
+        size_t bytes;
+    };
+
+    // Hash and estimated GPU size of a prefetched file
+    struct FileDigest
+    {
+        uint64_t contentHash;
+        size_t bytes;
+    };
+
+    // The files of one prefetch() and their digests, written by the hashing threads: 
+    // file i is hashed by thread i % hashed.size()
+    struct PrefetchBatch
+    {
+        std::vector<MappedFile> files;
+        std::vector<FileDigest> digests;
+        // Declared last, destroyed first: waits for the threads before the files are unmapped
+        std::vector<std::future<void>> hashed;
+    };
+
+    TextureStreamer& m_streamer;
+    std::unordered_map<GLuint, Entry> m_entries;
+    // Canonical path / content hash -> texture
+    std::unordered_map<std::string, GLuint> m_paths;
+    std::unordered_map<uint64_t, GLuint> m_contents;
+    // Canonical path -> batch and index of a file prefetched and not acquired yet
+    std::unordered_map<std::string, std::pair<std::shared_ptr<PrefetchBatch>, size_t>> m_prefetched;
+    TextureCacheStats m_stats;
+
+    static std::string canonicalPath(const std::string& path);
+    void destroy(GLuint texture);
+};
+
+#endif
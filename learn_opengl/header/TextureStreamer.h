@@ -0,0 +1,116 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include "MappedFile.h"
+#include "MipGenerator.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Main-thread stall caused by the uploads, over the frames that uploaded something
+struct TextureStreamStats
+{
+    size_t frames = 0;
+    double p50StallMs = 0.0;
+    double p99StallMs = 0.0;
+    double maxStallMs = 0.0;
+    size_t uploadedTextures = 0;
+    size_t uploadedBytes = 0;
+};
+
+// Loads textures without blocking the frame:
+// - request() returns at once a texture holding a 1x1 placeholder, which can be bound right away.
+// - Worker threads decode the files through a mapping (stbi_load_from_memory), then build their mip chains.
+// - update(), once per frame on the main thread, uploads the decoded images and their mips into their 
+//   textures through a pixel buffer object, until the per-frame budget is spent (no glGenerateMipmap stall). The texture name does not 
+//   change: whatever binds it draws the real image from the next frame on.
+class TextureStreamer
+{
+public:
+    // Ctor: starts "threadCount" decode threads (0: one per core but the main one). 
+    // The mips are filtered as "mipOptions" says, each image on the single thread decoding it.
+    TextureStreamer(unsigned int threadCount = 0, size_t uploadBudgetBytes = 8 << 20, double uploadBudgetMs = 2.0, 
+        const MipOptions& mipOptions = MipOptions());
+    // Dtor: stops the threads, dropping the pending images (no OpenGL call)
+    ~TextureStreamer();
+    // The GL objects are deleted explicitly, while the context is still alive
+    void deleteBuffers();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Texture holding the placeholder until the image is decoded and uploaded (for good if the file cannot be loaded)
+    GLuint request(const std::string& path);
+    // Same, from the file already mapped ("path" only names it in the errors)
+    GLuint request(const std::string& path, MappedFile file);
+    // Drops the pending upload of a texture about to be deleted (glBindTexture would bring the name back)
+    void cancel(GLuint texture);
+    // Main thread, once per frame
+    void update();
+
+    // Requested textures not uploaded yet
+    size_t getPendingCount() const;
+    // Bytes uploaded into a texture (every level), 0 until its upload. Main thread.
+    size_t getTextureBytes(GLuint texture) const;
+    TextureStreamStats getStats() const;
+
+private:
+    struct Job
+    {
+        std::string path;
+        GLuint texture;
+        // Not open: mapped by the worker
+        MappedFile file;
+    };
+
+    struct DecodedImage
+    {
+        GLuint texture;
+        int width;
+        int height;
+        // RGBA, stbi memory freed with stbi_image_free (null if the load failed)
+        std::unique_ptr<unsigned char, void (*)(void*)> pixels;
+        std::vector<MipLevel> mips;
+    };
+
+    size_t m_uploadBudgetBytes;
+    double m_uploadBudgetMs;
+    MipOptions m_mipOptions;
+    GLuint m_pixelBuffer;
+
+    // Decode queue, guarded by m_mutex
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_jobs;
+    std::deque<DecodedImage> m_decoded;
+    // Requested and not uploaded yet / cancelled while being decoded
+    std::unordered_set<GLuint> m_requested;
+    std::unordered_set<GLuint> m_cancelled;
+    size_t m_pendingCount;
+    bool m_stop;
+
+    std::vector<float> m_stallTimes;
+    // Texture -> bytes uploaded, main thread only
+    std::unordered_map<GLuint, size_t> m_textureBytes;
+    size_t m_uploadedTextures;
+    size_t m_uploadedBytes;
+
+    std::vector<std::thread> m_threads;
+
+    GLuint createPlaceholder() const;
+    void run();
+    // Bytes uploaded
+    size_t upload(const DecodedImage& image);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include "../header/Std140.h"
+
+// Uniform buffer object attached to a fixed binding point.
+// Shaders link their uniform block to the same binding point with Shader::bindUniformBlock.
+class UniformBuffer
+{
+public:
+    // ID of the buffer object
+    unsigned int m_ID;
+
+    // Ctor: allocates the buffer and attaches it to the binding point once and for all
+    UniformBuffer(GLsizeiptr size, GLuint bindingPoint);
+
+    // Uploads the dirty range of the block only, then marks it clean. Does nothing when clean.
+    void upload(Std140Buffer& block);
+
+    GLuint getBindingPoint() const;
+
+private:
+    GLuint m_bindingPoint;
+    GLsizeiptr m_size;
+};
+
+#endif
@@ -0,0 +1,178 @@
+// SHARED LIGHTING
+// Included by the fragment shaders that shade with the scene lights (see ShaderPreprocessor).
+// The including file declares "material" and "TexCoords" before the #include.
+
+// LIGHTS
+// Stored in a uniform buffer (std140 layout), mirrored on the CPU by the LightBlock class.
+// Keep both declarations in sync: the members are read back at fixed offsets.
+
+// DIRECTIONAL LIGHT
+
+struct DirLight
+{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// POINT LIGHT
+
+struct PointLight 
+{    
+    vec3 position;
+    
+    // Attenuation constants
+    float constant;
+    float linear;
+    float quadratic;  
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};  
+
+// SPOT LIGHT
+
+struct SpotLight
+{
+    vec3 position;
+    vec3 direction;
+    // Cosines of the inner and outer cone angles
+    float cutOff;
+    float outerCutOff;
+
+    // Attenuation constants
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// VARIANT DEFINES
+// Defaults, overridden by the #defines injected for each variant of the program (see ShaderVariants).
+// Disabled features are removed by the preprocessor: no dead loop nor branch is left in the program.
+
+// Number of point lights actually shaded, up to MAX_POINT_LIGHTS
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS 4
+#endif
+#ifndef USE_DIR_LIGHT
+#define USE_DIR_LIGHT 1
+#endif
+#ifndef USE_SPOT_LIGHT
+#define USE_SPOT_LIGHT 0
+#endif
+// Without a specular map, the specular term is dropped
+#ifndef HAS_SPECULAR_MAP
+#define HAS_SPECULAR_MAP 1
+#endif
+
+// Size of the array in the uniform block, fixed so that its layout is the same for every variant
+#define MAX_POINT_LIGHTS 4
+
+layout (std140) uniform LightBlock
+{
+    DirLight dirLight;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+// FUNCTIONS
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+{
+    // Minus sign because the direction should be from the fragment to the light source
+    vec3 lightDir = normalize(-light.direction);
+    
+    // Diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    
+    // Specular shading
+    // reflect(incident vec, normal vec) calculates the reflection direction for an incident vector
+    // Why minus sign ? Surely because we want the actual dir of the light rays, from source to frag
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    
+    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
+#if HAS_SPECULAR_MAP
+    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+#else
+    vec3 specular = vec3(0.0);
+#endif
+    
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    
+    // specular shading
+    // Why minus sign ? Surely because we want the actual dir of the light rays, from source to frag
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    
+    // attenuation
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    
+    // combine results
+    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
+#if HAS_SPECULAR_MAP
+    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+#else
+    vec3 specular = vec3(0.0);
+#endif
+
+    ambient  *= attenuation;
+    diffuse  *= attenuation;
+    specular *= attenuation;
+
+    return (ambient + diffuse + specular);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    
+    // attenuation
+    float distance    = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    
+    // spotlight intensity: soft edge between the inner and outer cones (cosines, hence outer < inner)
+    float theta     = dot(lightDir, normalize(-light.direction)); 
+    float epsilon   = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    
+    // combine results
+    vec3 ambient  = light.ambient  * vec3(texture(material.diffuse, TexCoords));
+    vec3 diffuse  = light.diffuse  * diff * vec3(texture(material.diffuse, TexCoords));
+#if HAS_SPECULAR_MAP
+    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+#else
+    vec3 specular = vec3(0.0);
+#endif
+
+    ambient  *= attenuation * intensity;
+    diffuse  *= attenuation * intensity;
+    specular *= attenuation * intensity;
+
+    return (ambient + diffuse + specular);
+}
\ No newline at end of file
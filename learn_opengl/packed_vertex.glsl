@@ -0,0 +1,19 @@
+// PACKED VERTEX
+// Decoding of the compact vertex layout (see PackedVertex.h). Positions, texture coords and the 
+// bitangent sign are converted by the vertex fetch, only the directions are left to the shader.
+
+// Octahedral encoding: the point of the [-1, 1] square is mapped back onto the unit sphere
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    // Lower hemisphere: unfold the corners of the square
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
+// Bitangent rebuilt from the normal, the tangent and the sign stored in the tangent's w
+vec3 decodeBitangent(vec3 normal, vec3 tangent, float sign)
+{
+    return cross(normal, tangent) * sign;
+}
@@ -0,0 +1,655 @@
+#include "../header/BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BLOCK_COMPRESSION_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE
+#endif
+
+const char* getBlockFormatName(Block_Format format)
+{
+    switch (format)
+    {
+    case Block_Format::BC1: return "BC1";
+    case Block_Format::BC3: return "BC3";
+    case Block_Format::BC4: return "BC4";
+    case Block_Format::BC5: return "BC5";
+    case Block_Format::BC7: return "BC7";
+    }
+    return "?";
+}
+
+size_t getBlockSize(Block_Format format)
+{
+    return format == Block_Format::BC1 || format == Block_Format::BC4 ? 8 : 16;
+}
+
+size_t getCompressedSize(Block_Format format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+int getBlockFormatChannels(Block_Format format)
+{
+    switch (format)
+    {
+    case Block_Format::BC1: return 3;
+    case Block_Format::BC4: return 1;
+    case Block_Format::BC5: return 2;
+    default: return 4;
+    }
+}
+
+// ------------------------------------------------------------------------
+// segment fitting
+// Every format stores a segment between two endpoints and, for each texel, the index of the
+// closest of a few evenly spaced values along it. The fitting works on float texels, one array
+// of 16 per channel, and knows nothing of the bit layouts.
+
+// Index of each texel along e0 -> e1, cut in "steps" values (0: e0, steps - 1: e1)
+static void fitIndices(const float* const channels[4], int channelCount, const float e0[4], const float e1[4], int steps, int indices[16])
+{
+    float axis[4];
+    float length2 = 0.0f;
+    for (int c = 0; c < channelCount; c++)
+    {
+        axis[c] = e1[c] - e0[c];
+        length2 += axis[c] * axis[c];
+    }
+    if (length2 == 0.0f)
+    {
+        std::fill(indices, indices + 16, 0);
+        return;
+    }
+
+    // t = dot(texel - e0, axis) * (steps - 1) / |axis|^2, rounded to the nearest step
+    float scale = (steps - 1) / length2;
+    float offset = 0.0f;
+    for (int c = 0; c < channelCount; c++)
+    {
+        axis[c] *= scale;
+        offset -= e0[c] * axis[c];
+    }
+    float last = (float)(steps - 1);
+
+    int i = 0;
+
+#if defined(BLOCK_COMPRESSION_AVX)
+    for (; i + 8 <= 16; i += 8)
+    {
+        __m256 t = _mm256_set1_ps(offset);
+        for (int c = 0; c < channelCount; c++)
+            t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_loadu_ps(channels[c] + i), _mm256_set1_ps(axis[c])));
+        t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(last));
+        // rounds to nearest (default rounding mode)
+        _mm256_storeu_si256((__m256i*)(indices + i), _mm256_cvtps_epi32(t));
+    }
+#endif
+
+#if defined(BLOCK_COMPRESSION_SSE)
+    for (; i + 4 <= 16; i += 4)
+    {
+        __m128 t = _mm_set1_ps(offset);
+        for (int c = 0; c < channelCount; c++)
+            t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(channels[c] + i), _mm_set1_ps(axis[c])));
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(last));
+        _mm_storeu_si128((__m128i*)(indices + i), _mm_cvtps_epi32(t));
+    }
+#endif
+
+    // Remaining texels
+    for (; i < 16; i++)
+    {
+        float t = offset;
+        for (int c = 0; c < channelCount; c++)
+            t += channels[c][i] * axis[c];
+        indices[i] = (int)std::nearbyint(std::min(std::max(t, 0.0f), last));
+    }
+}
+
+// Endpoints of the segment through the texels: their extremes along the principal axis,
+// then moved by least squares to the positions minimizing the error of the chosen indices
+static void fitSegment(const float* const channels[4], int channelCount, int steps, float e0[4], float e1[4])
+{
+    float mean[4];
+    float axis[4];
+    for (int c = 0; c < channelCount; c++)
+    {
+        float sum = 0.0f;
+        float low = channels[c][0];
+        float high = channels[c][0];
+        for (int i = 0; i < 16; i++)
+        {
+            sum += channels[c][i];
+            low = std::min(low, channels[c][i]);
+            high = std::max(high, channels[c][i]);
+        }
+        mean[c] = sum / 16.0f;
+        // the bounding box diagonal, as a start for the power iterations
+        axis[c] = high - low;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int a = 0; a < channelCount; a++)
+        {
+            for (int b = 0; b < channelCount; b++)
+                covariance[a][b] += (channels[a][i] - mean[a]) * (channels[b][i] - mean[b]);
+        }
+    }
+
+    // Principal axis: a few power iterations are enough for 16 texels
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4];
+        float largest = 0.0f;
+        for (int a = 0; a < channelCount; a++)
+        {
+            next[a] = 0.0f;
+            for (int b = 0; b < channelCount; b++)
+                next[a] += covariance[a][b] * axis[b];
+            largest = std::max(largest, std::abs(next[a]));
+        }
+        // no variance along it: keep the diagonal
+        if (largest == 0.0f)
+            break;
+        for (int a = 0; a < channelCount; a++)
+            axis[a] = next[a] / largest;
+    }
+
+    float length2 = 0.0f;
+    for (int c = 0; c < channelCount; c++)
+        length2 += axis[c] * axis[c];
+    // Flat block: a single color
+    if (length2 == 0.0f)
+    {
+        for (int c = 0; c < channelCount; c++)
+            e0[c] = e1[c] = mean[c];
+        return;
+    }
+
+    float low = std::numeric_limits<float>::max();
+    float high = -std::numeric_limits<float>::max();
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channelCount; c++)
+            t += (channels[c][i] - mean[c]) * axis[c];
+        low = std::min(low, t);
+        high = std::max(high, t);
+    }
+    for (int c = 0; c < channelCount; c++)
+    {
+        e0[c] = mean[c] + axis[c] * low / length2;
+        e1[c] = mean[c] + axis[c] * high / length2;
+    }
+
+    // Least squares: texel i is approximated by (1 - w) e0 + w e1, with w its index / (steps - 1)
+    int indices[16];
+    fitIndices(channels, channelCount, e0, e1, steps, indices);
+    float a = 0.0f, b = 0.0f, d = 0.0f;
+    float x[4] = {}, y[4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float w = indices[i] / (float)(steps - 1);
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        d += w * w;
+        for (int c = 0; c < channelCount; c++)
+        {
+            x[c] += (1.0f - w) * channels[c][i];
+            y[c] += w * channels[c][i];
+        }
+    }
+    float det = a * d - b * b;
+    // all texels on the same index: the extremes stay
+    if (std::abs(det) < 1e-6f)
+        return;
+    for (int c = 0; c < channelCount; c++)
+    {
+        e0[c] = std::min(std::max((d * x[c] - b * y[c]) / det, 0.0f), 255.0f);
+        e1[c] = std::min(std::max((a * y[c] - b * x[c]) / det, 0.0f), 255.0f);
+    }
+}
+
+// The 4x4 texels at (x, y), one array per channel. Past the edges, the last row / column repeats.
+static void loadBlock(const unsigned char* rgba, int width, int height, int x, int y, float texels[4][16])
+{
+    for (int row = 0; row < 4; row++)
+    {
+        const unsigned char* line = rgba + (size_t)std::min(y + row, height - 1) * width * 4;
+        for (int column = 0; column < 4; column++)
+        {
+            const unsigned char* pixel = line + std::min(x + column, width - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                texels[c][row * 4 + column] = pixel[c];
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// encoders
+
+static uint16_t toRGB565(const float color[3])
+{
+    int r = (int)std::nearbyint(color[0] * 31.0f / 255.0f);
+    int g = (int)std::nearbyint(color[1] * 63.0f / 255.0f);
+    int b = (int)std::nearbyint(color[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void fromRGB565(uint16_t color, int rgb[3])
+{
+    int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Opaque BC1 block (also the color half of BC3): always c0 > c1, the 4-color mode
+static void encodeBC1Block(const float texels[4][16], unsigned char* block)
+{
+    const float* const channels[4] = { texels[0], texels[1], texels[2], nullptr };
+    float e0[4], e1[4];
+    fitSegment(channels, 3, 4, e0, e1);
+
+    uint16_t c0 = toRGB565(e0);
+    uint16_t c1 = toRGB565(e1);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t bits = 0;
+    // c0 == c1: one color, every index at 0
+    if (c0 != c1)
+    {
+        // indices fitted again on the endpoints as the GPU sees them
+        int q0[3], q1[3];
+        fromRGB565(c0, q0);
+        fromRGB565(c1, q1);
+        float p0[4] = { (float)q0[0], (float)q0[1], (float)q0[2] };
+        float p1[4] = { (float)q1[0], (float)q1[1], (float)q1[2] };
+        int indices[16];
+        fitIndices(channels, 3, p0, p1, 4, indices);
+
+        // steps along the segment -> palette entries (c0, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1, c1)
+        static const uint32_t codes[4] = { 0, 2, 3, 1 };
+        for (int i = 0; i < 16; i++)
+            bits |= codes[indices[i]] << (2 * i);
+    }
+
+    block[0] = (unsigned char)(c0 & 0xFF);
+    block[1] = (unsigned char)(c0 >> 8);
+    block[2] = (unsigned char)(c1 & 0xFF);
+    block[3] = (unsigned char)(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        block[4 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+// One channel, in the 8-value mode (a0 > a1)
+static void encodeBC4Block(const float* values, unsigned char* block)
+{
+    const float* const channels[4] = { values, nullptr, nullptr, nullptr };
+    float e0[4], e1[4];
+    fitSegment(channels, 1, 8, e0, e1);
+
+    int a0 = (int)std::nearbyint(std::max(e0[0], e1[0]));
+    int a1 = (int)std::nearbyint(std::min(e0[0], e1[0]));
+
+    uint64_t bits = 0;
+    if (a0 != a1)
+    {
+        float p0[4] = { (float)a0 };
+        float p1[4] = { (float)a1 };
+        int indices[16];
+        fitIndices(channels, 1, p0, p1, 8, indices);
+
+        // steps along the segment -> palette entries (a0, then the 6 interpolated values, a1)
+        static const uint64_t codes[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+        for (int i = 0; i < 16; i++)
+            bits |= codes[indices[i]] << (3 * i);
+    }
+
+    block[0] = (unsigned char)a0;
+    block[1] = (unsigned char)a1;
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+// Bits are written from the least significant bit of the first byte on
+struct BitWriter
+{
+    unsigned char* bytes;
+    unsigned int position;
+
+    void write(unsigned int value, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; i++, position++)
+        {
+            if ((value >> i) & 1)
+                bytes[position >> 3] |= (unsigned char)(1 << (position & 7));
+        }
+    }
+};
+
+// 7 bits per channel and a shared low bit (p-bit) per endpoint: the p-bit giving the smallest error
+static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+{
+    float bestError = std::numeric_limits<float>::max();
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = std::min(std::max((int)std::nearbyint((endpoint[c] - p) / 2.0f), 0), 127);
+            float delta = ((candidate[c] << 1) | p) - endpoint[c];
+            error += delta * delta;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            pBit = p;
+            std::memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// Mode 6: one RGBA segment over the whole block, 16 steps
+static void encodeBC7Block(const float texels[4][16], unsigned char* block)
+{
+    const float* const channels[4] = { texels[0], texels[1], texels[2], texels[3] };
+    float e0[4], e1[4];
+    fitSegment(channels, 4, 16, e0, e1);
+
+    int q0[4], q1[4];
+    int p0, p1;
+    quantizeBC7Endpoint(e0, q0, p0);
+    quantizeBC7Endpoint(e1, q1, p1);
+
+    float d0[4], d1[4];
+    for (int c = 0; c < 4; c++)
+    {
+        d0[c] = (float)((q0[c] << 1) | p0);
+        d1[c] = (float)((q1[c] << 1) | p1);
+    }
+    int indices[16];
+    fitIndices(channels, 4, d0, d1, 16, indices);
+
+    // The first index is stored without its top bit, which must be 0: otherwise the segment is reversed
+    if (indices[0] >= 8)
+    {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(block, 0, 16);
+    BitWriter writer = { block, 0 };
+    // mode 6: six 0 bits, then a 1
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        writer.write(q0[c], 7);
+        writer.write(q1[c], 7);
+    }
+    writer.write(p0, 1);
+    writer.write(p1, 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        writer.write(indices[i], 4);
+}
+
+void encodeBlocks(Block_Format format, const unsigned char* rgba, int width, int height, unsigned char* blocks)
+{
+    size_t blockSize = getBlockSize(format);
+    float texels[4][16];
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4, blocks += blockSize)
+        {
+            loadBlock(rgba, width, height, x, y, texels);
+            switch (format)
+            {
+            case Block_Format::BC1:
+                encodeBC1Block(texels, blocks);
+                break;
+            case Block_Format::BC3:
+                encodeBC4Block(texels[3], blocks);
+                encodeBC1Block(texels, blocks + 8);
+                break;
+            case Block_Format::BC4:
+                encodeBC4Block(texels[0], blocks);
+                break;
+            case Block_Format::BC5:
+                encodeBC4Block(texels[0], blocks);
+                encodeBC4Block(texels[1], blocks + 8);
+                break;
+            case Block_Format::BC7:
+                encodeBC7Block(texels, blocks);
+                break;
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// decoders
+
+// RGBA of the 16 texels. In BC3 the color block is always in the 4-color mode.
+static void decodeBC1Block(const unsigned char* block, bool fourColors, unsigned char texels[16][4])
+{
+    uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+    uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+    int p0[3], p1[3];
+    fromRGB565(c0, p0);
+    fromRGB565(c1, p1);
+
+    unsigned char palette[4][4];
+    for (int c = 0; c < 3; c++)
+    {
+        palette[0][c] = (unsigned char)p0[c];
+        palette[1][c] = (unsigned char)p1[c];
+        if (fourColors || c0 > c1)
+        {
+            palette[2][c] = (unsigned char)((2 * p0[c] + p1[c]) / 3);
+            palette[3][c] = (unsigned char)((p0[c] + 2 * p1[c]) / 3);
+        }
+        else
+        {
+            // 3 colors and transparent black
+            palette[2][c] = (unsigned char)((p0[c] + p1[c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColors || c0 > c1 ? 255 : 0;
+
+    uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+    for (int i = 0; i < 16; i++)
+        std::memcpy(texels[i], palette[(bits >> (2 * i)) & 3], 4);
+}
+
+static void decodeBC4Block(const unsigned char* block, unsigned char values[16])
+{
+    int a0 = block[0];
+    int a1 = block[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1)
+    {
+        for (int i = 1; i <= 6; i++)
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else
+    {
+        for (int i = 1; i <= 4; i++)
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t)block[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++)
+        values[i] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+}
+
+struct BitReader
+{
+    const unsigned char* bytes;
+    unsigned int position;
+
+    unsigned int read(unsigned int count)
+    {
+        unsigned int value = 0;
+        for (unsigned int i = 0; i < count; i++, position++)
+            value |= ((bytes[position >> 3] >> (position & 7)) & 1u) << i;
+        return value;
+    }
+};
+
+// Mode 6 only: blocks in the other modes come out transparent black
+static void decodeBC7Block(const unsigned char* block, unsigned char texels[16][4])
+{
+    if ((block[0] & 0x7F) != 0x40)
+    {
+        std::memset(texels, 0, 16 * 4);
+        return;
+    }
+
+    BitReader reader = { block, 7 };
+    int q[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+        q[0][c] = reader.read(7);
+        q[1][c] = reader.read(7);
+    }
+    int p0 = reader.read(1);
+    int p1 = reader.read(1);
+
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for (int i = 0; i < 16; i++)
+    {
+        int w = weights[reader.read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++)
+        {
+            int e0 = (q[0][c] << 1) | p0;
+            int e1 = (q[1][c] << 1) | p1;
+            texels[i][c] = (unsigned char)(((64 - w) * e0 + w * e1 + 32) >> 6);
+        }
+    }
+}
+
+void decodeBlocks(Block_Format format, const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+    size_t blockSize = getBlockSize(format);
+    unsigned char texels[16][4];
+    unsigned char values[16];
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4, blocks += blockSize)
+        {
+            switch (format)
+            {
+            case Block_Format::BC1:
+                decodeBC1Block(blocks, false, texels);
+                break;
+            case Block_Format::BC3:
+                decodeBC1Block(blocks + 8, true, texels);
+                decodeBC4Block(blocks, values);
+                for (int i = 0; i < 16; i++)
+                    texels[i][3] = values[i];
+                break;
+            case Block_Format::BC4:
+                decodeBC4Block(blocks, values);
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[i][0] = values[i];
+                    texels[i][1] = texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+                break;
+            case Block_Format::BC5:
+                decodeBC4Block(blocks, values);
+                for (int i = 0; i < 16; i++)
+                    texels[i][0] = values[i];
+                decodeBC4Block(blocks + 8, values);
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[i][1] = values[i];
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+                break;
+            case Block_Format::BC7:
+                decodeBC7Block(blocks, texels);
+                break;
+            }
+
+            // texels past the edges are dropped
+            for (int row = 0; row < 4 && y + row < height; row++)
+            {
+                int columns = std::min(4, width - x);
+                std::memcpy(rgba + ((size_t)(y + row) * width + x) * 4, texels[row * 4], columns * 4);
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// quality
+
+double computePSNR(const unsigned char* a, const unsigned char* b, size_t pixelCount, int channels)
+{
+    uint64_t sum = 0;
+    size_t i = 0;
+
+    // 256-bit integer operations need AVX2: SSE2 only
+#if defined(BLOCK_COMPRESSION_SSE)
+    // The channels left out are zeroed in both images
+    uint32_t channelMask = channels >= 4 ? 0xFFFFFFFFu : (1u << (8 * channels)) - 1;
+    const __m128i mask = _mm_set1_epi32((int)channelMask);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = _mm_setzero_si128();
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        __m128i pixelsA = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a + i * 4)), mask);
+        __m128i pixelsB = _mm_and_si128(_mm_loadu_si128((const __m128i*)(b + i * 4)), mask);
+        __m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(pixelsA, zero), _mm_unpacklo_epi8(pixelsB, zero));
+        __m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(pixelsA, zero), _mm_unpackhi_epi8(pixelsB, zero));
+        // squared differences summed by pairs, at most 4 * 255^2 per 32-bit lane
+        __m128i squares = _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high));
+        total = _mm_add_epi64(total, _mm_unpacklo_epi32(squares, zero));
+        total = _mm_add_epi64(total, _mm_unpackhi_epi32(squares, zero));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    sum = lanes[0] + lanes[1];
+#endif
+
+    // Remaining pixels
+    for (; i < pixelCount; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            int delta = (int)a[i * 4 + c] - (int)b[i * 4 + c];
+            sum += (uint64_t)(delta * delta);
+        }
+    }
+
+    if (sum == 0)
+        return std::numeric_limits<double>::infinity();
+    double meanSquaredError = (double)sum / ((double)pixelCount * channels);
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,78 @@
+#include "../header/CompactIndices.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Indices of a 16-bit range are in [0, 65535]
+const unsigned int MAX_RANGE_SPAN = 0xFFFF;
+
+CompactIndices compactIndices(const std::vector<unsigned int>& indices)
+{
+    CompactIndices result;
+
+    // Split the triangles into consecutive ranges whose vertices fit around a base vertex
+    struct Split
+    {
+        size_t begin;
+        unsigned int minVertex;
+    };
+    std::vector<Split> splits;
+    bool fits = true;
+    unsigned int minVertex = 0;
+    unsigned int maxVertex = 0;
+    for (size_t i = 0; i + 2 < indices.size() && fits; i += 3)
+    {
+        unsigned int triangleMin = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+        unsigned int triangleMax = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+        if (triangleMax - triangleMin > MAX_RANGE_SPAN)
+            fits = false;
+        else if (splits.empty() || std::max(maxVertex, triangleMax) - std::min(minVertex, triangleMin) > MAX_RANGE_SPAN)
+        {
+            splits.push_back({ i, triangleMin });
+            minVertex = triangleMin;
+            maxVertex = triangleMax;
+        }
+        else
+        {
+            minVertex = std::min(minVertex, triangleMin);
+            maxVertex = std::max(maxVertex, triangleMax);
+            splits.back().minVertex = minVertex;
+        }
+    }
+
+    if (!fits || splits.empty())
+    {
+        result.type = GL_UNSIGNED_INT;
+        result.data.resize(indices.size() * sizeof(unsigned int));
+        if (!indices.empty())
+            std::memcpy(result.data.data(), indices.data(), result.data.size());
+        result.ranges.push_back({ (GLsizei)indices.size(), 0, 0 });
+        return result;
+    }
+
+    result.type = GL_UNSIGNED_SHORT;
+    result.data.resize(indices.size() * sizeof(uint16_t));
+    uint16_t* shortIndices = (uint16_t*)result.data.data();
+    for (size_t s = 0; s < splits.size(); s++)
+    {
+        size_t begin = splits[s].begin;
+        size_t end = s + 1 < splits.size() ? splits[s + 1].begin : indices.size() - indices.size() % 3;
+        unsigned int baseVertex = splits[s].minVertex;
+        for (size_t i = begin; i < end; i++)
+            shortIndices[i] = (uint16_t)(indices[i] - baseVertex);
+        result.ranges.push_back({ (GLsizei)(end - begin), begin * sizeof(uint16_t), (GLint)baseVertex });
+    }
+    return result;
+}
+
+void drawIndexRanges(GLenum mode, GLenum type, const std::vector<IndexRange>& ranges)
+{
+    for (const IndexRange& range : ranges)
+    {
+        if (range.baseVertex == 0)
+            glDrawElements(mode, range.count, type, (void*)range.byteOffset);
+        else
+            glDrawElementsBaseVertex(mode, range.count, type, (void*)range.byteOffset, range.baseVertex);
+    }
+}
@@ -0,0 +1,413 @@
+#include "../header/CompressedImage.h"
+#include "../header/MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Both formats are little-endian
+static uint32_t readU32(const unsigned char* bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t readU64(const unsigned char* bytes)
+{
+    return readU32(bytes) | ((uint64_t)readU32(bytes + 4) << 32);
+}
+
+static void appendU32(std::vector<unsigned char>& bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        bytes.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static void appendU64(std::vector<unsigned char>& bytes, uint64_t value)
+{
+    appendU32(bytes, (uint32_t)value);
+    appendU32(bytes, (uint32_t)(value >> 32));
+}
+
+// Level "level" of the chain: halved in each dimension, down to 1
+static int getLevelExtent(int extent, size_t level)
+{
+    return std::max(1, extent >> level);
+}
+
+// ------------------------------------------------------------------------
+// KTX2
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+// Identifier, header and index, then the level index
+static const size_t KTX2_HEADER_SIZE = 80;
+static const size_t KTX2_LEVEL_SIZE = 24;
+
+// VkFormat values
+enum
+{
+    VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131,
+    VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+    VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+    VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+    VK_FORMAT_BC3_UNORM_BLOCK = 137,
+    VK_FORMAT_BC3_SRGB_BLOCK = 138,
+    VK_FORMAT_BC4_UNORM_BLOCK = 139,
+    VK_FORMAT_BC5_UNORM_BLOCK = 141,
+    VK_FORMAT_BC7_UNORM_BLOCK = 145,
+    VK_FORMAT_BC7_SRGB_BLOCK = 146
+};
+
+static bool fromVkFormat(uint32_t vkFormat, Block_Format& format, bool& sRGB)
+{
+    switch (vkFormat)
+    {
+    // the punch-through alpha of BC1 RGBA is dropped: the blocks are uploaded as opaque RGB
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: format = Block_Format::BC1; sRGB = false; return true;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK: case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: format = Block_Format::BC1; sRGB = true; return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK: format = Block_Format::BC3; sRGB = false; return true;
+    case VK_FORMAT_BC3_SRGB_BLOCK: format = Block_Format::BC3; sRGB = true; return true;
+    case VK_FORMAT_BC4_UNORM_BLOCK: format = Block_Format::BC4; sRGB = false; return true;
+    case VK_FORMAT_BC5_UNORM_BLOCK: format = Block_Format::BC5; sRGB = false; return true;
+    case VK_FORMAT_BC7_UNORM_BLOCK: format = Block_Format::BC7; sRGB = false; return true;
+    case VK_FORMAT_BC7_SRGB_BLOCK: format = Block_Format::BC7; sRGB = true; return true;
+    }
+    return false;
+}
+
+static uint32_t toVkFormat(Block_Format format, bool sRGB)
+{
+    switch (format)
+    {
+    case Block_Format::BC1: return sRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case Block_Format::BC3: return sRGB ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    // no sRGB variant for data formats
+    case Block_Format::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case Block_Format::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case Block_Format::BC7: return sRGB ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return 0;
+}
+
+static bool parseKTX2(const unsigned char* bytes, size_t size, CompressedImage& image)
+{
+    if (size < KTX2_HEADER_SIZE)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::KTX2_TRUNCATED" << std::endl;
+        return false;
+    }
+
+    uint32_t vkFormat = readU32(bytes + 12);
+    uint32_t width = readU32(bytes + 20);
+    uint32_t height = readU32(bytes + 24);
+    uint32_t depth = readU32(bytes + 28);
+    uint32_t layerCount = readU32(bytes + 32);
+    uint32_t faceCount = readU32(bytes + 36);
+    // 0: the loader should generate the mips, there is only the base level
+    uint32_t levelCount = std::max(1u, readU32(bytes + 40));
+    uint32_t supercompression = readU32(bytes + 44);
+
+    if (depth > 1 || layerCount > 1 || faceCount != 1 || width == 0 || height == 0 || width > 65536 || height > 65536)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::KTX2_NOT_2D" << std::endl;
+        return false;
+    }
+    if (supercompression != 0)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::KTX2_SUPERCOMPRESSED " << supercompression << std::endl;
+        return false;
+    }
+    if (!fromVkFormat(vkFormat, image.format, image.sRGB))
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::UNSUPPORTED_FORMAT vkFormat " << vkFormat << std::endl;
+        return false;
+    }
+    if (levelCount > 32 || size < KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::KTX2_TRUNCATED" << std::endl;
+        return false;
+    }
+
+    image.width = (int)width;
+    image.height = (int)height;
+    image.levels.clear();
+    image.data.clear();
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const unsigned char* entry = bytes + KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        uint64_t offset = readU64(entry);
+        uint64_t length = readU64(entry + 8);
+
+        CompressedLevel compressed;
+        compressed.width = getLevelExtent(image.width, level);
+        compressed.height = getLevelExtent(image.height, level);
+        compressed.offset = image.data.size();
+        compressed.size = getCompressedSize(image.format, compressed.width, compressed.height);
+        if (length != compressed.size || offset > size || length > size - offset)
+        {
+            std::cout << "ERROR::COMPRESSED_IMAGE::KTX2_BAD_LEVEL " << level << std::endl;
+            return false;
+        }
+        // stored from the smallest level up: gathered here from the largest down
+        image.data.insert(image.data.end(), bytes + offset, bytes + offset + length);
+        image.levels.push_back(compressed);
+    }
+    return true;
+}
+
+// Basic data format descriptor: how the bits of a block map to channels
+static void appendDataFormatDescriptor(std::vector<unsigned char>& bytes, Block_Format format, bool sRGB)
+{
+    struct Sample
+    {
+        uint32_t channel;
+        uint32_t bitOffset;
+        uint32_t bitLength;
+    };
+    // KHR_DF_MODEL_BC1A... and the channels of each model
+    uint32_t colorModel = 0;
+    Sample samples[2];
+    uint32_t sampleCount = 1;
+    switch (format)
+    {
+    case Block_Format::BC1: colorModel = 128; samples[0] = { 0, 0, 64 }; break;
+    case Block_Format::BC3: colorModel = 130; samples[0] = { 15, 0, 64 }; samples[1] = { 0, 64, 64 }; sampleCount = 2; break;
+    case Block_Format::BC4: colorModel = 131; samples[0] = { 0, 0, 64 }; break;
+    case Block_Format::BC5: colorModel = 132; samples[0] = { 0, 0, 64 }; samples[1] = { 1, 64, 64 }; sampleCount = 2; break;
+    case Block_Format::BC7: colorModel = 134; samples[0] = { 0, 0, 128 }; break;
+    }
+    bool sRGBTransfer = sRGB && format != Block_Format::BC4 && format != Block_Format::BC5;
+
+    uint32_t blockSize = 24 + 16 * sampleCount;
+    // total size, then the single block
+    appendU32(bytes, 4 + blockSize);
+    // vendor 0 (Khronos), descriptor type 0 (basic)
+    appendU32(bytes, 0);
+    // version 2, block size
+    appendU32(bytes, 2 | (blockSize << 16));
+    // model, BT.709 primaries, transfer function (2: sRGB, 1: linear), straight alpha
+    appendU32(bytes, colorModel | (1 << 8) | ((sRGBTransfer ? 2u : 1u) << 16));
+    // 4x4x1x1 texels per block (minus 1)
+    appendU32(bytes, 3 | (3 << 8));
+    // bytes in plane 0, no other plane
+    appendU32(bytes, (uint32_t)getBlockSize(format));
+    appendU32(bytes, 0);
+    for (uint32_t i = 0; i < sampleCount; i++)
+    {
+        // the alpha of an sRGB image stays linear
+        uint32_t qualifiers = sRGBTransfer && samples[i].channel == 15 ? 0x10 : 0;
+        appendU32(bytes, samples[i].bitOffset | ((samples[i].bitLength - 1) << 16) | ((samples[i].channel | qualifiers) << 24));
+        appendU32(bytes, 0);
+        appendU32(bytes, 0);
+        appendU32(bytes, 0xFFFFFFFF);
+    }
+}
+
+bool saveKTX2(const std::string& path, const CompressedImage& image)
+{
+    size_t levelCount = image.levels.size();
+    std::vector<unsigned char> bytes(KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+    appendU32(bytes, toVkFormat(image.format, image.sRGB));
+    // typeSize: 1 for block-compressed formats
+    appendU32(bytes, 1);
+    appendU32(bytes, (uint32_t)image.width);
+    appendU32(bytes, (uint32_t)image.height);
+    // depth, layers, faces
+    appendU32(bytes, 0);
+    appendU32(bytes, 0);
+    appendU32(bytes, 1);
+    appendU32(bytes, (uint32_t)levelCount);
+    // no supercompression
+    appendU32(bytes, 0);
+
+    std::vector<unsigned char> descriptor;
+    appendDataFormatDescriptor(descriptor, image.format, image.sRGB);
+    size_t descriptorOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE;
+    appendU32(bytes, (uint32_t)descriptorOffset);
+    appendU32(bytes, (uint32_t)descriptor.size());
+    // no key/value data, no supercompression global data
+    appendU32(bytes, 0);
+    appendU32(bytes, 0);
+    appendU64(bytes, 0);
+    appendU64(bytes, 0);
+
+    // Levels from the smallest up, each aligned on a block
+    size_t blockSize = getBlockSize(image.format);
+    std::vector<size_t> offsets(levelCount);
+    size_t offset = descriptorOffset + descriptor.size();
+    for (size_t level = levelCount; level-- > 0;)
+    {
+        offset = (offset + blockSize - 1) / blockSize * blockSize;
+        offsets[level] = offset;
+        offset += image.levels[level].size;
+    }
+    for (size_t level = 0; level < levelCount; level++)
+    {
+        appendU64(bytes, offsets[level]);
+        appendU64(bytes, image.levels[level].size);
+        appendU64(bytes, image.levels[level].size);
+    }
+    bytes.insert(bytes.end(), descriptor.begin(), descriptor.end());
+    for (size_t level = levelCount; level-- > 0;)
+    {
+        bytes.resize(offsets[level], 0);
+        const unsigned char* data = image.data.data() + image.levels[level].offset;
+        bytes.insert(bytes.end(), data, data + image.levels[level].size);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)bytes.data(), bytes.size());
+    if (!file)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::FILE_NOT_WRITTEN " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// DDS
+
+static const size_t DDS_HEADER_SIZE = 4 + 124;
+static const size_t DDS_DX10_HEADER_SIZE = 20;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+static const uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+static uint32_t fourCC(const char* code)
+{
+    return readU32((const unsigned char*)code);
+}
+
+static bool fromDXGIFormat(uint32_t dxgiFormat, Block_Format& format, bool& sRGB)
+{
+    switch (dxgiFormat)
+    {
+    case 71: format = Block_Format::BC1; sRGB = false; return true;
+    case 72: format = Block_Format::BC1; sRGB = true; return true;
+    case 77: format = Block_Format::BC3; sRGB = false; return true;
+    case 78: format = Block_Format::BC3; sRGB = true; return true;
+    case 80: format = Block_Format::BC4; sRGB = false; return true;
+    case 83: format = Block_Format::BC5; sRGB = false; return true;
+    case 98: format = Block_Format::BC7; sRGB = false; return true;
+    case 99: format = Block_Format::BC7; sRGB = true; return true;
+    }
+    return false;
+}
+
+static bool parseDDS(const unsigned char* bytes, size_t size, CompressedImage& image)
+{
+    if (size < DDS_HEADER_SIZE)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::DDS_TRUNCATED" << std::endl;
+        return false;
+    }
+
+    uint32_t flags = readU32(bytes + 8);
+    uint32_t height = readU32(bytes + 12);
+    uint32_t width = readU32(bytes + 16);
+    uint32_t levelCount = flags & DDSD_MIPMAPCOUNT ? std::max(1u, readU32(bytes + 28)) : 1;
+    uint32_t pixelFormatFlags = readU32(bytes + 80);
+    uint32_t code = readU32(bytes + 84);
+    uint32_t caps2 = readU32(bytes + 112);
+
+    if ((caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0 || width == 0 || height == 0 || width > 65536 || height > 65536)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::DDS_NOT_2D" << std::endl;
+        return false;
+    }
+
+    size_t dataOffset = DDS_HEADER_SIZE;
+    bool known = false;
+    image.sRGB = false;
+    if ((pixelFormatFlags & DDPF_FOURCC) != 0)
+    {
+        if (code == fourCC("DX10"))
+        {
+            if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+            {
+                std::cout << "ERROR::COMPRESSED_IMAGE::DDS_TRUNCATED" << std::endl;
+                return false;
+            }
+            // dxgiFormat, then the dimension (3: 2D texture) and the array size
+            const unsigned char* extended = bytes + DDS_HEADER_SIZE;
+            known = fromDXGIFormat(readU32(extended), image.format, image.sRGB) && readU32(extended + 4) == 3 && readU32(extended + 12) <= 1;
+            dataOffset += DDS_DX10_HEADER_SIZE;
+        }
+        else if (code == fourCC("DXT1"))
+        {
+            image.format = Block_Format::BC1;
+            known = true;
+        }
+        else if (code == fourCC("DXT5"))
+        {
+            image.format = Block_Format::BC3;
+            known = true;
+        }
+        else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+        {
+            image.format = Block_Format::BC4;
+            known = true;
+        }
+        else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+        {
+            image.format = Block_Format::BC5;
+            known = true;
+        }
+    }
+    if (!known)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::UNSUPPORTED_FORMAT DDS" << std::endl;
+        return false;
+    }
+
+    // Levels from the largest down, one after the other
+    image.width = (int)width;
+    image.height = (int)height;
+    image.levels.clear();
+    size_t offset = 0;
+    for (uint32_t level = 0; level < levelCount && level < 32; level++)
+    {
+        CompressedLevel compressed;
+        compressed.width = getLevelExtent(image.width, level);
+        compressed.height = getLevelExtent(image.height, level);
+        compressed.offset = offset;
+        compressed.size = getCompressedSize(image.format, compressed.width, compressed.height);
+        offset += compressed.size;
+        image.levels.push_back(compressed);
+    }
+    if (offset > size - dataOffset)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::DDS_TRUNCATED" << std::endl;
+        return false;
+    }
+    image.data.assign(bytes + dataOffset, bytes + dataOffset + offset);
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// files
+
+bool parseCompressedImage(const unsigned char* bytes, size_t size, CompressedImage& image)
+{
+    if (size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+        return parseKTX2(bytes, size, image);
+    if (size >= 4 && std::memcmp(bytes, "DDS ", 4) == 0)
+        return parseDDS(bytes, size, image);
+    std::cout << "ERROR::COMPRESSED_IMAGE::UNKNOWN_CONTAINER" << std::endl;
+    return false;
+}
+
+bool loadCompressedImage(const std::string& path, CompressedImage& image)
+{
+    // The levels are copied out of the mapping by the parser
+    MappedFile file(path);
+    if (file.data() == nullptr)
+    {
+        std::cout << "ERROR::COMPRESSED_IMAGE::FILE_NOT_READ " << path << std::endl;
+        return false;
+    }
+    return parseCompressedImage(file.data(), file.size(), image);
+}
@@ -0,0 +1,23 @@
+#include "../header/FrameBlock.h"
+
+// The members are pushed in the exact order of their declaration in frame_block.glsl
+FrameBlock::FrameBlock()
+{
+    m_view = m_buffer.pushMat4();
+    m_projection = m_buffer.pushMat4();
+    m_viewProjection = m_buffer.pushMat4();
+    m_viewPos = m_buffer.pushVec3();
+}
+
+void FrameBlock::setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& viewProjection, const glm::vec3& viewPos)
+{
+    m_buffer.setMat4(m_view, view);
+    m_buffer.setMat4(m_projection, projection);
+    m_buffer.setMat4(m_viewProjection, viewProjection);
+    m_buffer.setVec3(m_viewPos, viewPos);
+}
+
+Std140Buffer& FrameBlock::getBuffer()
+{
+    return m_buffer;
+}
@@ -0,0 +1,261 @@
+#include "../header/Frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+// ------------------------------------------------------------------------
+// planes
+Frustum Frustum::fromMatrix(const glm::mat4& m, bool zeroToOneDepth)
+{
+    // glm is column-major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    Frustum frustum;
+    frustum.planes[PLANE_LEFT] = rows[3] + rows[0];
+    frustum.planes[PLANE_RIGHT] = rows[3] - rows[0];
+    frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+    frustum.planes[PLANE_TOP] = rows[3] - rows[1];
+    // -w <= z (or 0 <= z) and z <= w
+    frustum.planes[PLANE_NEAR] = zeroToOneDepth ? rows[2] : rows[3] + rows[2];
+    frustum.planes[PLANE_FAR] = rows[3] - rows[2];
+
+    for (int i = 0; i < PLANE_COUNT; i++)
+    {
+        glm::vec4& plane = frustum.planes[i];
+        float length = glm::length(glm::vec3(plane));
+        // No normal to divide by: replaced by a plane every point is in front of
+        if (length < 1e-6f)
+            plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            plane /= length;
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (int i = 0; i < PLANE_COUNT; i++)
+    {
+        if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& min, const glm::vec3& max) const
+{
+    // The box is outside a plane when its center is further behind it than the box extends along the normal
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+    for (int i = 0; i < PLANE_COUNT; i++)
+    {
+        glm::vec3 normal(planes[i]);
+        if (glm::dot(normal, center) + planes[i].w < -glm::dot(glm::abs(normal), extent))
+            return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// SoA storage
+void BoundingSphereSoA::resize(size_t count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    radius.resize(count);
+}
+
+size_t BoundingSphereSoA::size() const
+{
+    return x.size();
+}
+
+void BoundingSphereSoA::set(size_t i, const glm::vec3& center, float sphereRadius)
+{
+    x[i] = center.x;
+    y[i] = center.y;
+    z[i] = center.z;
+    radius[i] = sphereRadius;
+}
+
+void BoundingBoxSoA::resize(size_t count)
+{
+    minX.resize(count);
+    minY.resize(count);
+    minZ.resize(count);
+    maxX.resize(count);
+    maxY.resize(count);
+    maxZ.resize(count);
+}
+
+size_t BoundingBoxSoA::size() const
+{
+    return minX.size();
+}
+
+void BoundingBoxSoA::set(size_t i, const glm::vec3& min, const glm::vec3& max)
+{
+    minX[i] = min.x;
+    minY[i] = min.y;
+    minZ[i] = min.z;
+    maxX[i] = max.x;
+    maxY[i] = max.y;
+    maxZ[i] = max.z;
+}
+
+// ------------------------------------------------------------------------
+// batched kernels
+
+// Appends the indices of the set bits of a lane mask (lane j = object first + j)
+static inline uint32_t* writeVisible(uint32_t* out, unsigned int mask, uint32_t first)
+{
+    while (mask != 0)
+    {
+        unsigned int lane = 0;
+        while ((mask & (1u << lane)) == 0)
+            lane++;
+        *out++ = first + lane;
+        mask &= mask - 1;
+    }
+    return out;
+}
+
+size_t cullSpheres(const Frustum& frustum, const BoundingSphereSoA& spheres, std::vector<uint32_t>& visible)
+{
+    size_t count = spheres.size();
+    // Worst case: everything visible, the output is trimmed at the end
+    visible.resize(count);
+    uint32_t* out = visible.data();
+    const float* px = spheres.x.data();
+    const float* py = spheres.y.data();
+    const float* pz = spheres.z.data();
+    const float* pr = spheres.radius.data();
+    const glm::vec4* planes = frustum.planes;
+
+    size_t i = 0;
+
+#if defined(FRUSTUM_AVX)
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(px + i), y = _mm256_loadu_ps(py + i), z = _mm256_loadu_ps(pz + i);
+        __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(pr + i));
+        // All lanes in, then each plane clears the lanes fully behind it
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(planes[p].x)), _mm256_mul_ps(y, _mm256_set1_ps(planes[p].y))),
+                _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(planes[p].z)), _mm256_set1_ps(planes[p].w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+        out = writeVisible(out, (unsigned int)_mm256_movemask_ps(inside), (uint32_t)i);
+    }
+#endif
+
+#if defined(FRUSTUM_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(pr + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p].x)), _mm_mul_ps(y, _mm_set1_ps(planes[p].y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+        out = writeVisible(out, (unsigned int)_mm_movemask_ps(inside), (uint32_t)i);
+    }
+#endif
+
+    // Remaining spheres
+    for (; i < count; i++)
+    {
+        if (frustum.intersectsSphere(glm::vec3(px[i], py[i], pz[i]), pr[i]))
+            *out++ = (uint32_t)i;
+    }
+
+    visible.resize(out - visible.data());
+    return visible.size();
+}
+
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxSoA& boxes, std::vector<uint32_t>& visible)
+{
+    size_t count = boxes.size();
+    visible.resize(count);
+    uint32_t* out = visible.data();
+    const glm::vec4* planes = frustum.planes;
+
+    size_t i = 0;
+
+#if defined(FRUSTUM_AVX)
+    const __m256 half8 = _mm256_set1_ps(0.5f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 minX = _mm256_loadu_ps(boxes.minX.data() + i), maxX = _mm256_loadu_ps(boxes.maxX.data() + i);
+        __m256 minY = _mm256_loadu_ps(boxes.minY.data() + i), maxY = _mm256_loadu_ps(boxes.maxY.data() + i);
+        __m256 minZ = _mm256_loadu_ps(boxes.minZ.data() + i), maxZ = _mm256_loadu_ps(boxes.maxZ.data() + i);
+        __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half8), ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half8);
+        __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half8), ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half8);
+        __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half8), ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half8);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(planes[p].x)), _mm256_mul_ps(cy, _mm256_set1_ps(planes[p].y))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(planes[p].z)), _mm256_set1_ps(planes[p].w)));
+            // Projected half size of the box on the normal
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::fabs(planes[p].x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::fabs(planes[p].y)))),
+                _mm256_mul_ps(ez, _mm256_set1_ps(std::fabs(planes[p].z))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        out = writeVisible(out, (unsigned int)_mm256_movemask_ps(inside), (uint32_t)i);
+    }
+#endif
+
+#if defined(FRUSTUM_SSE)
+    const __m128 half4 = _mm_set1_ps(0.5f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 minX = _mm_loadu_ps(boxes.minX.data() + i), maxX = _mm_loadu_ps(boxes.maxX.data() + i);
+        __m128 minY = _mm_loadu_ps(boxes.minY.data() + i), maxY = _mm_loadu_ps(boxes.maxY.data() + i);
+        __m128 minZ = _mm_loadu_ps(boxes.minZ.data() + i), maxZ = _mm_loadu_ps(boxes.maxZ.data() + i);
+        __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half4), ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half4);
+        __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half4), ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half4);
+        __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half4), ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half4);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PLANE_COUNT; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p].x)), _mm_mul_ps(cy, _mm_set1_ps(planes[p].y))),
+                _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(planes[p].x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(planes[p].y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(std::fabs(planes[p].z))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        out = writeVisible(out, (unsigned int)_mm_movemask_ps(inside), (uint32_t)i);
+    }
+#endif
+
+    // Remaining boxes
+    for (; i < count; i++)
+    {
+        glm::vec3 min(boxes.minX[i], boxes.minY[i], boxes.minZ[i]);
+        glm::vec3 max(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+        if (frustum.intersectsBox(min, max))
+            *out++ = (uint32_t)i;
+    }
+
+    visible.resize(out - visible.data());
+    return visible.size();
+}
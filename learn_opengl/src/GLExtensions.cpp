@@ -0,0 +1,92 @@
+#include "../header/GLExtensions.h"
+
+#include <cstring>
+
+namespace GLExt
+{
+    bool programBinary = false;
+    bool parallelShaderCompile = false;
+    bool multiDrawIndirect = false;
+    bool baseInstance = false;
+    bool clipControl = false;
+    bool textureCompressionS3TC = false;
+    bool textureCompressionBPTC = false;
+
+    PFNGETPROGRAMBINARYPROC GetProgramBinary = nullptr;
+    PFNPROGRAMBINARYPROC ProgramBinary = nullptr;
+    PFNPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+    PFNMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+    PFNCLIPCONTROLPROC ClipControl = nullptr;
+    PFNMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+    PFNDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC DrawElementsInstancedBaseVertexBaseInstance = nullptr;
+
+    bool hasVersion(int major, int minor)
+    {
+        GLint contextMajor = 0;
+        GLint contextMinor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+
+    bool hasExtension(const char* name)
+    {
+        // Core profile: the extension string has to be read one extension at a time
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (extension != nullptr && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    void load(GLADloadproc loader)
+    {
+        // ARB_get_program_binary
+        if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+        {
+            GetProgramBinary = (PFNGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+            ProgramBinary = (PFNPROGRAMBINARYPROC)loader("glProgramBinary");
+            ProgramParameteri = (PFNPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+
+            // A driver may expose the functions but support no binary format at all
+            GLint formatCount = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+            programBinary = GetProgramBinary != nullptr && ProgramBinary != nullptr && ProgramParameteri != nullptr && formatCount > 0;
+        }
+
+        // KHR_parallel_shader_compile (also exposed as ARB_parallel_shader_compile)
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsKHR");
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            MaxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsARB");
+        parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+        if (parallelShaderCompile)
+        {
+            // Let the driver pick how many compiler threads to use
+            MaxShaderCompilerThreads(0xFFFFFFFF);
+        }
+
+        // ARB_base_instance
+        if (hasVersion(4, 2) || hasExtension("GL_ARB_base_instance"))
+            DrawElementsInstancedBaseVertexBaseInstance = (PFNDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)loader("glDrawElementsInstancedBaseVertexBaseInstance");
+        baseInstance = DrawElementsInstancedBaseVertexBaseInstance != nullptr;
+
+        // ARB_multi_draw_indirect (the commands carry a base instance, which it needs too)
+        if (baseInstance && (hasVersion(4, 3) || hasExtension("GL_ARB_multi_draw_indirect")))
+            MultiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+        multiDrawIndirect = MultiDrawElementsIndirect != nullptr;
+
+        // ARB_clip_control
+        if (hasVersion(4, 5) || hasExtension("GL_ARB_clip_control"))
+            ClipControl = (PFNCLIPCONTROLPROC)loader("glClipControl");
+        clipControl = ClipControl != nullptr;
+
+        // Compressed formats: glCompressedTexImage2D is core, only the formats are checked
+        textureCompressionS3TC = hasExtension("GL_EXT_texture_compression_s3tc");
+        textureCompressionBPTC = hasVersion(4, 2) || hasExtension("GL_ARB_texture_compression_bptc");
+    }
+}
@@ -0,0 +1,196 @@
+#include "../header/GLState.h"
+#include "../header/GLExtensions.h"
+
+// Never a valid object name: the binding is unknown
+const GLuint UNKNOWN_BINDING = 0xFFFFFFFF;
+
+GLStateBackend GLStateBackend::openGL()
+{
+    // Wrapped: glad's entry points are only loaded once the context exists
+    GLStateBackend backend;
+    backend.useProgram = [](GLuint program) { glUseProgram(program); };
+    backend.bindVertexArray = [](GLuint vertexArray) { glBindVertexArray(vertexArray); };
+    backend.bindBuffer = [](GLenum target, GLuint buffer) { glBindBuffer(target, buffer); };
+    backend.bindBufferBase = [](GLenum target, GLuint index, GLuint buffer) { glBindBufferBase(target, index, buffer); };
+    backend.activeTexture = [](GLenum unit) { glActiveTexture(unit); };
+    backend.bindTexture = [](GLenum target, GLuint texture) { glBindTexture(target, texture); };
+    return backend;
+}
+
+GLState::GLState(const GLStateBackend& backend) : m_backend(backend), m_issuedCallCount(0), m_savedCallCount(0)
+{
+    invalidate();
+}
+
+GLState& GLState::get()
+{
+    static GLState state;
+    return state;
+}
+
+// ------------------------------------------------------------------------
+// bindings
+void GLState::useProgram(GLuint program)
+{
+    if (change(m_program, program))
+        m_backend.useProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if (!change(m_vertexArray, vertexArray))
+        return;
+    m_backend.bindVertexArray(vertexArray);
+    // The element array buffer is part of the vertex array state
+    m_buffers[getBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN_BINDING;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+    int index = getBufferTargetIndex(target);
+    if (index < 0 || change(m_buffers[index], buffer))
+        m_backend.bindBuffer(target, buffer);
+}
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    // Indexed bindings are set up once, not worth a shadow
+    m_backend.bindBufferBase(target, index, buffer);
+    m_issuedCallCount++;
+    int targetIndex = getBufferTargetIndex(target);
+    if (targetIndex >= 0)
+        m_buffers[targetIndex] = buffer;
+}
+
+void GLState::activeTexture(unsigned int unit)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        m_backend.activeTexture(GL_TEXTURE0 + unit);
+        m_activeTexture = UNKNOWN_BINDING;
+        return;
+    }
+    if (change(m_activeTexture, unit))
+        m_backend.activeTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    int index = getTextureTargetIndex(target);
+    if (index < 0 || m_activeTexture >= MAX_TEXTURE_UNITS || change(m_textures[m_activeTexture][index], texture))
+        m_backend.bindTexture(target, texture);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+    int index = getTextureTargetIndex(target);
+    if (index >= 0 && unit < MAX_TEXTURE_UNITS && m_textures[unit][index] == texture)
+    {
+        m_savedCallCount++;
+        return;
+    }
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+// ------------------------------------------------------------------------
+// deletions
+void GLState::forgetVertexArray(GLuint vertexArray)
+{
+    if (m_vertexArray == vertexArray)
+        m_vertexArray = 0;
+}
+
+void GLState::forgetBuffer(GLuint buffer)
+{
+    for (unsigned int i = 0; i < BUFFER_TARGET_COUNT; i++)
+    {
+        if (m_buffers[i] == buffer)
+            m_buffers[i] = 0;
+    }
+}
+
+void GLState::forgetTexture(GLuint texture)
+{
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (unsigned int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+        {
+            if (m_textures[unit][i] == texture)
+                m_textures[unit][i] = 0;
+        }
+    }
+}
+
+void GLState::invalidate()
+{
+    m_program = UNKNOWN_BINDING;
+    m_vertexArray = UNKNOWN_BINDING;
+    for (unsigned int i = 0; i < BUFFER_TARGET_COUNT; i++)
+        m_buffers[i] = UNKNOWN_BINDING;
+    m_activeTexture = UNKNOWN_BINDING;
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+    {
+        for (unsigned int i = 0; i < TEXTURE_TARGET_COUNT; i++)
+            m_textures[unit][i] = UNKNOWN_BINDING;
+    }
+}
+
+// ------------------------------------------------------------------------
+// statistics
+unsigned int GLState::getIssuedCallCount() const
+{
+    return m_issuedCallCount;
+}
+
+unsigned int GLState::getSavedCallCount() const
+{
+    return m_savedCallCount;
+}
+
+void GLState::resetCallCounts()
+{
+    m_issuedCallCount = 0;
+    m_savedCallCount = 0;
+}
+
+// ------------------------------------------------------------------------
+// helpers
+int GLState::getBufferTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:         return 0;
+    case GL_ELEMENT_ARRAY_BUFFER: return 1;
+    case GL_UNIFORM_BUFFER:       return 2;
+    case GL_COPY_READ_BUFFER:     return 3;
+    case GL_COPY_WRITE_BUFFER:    return 4;
+    case GL_PIXEL_UNPACK_BUFFER:  return 5;
+    case GL_PIXEL_PACK_BUFFER:    return 6;
+    case GL_DRAW_INDIRECT_BUFFER: return 7;
+    default:                      return -1;
+    }
+}
+
+int GLState::getTextureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:       return 0;
+    case GL_TEXTURE_CUBE_MAP: return 1;
+    case GL_TEXTURE_2D_ARRAY: return 2;
+    default:                  return -1;
+    }
+}
+
+bool GLState::change(GLuint& shadow, GLuint value)
+{
+    if (shadow == value)
+    {
+        m_savedCallCount++;
+        return false;
+    }
+    shadow = value;
+    m_issuedCallCount++;
+    return true;
+}
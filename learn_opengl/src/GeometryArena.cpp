@@ -0,0 +1,362 @@
+#include "../header/GeometryArena.h"
+#include "../header/GLState.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Index ranges start on 4 bytes, whatever their type
+const size_t INDEX_ALIGNMENT = 4;
+
+// ------------------------------------------------------------------------
+// free list
+FreeListAllocator::FreeListAllocator(size_t capacity) : m_capacity(0)
+{
+    reset(capacity);
+}
+
+size_t FreeListAllocator::allocate(size_t size, size_t alignment)
+{
+    for (std::map<size_t, size_t>::iterator it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it)
+    {
+        size_t blockOffset = it->first;
+        size_t blockSize = it->second;
+        size_t offset = (blockOffset + alignment - 1) / alignment * alignment;
+        if (offset + size > blockOffset + blockSize)
+            continue;
+
+        // Whatever is left before and after the allocation stays free
+        m_freeBlocks.erase(it);
+        if (offset > blockOffset)
+            m_freeBlocks[blockOffset] = offset - blockOffset;
+        if (offset + size < blockOffset + blockSize)
+            m_freeBlocks[offset + size] = blockOffset + blockSize - (offset + size);
+        return offset;
+    }
+    return INVALID_OFFSET;
+}
+
+void FreeListAllocator::free(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+
+    std::map<size_t, size_t>::iterator block = m_freeBlocks.insert(std::make_pair(offset, size)).first;
+
+    // Merged with the free blocks right after and right before
+    std::map<size_t, size_t>::iterator next = std::next(block);
+    if (next != m_freeBlocks.end() && block->first + block->second == next->first)
+    {
+        block->second += next->second;
+        m_freeBlocks.erase(next);
+    }
+    if (block != m_freeBlocks.begin())
+    {
+        std::map<size_t, size_t>::iterator previous = std::prev(block);
+        if (previous->first + previous->second == block->first)
+        {
+            previous->second += block->second;
+            m_freeBlocks.erase(block);
+        }
+    }
+}
+
+void FreeListAllocator::grow(size_t newCapacity)
+{
+    if (newCapacity <= m_capacity)
+        return;
+    size_t oldCapacity = m_capacity;
+    m_capacity = newCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void FreeListAllocator::reset(size_t capacity)
+{
+    m_capacity = capacity;
+    m_freeBlocks.clear();
+    if (capacity > 0)
+        m_freeBlocks[0] = capacity;
+}
+
+size_t FreeListAllocator::getCapacity() const
+{
+    return m_capacity;
+}
+
+size_t FreeListAllocator::getFreeSize() const
+{
+    size_t freeSize = 0;
+    for (const std::pair<const size_t, size_t>& block : m_freeBlocks)
+        freeSize += block.second;
+    return freeSize;
+}
+
+size_t FreeListAllocator::getLargestFreeBlock() const
+{
+    size_t largest = 0;
+    for (const std::pair<const size_t, size_t>& block : m_freeBlocks)
+        largest = std::max(largest, block.second);
+    return largest;
+}
+
+// ------------------------------------------------------------------------
+// arena
+GeometryArena::GeometryArena(GLsizei vertexStride, std::function<void()> setVertexAttributes, size_t vertexCapacity, size_t indexCapacityBytes)
+    : m_vertexStride(vertexStride), m_setVertexAttributes(setVertexAttributes), m_VAO(0), m_VBO(0), m_EBO(0), 
+    m_vertices(vertexCapacity), m_indices(indexCapacityBytes)
+{
+    createBuffers(vertexCapacity, indexCapacityBytes, m_VBO, m_EBO);
+    glGenVertexArrays(1, &m_VAO);
+    attachBuffers();
+}
+
+void GeometryArena::deleteBuffers()
+{
+    GLState& glState = GLState::get();
+    glState.forgetVertexArray(m_VAO);
+    glState.forgetBuffer(m_VBO);
+    glState.forgetBuffer(m_EBO);
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_EBO);
+    m_VAO = m_VBO = m_EBO = 0;
+}
+
+// The buffers are filled through the copy targets: binding GL_ELEMENT_ARRAY_BUFFER would modify whatever VAO is bound
+void GeometryArena::createBuffers(size_t vertexCapacity, size_t indexCapacityBytes, GLuint& VBO, GLuint& EBO) const
+{
+    GLState& glState = GLState::get();
+    glGenBuffers(1, &VBO);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * m_vertexStride, NULL, GL_STATIC_DRAW);
+    glGenBuffers(1, &EBO);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacityBytes, NULL, GL_STATIC_DRAW);
+}
+
+// Points the VAO to the current buffers (again after they are replaced)
+void GeometryArena::attachBuffers()
+{
+    GLState& glState = GLState::get();
+    glState.bindVertexArray(m_VAO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    m_setVertexAttributes();
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    // unbound so that later buffer binds cannot modify it
+    glState.bindVertexArray(0);
+}
+
+GeometryHandle GeometryArena::allocate(const void* vertices, size_t vertexCount, const CompactIndices& indices)
+{
+    Allocation allocation;
+    allocation.live = true;
+    allocation.vertexCount = vertexCount;
+    allocation.indexSize = indices.data.size();
+    allocation.indexType = indices.type;
+    allocation.ranges = indices.ranges;
+
+    allocation.vertexOffset = m_vertices.allocate(vertexCount);
+    if (allocation.vertexOffset == FreeListAllocator::INVALID_OFFSET)
+    {
+        growVertices(m_vertices.getCapacity() + vertexCount);
+        allocation.vertexOffset = m_vertices.allocate(vertexCount);
+    }
+    allocation.indexOffset = m_indices.allocate(allocation.indexSize, INDEX_ALIGNMENT);
+    if (allocation.indexOffset == FreeListAllocator::INVALID_OFFSET)
+    {
+        growIndices(m_indices.getCapacity() + allocation.indexSize + INDEX_ALIGNMENT);
+        allocation.indexOffset = m_indices.allocate(allocation.indexSize, INDEX_ALIGNMENT);
+    }
+
+    GLState& glState = GLState::get();
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, m_VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * m_vertexStride, vertexCount * m_vertexStride, vertices);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, allocation.indexSize, indices.data.data());
+
+    GeometryHandle handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+        m_allocations[handle] = allocation;
+    }
+    else
+    {
+        handle = (GeometryHandle)m_allocations.size();
+        m_allocations.push_back(allocation);
+    }
+    return handle;
+}
+
+void GeometryArena::free(GeometryHandle handle)
+{
+    Allocation& allocation = m_allocations[handle];
+    if (!allocation.live)
+        return;
+    m_vertices.free(allocation.vertexOffset, allocation.vertexCount);
+    m_indices.free(allocation.indexOffset, allocation.indexSize);
+    allocation.live = false;
+    allocation.ranges.clear();
+    m_freeHandles.push_back(handle);
+}
+
+void GeometryArena::bind() const
+{
+    GLState::get().bindVertexArray(m_VAO);
+}
+
+void GeometryArena::draw(GeometryHandle handle, GLenum mode) const
+{
+    const Allocation& allocation = m_allocations[handle];
+    for (const IndexRange& range : allocation.ranges)
+    {
+        glDrawElementsBaseVertex(mode, range.count, allocation.indexType, (void*)(allocation.indexOffset + range.byteOffset),
+            (GLint)(allocation.vertexOffset + range.baseVertex));
+    }
+}
+
+GLenum GeometryArena::getIndexType(GeometryHandle handle) const
+{
+    return m_allocations[handle].indexType;
+}
+
+void GeometryArena::appendDrawCommands(GeometryHandle handle, GLuint instanceCount, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) const
+{
+    const Allocation& allocation = m_allocations[handle];
+    size_t indexSize = allocation.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    for (const IndexRange& range : allocation.ranges)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = (GLuint)range.count;
+        command.instanceCount = instanceCount;
+        command.firstIndex = (GLuint)((allocation.indexOffset + range.byteOffset) / indexSize);
+        command.baseVertex = (GLint)(allocation.vertexOffset + range.baseVertex);
+        command.baseInstance = baseInstance;
+        commands.push_back(command);
+    }
+}
+
+// ------------------------------------------------------------------------
+// growth and defragmentation
+
+// Copied on the GPU into a buffer twice as large: the handles keep their offsets
+void GeometryArena::growVertices(size_t minimumCapacity)
+{
+    size_t oldCapacity = m_vertices.getCapacity();
+    size_t newCapacity = std::max(oldCapacity * 2, minimumCapacity);
+
+    GLState& glState = GLState::get();
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * m_vertexStride, NULL, GL_STATIC_DRAW);
+    glState.bindBuffer(GL_COPY_READ_BUFFER, m_VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity * m_vertexStride);
+
+    glState.forgetBuffer(m_VBO);
+    glDeleteBuffers(1, &m_VBO);
+    m_VBO = VBO;
+    m_vertices.grow(newCapacity);
+    attachBuffers();
+}
+
+void GeometryArena::growIndices(size_t minimumCapacityBytes)
+{
+    size_t oldCapacity = m_indices.getCapacity();
+    size_t newCapacity = std::max(oldCapacity * 2, minimumCapacityBytes);
+
+    GLState& glState = GLState::get();
+    GLuint EBO;
+    glGenBuffers(1, &EBO);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, NULL, GL_STATIC_DRAW);
+    glState.bindBuffer(GL_COPY_READ_BUFFER, m_EBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldCapacity);
+
+    glState.forgetBuffer(m_EBO);
+    glDeleteBuffers(1, &m_EBO);
+    m_EBO = EBO;
+    m_indices.grow(newCapacity);
+    attachBuffers();
+}
+
+// glCopyBufferSubData cannot move overlapping ranges within one buffer: the live ranges are 
+// copied, in order, to the start of new buffers of the same size
+void GeometryArena::defragment()
+{
+    GLuint VBO, EBO;
+    createBuffers(m_vertices.getCapacity(), m_indices.getCapacity(), VBO, EBO);
+
+    std::vector<GeometryHandle> order;
+    for (GeometryHandle handle = 0; handle < m_allocations.size(); handle++)
+    {
+        if (m_allocations[handle].live)
+            order.push_back(handle);
+    }
+    std::sort(order.begin(), order.end(), [this](GeometryHandle a, GeometryHandle b)
+    {
+        return m_allocations[a].vertexOffset < m_allocations[b].vertexOffset;
+    });
+
+    GLState& glState = GLState::get();
+    size_t vertexEnd = 0;
+    size_t indexEnd = 0;
+    for (GeometryHandle handle : order)
+    {
+        Allocation& allocation = m_allocations[handle];
+        glState.bindBuffer(GL_COPY_READ_BUFFER, m_VBO);
+        glState.bindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.vertexOffset * m_vertexStride, 
+            vertexEnd * m_vertexStride, allocation.vertexCount * m_vertexStride);
+        allocation.vertexOffset = vertexEnd;
+        vertexEnd += allocation.vertexCount;
+
+        glState.bindBuffer(GL_COPY_READ_BUFFER, m_EBO);
+        glState.bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.indexOffset, indexEnd, allocation.indexSize);
+        allocation.indexOffset = indexEnd;
+        indexEnd = (indexEnd + allocation.indexSize + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT;
+    }
+
+    glState.forgetBuffer(m_VBO);
+    glState.forgetBuffer(m_EBO);
+    glDeleteBuffers(1, &m_VBO);
+    glDeleteBuffers(1, &m_EBO);
+    m_VBO = VBO;
+    m_EBO = EBO;
+    attachBuffers();
+
+    // All the free space is now one block at the end
+    m_vertices.reset(m_vertices.getCapacity());
+    m_vertices.allocate(vertexEnd);
+    m_indices.reset(m_indices.getCapacity());
+    m_indices.allocate(indexEnd);
+}
+
+float GeometryArena::getFragmentation() const
+{
+    size_t freeSize = m_vertices.getFreeSize();
+    if (freeSize == 0)
+        return 0.0f;
+    return 1.0f - (float)m_vertices.getLargestFreeBlock() / freeSize;
+}
+
+GLuint GeometryArena::getVertexArray() const
+{
+    return m_VAO;
+}
+
+GLsizei GeometryArena::getVertexStride() const
+{
+    return m_vertexStride;
+}
+
+size_t GeometryArena::getVertexBytes() const
+{
+    return m_vertices.getCapacity() * m_vertexStride;
+}
+
+size_t GeometryArena::getIndexBytes() const
+{
+    return m_indices.getCapacity();
+}
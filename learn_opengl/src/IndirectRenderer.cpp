@@ -0,0 +1,134 @@
+#include "../header/IndirectRenderer.h"
+#include "../header/GLExtensions.h"
+#include "../header/GLState.h"
+
+IndirectRenderer::IndirectRenderer(GeometryArena& arena, GLsizei capacity, bool withNormalMatrix)
+    : m_arena(arena), m_withNormalMatrix(withNormalMatrix), m_instances(capacity), m_commandBuffer(0), m_commandCapacity(0), 
+    m_lastGeometry(INVALID_GEOMETRY), m_lastCommandCount(0), m_drawCallCount(0)
+{
+    if (GLExt::multiDrawIndirect)
+        glGenBuffers(1, &m_commandBuffer);
+}
+
+void IndirectRenderer::deleteBuffers()
+{
+    GLState::get().forgetBuffer(m_instances.m_ID);
+    glDeleteBuffers(1, &m_instances.m_ID);
+    if (m_commandBuffer != 0)
+    {
+        GLState::get().forgetBuffer(m_commandBuffer);
+        glDeleteBuffers(1, &m_commandBuffer);
+        m_commandBuffer = 0;
+    }
+}
+
+void IndirectRenderer::clear()
+{
+    m_instanceData.clear();
+    m_commands16.clear();
+    m_commands32.clear();
+    m_lastGeometry = INVALID_GEOMETRY;
+    m_lastCommandCount = 0;
+}
+
+void IndirectRenderer::add(GeometryHandle geometry, const InstanceData& instance)
+{
+    std::vector<DrawElementsIndirectCommand>& commands = m_arena.getIndexType(geometry) == GL_UNSIGNED_SHORT ? m_commands16 : m_commands32;
+    m_instanceData.push_back(instance);
+
+    // Same mesh as the previous object: its instance follows, one more instance of the same commands
+    if (geometry == m_lastGeometry)
+    {
+        for (size_t i = commands.size() - m_lastCommandCount; i < commands.size(); i++)
+            commands[i].instanceCount++;
+        return;
+    }
+
+    size_t commandCount = commands.size();
+    m_arena.appendDrawCommands(geometry, 1, (GLuint)(m_instanceData.size() - 1), commands);
+    m_lastGeometry = geometry;
+    m_lastCommandCount = commands.size() - commandCount;
+}
+
+void IndirectRenderer::submit(GLenum mode)
+{
+    m_drawCallCount = 0;
+    if (m_instanceData.empty())
+        return;
+
+    m_instances.upload(m_instanceData);
+    // Re-attached on every submit (a few calls, whatever the object count): 
+    // several renderers can then share the VAO of an arena
+    m_instances.attach(m_arena.getVertexArray(), m_withNormalMatrix);
+    if (GLExt::multiDrawIndirect)
+        uploadCommands();
+
+    m_arena.bind();
+    drawCommands(mode, GL_UNSIGNED_SHORT, m_commands16, 0);
+    drawCommands(mode, GL_UNSIGNED_INT, m_commands32, m_commands16.size() * sizeof(DrawElementsIndirectCommand));
+}
+
+// ------------------------------------------------------------------------
+// draws
+void IndirectRenderer::uploadCommands()
+{
+    size_t commandCount = m_commands16.size() + m_commands32.size();
+    size_t size16 = m_commands16.size() * sizeof(DrawElementsIndirectCommand);
+    size_t size32 = m_commands32.size() * sizeof(DrawElementsIndirectCommand);
+
+    GLState::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    if (commandCount > m_commandCapacity)
+        m_commandCapacity = commandCount;
+    // Orphan the previous storage, like the instance buffer
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size16, m_commands16.data());
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, size16, size32, m_commands32.data());
+}
+
+void IndirectRenderer::drawCommands(GLenum mode, GLenum type, const std::vector<DrawElementsIndirectCommand>& commands, size_t bufferOffset)
+{
+    if (commands.empty())
+        return;
+
+    if (GLExt::multiDrawIndirect)
+    {
+        GLState::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+        GLExt::MultiDrawElementsIndirect(mode, type, (void*)bufferOffset, (GLsizei)commands.size(), 0);
+        m_drawCallCount++;
+        return;
+    }
+
+    size_t indexSize = type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    for (const DrawElementsIndirectCommand& command : commands)
+    {
+        void* indices = (void*)(command.firstIndex * indexSize);
+        if (GLExt::baseInstance)
+        {
+            GLExt::DrawElementsInstancedBaseVertexBaseInstance(mode, command.count, type, indices, command.instanceCount, 
+                command.baseVertex, command.baseInstance);
+        }
+        else
+        {
+            // The instance attributes are moved to the first instance of the command instead
+            m_instances.attach(m_arena.getVertexArray(), m_withNormalMatrix, command.baseInstance);
+            m_arena.bind();
+            glDrawElementsInstancedBaseVertex(mode, command.count, type, indices, command.instanceCount, command.baseVertex);
+        }
+        m_drawCallCount++;
+    }
+}
+
+GLsizei IndirectRenderer::getObjectCount() const
+{
+    return (GLsizei)m_instanceData.size();
+}
+
+GLsizei IndirectRenderer::getCommandCount() const
+{
+    return (GLsizei)(m_commands16.size() + m_commands32.size());
+}
+
+unsigned int IndirectRenderer::getDrawCallCount() const
+{
+    return m_drawCallCount;
+}
@@ -0,0 +1,67 @@
+#include "../header/InstanceBuffer.h"
+#include "../header/GLState.h"
+
+#include <cstddef>
+
+InstanceBuffer::InstanceBuffer(GLsizei capacity) : m_capacity(capacity), m_count(0)
+{
+    glGenBuffers(1, &m_ID);
+    GLState::get().bindBuffer(GL_ARRAY_BUFFER, m_ID);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+}
+
+void InstanceBuffer::attach(GLuint VAO, bool withNormalMatrix, GLsizei firstInstance) const
+{
+    size_t firstOffset = (size_t)firstInstance * sizeof(InstanceData);
+
+    GLState::get().bindVertexArray(VAO);
+    GLState::get().bindBuffer(GL_ARRAY_BUFFER, m_ID);
+
+    // A matrix attribute is set up as one vec4 (or vec3) attribute per column.
+    // Divisor 1: the attribute advances once per instance instead of once per vertex.
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(firstOffset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+
+    if (withNormalMatrix)
+    {
+        for (GLuint column = 0; column < 3; column++)
+        {
+            GLuint location = INSTANCE_NORMAL_MATRIX_LOCATION + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(firstOffset + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+            glVertexAttribDivisor(location, 1);
+        }
+    }
+
+    // Unbound so that later buffer binds cannot modify it
+    GLState::get().bindVertexArray(0);
+}
+
+void InstanceBuffer::upload(const std::vector<InstanceData>& instances)
+{
+    m_count = (GLsizei)instances.size();
+
+    GLState::get().bindBuffer(GL_ARRAY_BUFFER, m_ID);
+    if (m_count > m_capacity)
+    {
+        // The VAOs keep referencing the same buffer name, so they do not need to be set up again
+        m_capacity = m_count;
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_capacity * sizeof(InstanceData), instances.data(), GL_DYNAMIC_DRAW);
+    }
+    else
+    {
+        // Orphan the previous storage: the driver hands out a fresh one instead of waiting for the draws still reading it
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)m_count * sizeof(InstanceData), instances.data());
+    }
+}
+
+GLsizei InstanceBuffer::getCount() const
+{
+    return m_count;
+}
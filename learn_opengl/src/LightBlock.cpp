@@ -0,0 +1,83 @@
+#include "../header/LightBlock.h"
+
+// The members are pushed in the exact order of their declaration in lighting.glsl
+LightBlock::LightBlock()
+{
+    // DirLight dirLight;
+    m_buffer.beginStruct();
+    m_dirLight.direction = m_buffer.pushVec3();
+    m_dirLight.ambient = m_buffer.pushVec3();
+    m_dirLight.diffuse = m_buffer.pushVec3();
+    m_dirLight.specular = m_buffer.pushVec3();
+    m_buffer.endStruct();
+
+    // PointLight pointLights[MAX_POINT_LIGHTS];
+    for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++)
+    {
+        m_buffer.beginStruct();
+        m_pointLights[i].position = m_buffer.pushVec3();
+        m_pointLights[i].constant = m_buffer.pushFloat();
+        m_pointLights[i].linear = m_buffer.pushFloat();
+        m_pointLights[i].quadratic = m_buffer.pushFloat();
+        m_pointLights[i].ambient = m_buffer.pushVec3();
+        m_pointLights[i].diffuse = m_buffer.pushVec3();
+        m_pointLights[i].specular = m_buffer.pushVec3();
+        m_buffer.endStruct();
+    }
+
+    // SpotLight spotLight;
+    m_buffer.beginStruct();
+    m_spotLight.position = m_buffer.pushVec3();
+    m_spotLight.direction = m_buffer.pushVec3();
+    m_spotLight.cutOff = m_buffer.pushFloat();
+    m_spotLight.outerCutOff = m_buffer.pushFloat();
+    m_spotLight.constant = m_buffer.pushFloat();
+    m_spotLight.linear = m_buffer.pushFloat();
+    m_spotLight.quadratic = m_buffer.pushFloat();
+    m_spotLight.ambient = m_buffer.pushVec3();
+    m_spotLight.diffuse = m_buffer.pushVec3();
+    m_spotLight.specular = m_buffer.pushVec3();
+    m_buffer.endStruct();
+}
+
+void LightBlock::setDirLight(const DirLight& light)
+{
+    m_buffer.setVec3(m_dirLight.direction, light.direction);
+    m_buffer.setVec3(m_dirLight.ambient, light.ambient);
+    m_buffer.setVec3(m_dirLight.diffuse, light.diffuse);
+    m_buffer.setVec3(m_dirLight.specular, light.specular);
+}
+
+void LightBlock::setPointLight(unsigned int index, const PointLight& light)
+{
+    if (index >= MAX_POINT_LIGHTS)
+        return;
+
+    const PointLightOffsets& offsets = m_pointLights[index];
+    m_buffer.setVec3(offsets.position, light.position);
+    m_buffer.setFloat(offsets.constant, light.constant);
+    m_buffer.setFloat(offsets.linear, light.linear);
+    m_buffer.setFloat(offsets.quadratic, light.quadratic);
+    m_buffer.setVec3(offsets.ambient, light.ambient);
+    m_buffer.setVec3(offsets.diffuse, light.diffuse);
+    m_buffer.setVec3(offsets.specular, light.specular);
+}
+
+void LightBlock::setSpotLight(const SpotLight& light)
+{
+    m_buffer.setVec3(m_spotLight.position, light.position);
+    m_buffer.setVec3(m_spotLight.direction, light.direction);
+    m_buffer.setFloat(m_spotLight.cutOff, light.cutOff);
+    m_buffer.setFloat(m_spotLight.outerCutOff, light.outerCutOff);
+    m_buffer.setFloat(m_spotLight.constant, light.constant);
+    m_buffer.setFloat(m_spotLight.linear, light.linear);
+    m_buffer.setFloat(m_spotLight.quadratic, light.quadratic);
+    m_buffer.setVec3(m_spotLight.ambient, light.ambient);
+    m_buffer.setVec3(m_spotLight.diffuse, light.diffuse);
+    m_buffer.setVec3(m_spotLight.specular, light.specular);
+}
+
+Std140Buffer& LightBlock::getBuffer()
+{
+    return m_buffer;
+}
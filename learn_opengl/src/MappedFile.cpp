@@ -0,0 +1,180 @@
+#include "../header/MappedFile.h"
+#include "../header/stb_image.h"
+
+#include <climits>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : m_data(nullptr), m_size(0), m_open(false)
+{
+}
+
+MappedFile::MappedFile(const std::string& path)
+    : m_data(nullptr), m_size(0), m_open(false)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size))
+    {
+        // An empty file cannot be mapped, it is still open
+        if (size.QuadPart == 0)
+            m_open = true;
+        // The view keeps the mapping (and the file) alive: both handles can go
+        HANDLE mapping = size.QuadPart != 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        if (mapping != NULL)
+        {
+            m_data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            m_size = m_data != nullptr ? (size_t)size.QuadPart : 0;
+            m_open = m_data != nullptr;
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+    struct stat status;
+    bool known = fstat(file, &status) == 0;
+    if (known && status.st_size == 0)
+    {
+        // An empty file cannot be mapped, it is still open
+        m_open = true;
+    }
+    else if (known && status.st_size > 0)
+    {
+        // The mapping keeps the file alive: the descriptor can go
+        void* mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapped != MAP_FAILED)
+        {
+            m_data = (const unsigned char*)mapped;
+            m_size = (size_t)status.st_size;
+            m_open = true;
+            // Decoders read front to back: a larger read-ahead
+            madvise(mapped, m_size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_open(other.m_open)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_open = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_open, other.m_open);
+    }
+    return *this;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap((void*)m_data, m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+bool MappedFile::isOpen() const
+{
+    return m_open;
+}
+
+const unsigned char* MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+void MappedFile::prefetch() const
+{
+    if (m_data == nullptr)
+        return;
+#ifdef _WIN32
+    // Windows 8+: looked up at runtime so that the app still starts on older versions
+    typedef BOOL (WINAPI *PrefetchVirtualMemoryProc)(HANDLE, ULONG_PTR, PVOID, ULONG);
+    struct MemoryRange
+    {
+        PVOID address;
+        SIZE_T size;
+    };
+    static PrefetchVirtualMemoryProc prefetchVirtualMemory =
+        (PrefetchVirtualMemoryProc)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+    if (prefetchVirtualMemory != nullptr)
+    {
+        MemoryRange range = { (PVOID)m_data, m_size };
+        prefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    madvise((void*)m_data, m_size, MADV_WILLNEED);
+#endif
+}
+
+// ------------------------------------------------------------------------
+// batches and images
+
+std::vector<MappedFile> mapFiles(const std::vector<std::string>& paths, bool prefetch)
+{
+    std::vector<MappedFile> files;
+    files.reserve(paths.size());
+    for (const std::string& path : paths)
+        files.push_back(MappedFile(path));
+    // Only once every file is mapped: the requests all reach the disk queue before the first is needed
+    if (prefetch)
+    {
+        for (const MappedFile& file : files)
+            file.prefetch();
+    }
+    return files;
+}
+
+unsigned char* loadImageMapped(const std::string& path, int* width, int* height, int* components, int requiredComponents)
+{
+    MappedFile file(path);
+    // stbi takes an int length
+    if (file.data() == nullptr || file.size() > (size_t)INT_MAX)
+        return nullptr;
+    return stbi_load_from_memory(file.data(), (int)file.size(), width, height, components, requiredComponents);
+}
@@ -6,9 +6,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "../header/shader.h"
+#include "../header/CompactIndices.h"
+#include "../header/GeometryArena.h"
+#include "../header/GLState.h"
+#include "../header/MeshOptimizer.h"
+#include "../header/PackedVertex.h"
+#include "../header/Shader.h"
 
+#include <cstddef>
+#include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -28,10 +36,29 @@ struct Texture
     std::string path;
 };
 
+struct MeshOptions
+{
+    // Keep the vertices and indices in RAM after the upload. Only needed to read the geometry 
+    // back on the CPU (picking, physics...): otherwise the GPU copy is the only one worth keeping.
+    bool keepCpuData = true;
+    // Upload the vertices in the compact layout of PackedVertex (20 bytes instead of 56). The shaders 
+    // read a vec4 octahedral normal (1) and tangent (3, bitangent sign in w), and no bitangent (4).
+    bool packVertices = false;
+    // Reorder the triangles for the vertex cache and against overdraw, then the vertices in order 
+    // of use (see MeshOptimizer). Done once at load time, the ACMR/ATVR gains are in the report
+    // (printMeshOptimizationReport). Opt-in: the kept vertices change order and the unreferenced ones
+    // are dropped, which breaks any data indexed by vertex number outside the mesh.
+    bool optimizeIndices = false;
+    // Suballocate the vertices and indices in a shared arena instead of buffers of the mesh. The arena 
+    // stride must match the layout: sizeof(PackedVertex) with packVertices, sizeof(Vertex) otherwise.
+    // The arena must outlive the mesh.
+    GeometryArena* arena = nullptr;
+};
+
 class Mesh 
 {
 public:
-    // mesh Data
+    // mesh Data (vertices and indices are empty once released, see MeshOptions)
     std::vector<Vertex>       vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture>      textures;
@@ -39,30 +66,213 @@ public:
     unsigned int VAO;
 
     // constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+    // The vectors are moved in: pass them with std::move (or as temporaries) and a large model 
+    // is never copied. Passing lvalues still works, at the cost of one copy.
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, const MeshOptions& options = MeshOptions())
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        if (options.optimizeIndices)
+            optimizationReport = optimizeMesh(this->vertices, this->indices, offsetof(Vertex, Position));
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(options.packVertices, options.arena);
+        nameSamplers();
+
+        if (!options.keepCpuData)
+            releaseCpuData();
+    }
+
+    // Gives its range back to the arena (the arena must still be alive)
+    ~Mesh()
+    {
+        releaseGeometry();
+    }
+
+    // Movable (e.g. into a std::vector<Mesh>), not copyable: copies would share the buffer objects.
+    // The moved-from mesh no longer holds the arena range, only the new one frees it.
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept
+        : arena(nullptr), geometry(INVALID_GEOMETRY)
+    {
+        moveFrom(other);
+    }
+    Mesh& operator=(Mesh&& other) noexcept
+    {
+        if (this != &other)
+        {
+            releaseGeometry();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    // Frees the CPU copy of the vertices and indices, the mesh still draws from its buffers.
+    // Given vectors receive the data instead (moved, not copied), to stream it to a cache file for instance.
+    void releaseCpuData(std::vector<Vertex>* vertices = nullptr, std::vector<unsigned int>* indices = nullptr)
+    {
+        // swap with an empty vector: clear() alone keeps the capacity allocated
+        std::vector<Vertex> releasedVertices;
+        std::vector<unsigned int> releasedIndices;
+        releasedVertices.swap(this->vertices);
+        releasedIndices.swap(this->indices);
+        if (vertices != nullptr)
+            *vertices = std::move(releasedVertices);
+        if (indices != nullptr)
+            *indices = std::move(releasedIndices);
+    }
+
+    // Bytes held in RAM by the vertices and indices (0 once released)
+    size_t getCpuDataSize() const
+    {
+        return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    }
+
+    // Sizes and errors of the packed vertices (empty if the vertices are not packed)
+    const VertexPackingReport& getPackingReport() const
+    {
+        return packingReport;
+    }
+
+    // Vertex cache efficiency before and after the index optimization (zero if not optimized)
+    const MeshOptimizationReport& getOptimizationReport() const
+    {
+        return optimizationReport;
+    }
+
+    // Bytes of the index buffer on the GPU (half of the 32-bit size when the indices fit in 16 bits)
+    size_t getIndexBufferSize() const
+    {
+        return indexBufferSize;
+    }
+
+    // Full-float layout of Vertex, for the current VAO and vertex buffer (also the attribute setup of a Vertex arena)
+    static void setVertexAttributes()
+    {
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
     }
 
     // render the mesh
     void Draw(Shader& shader)
     {
-        // bind appropriate textures. Nr = "number"
+        // sampler handles of this shader, resolved on the first draw with it
+        const std::vector<UniformHandle>& samplers = getSamplerHandles(shader);
+
+        unsigned int textureCount = textures.size() < MAX_TEXTURE_UNITS ? (unsigned int)textures.size() : MAX_TEXTURE_UNITS;
+        for (unsigned int i = 0; i < textureCount; i++)
+        {
+            // the program keeps the unit of its samplers: only the first draw (or a relink) sends it
+            shader.setSampler(samplers[i], i);
+
+            // and bind the texture (the unit is only activated if it does not hold it already)
+            GLState::get().bindTexture(i, GL_TEXTURE_2D, textures[i].id);
+        }
+
+        // draw mesh
+        // Nothing is unbound afterwards: every bind goes through GLState, which knows what is bound.
+        // The meshes of an arena share its VAO, only the first of them binds it.
+        if (arena != nullptr)
+        {
+            arena->bind();
+            arena->draw(geometry);
+            return;
+        }
+        GLState::get().bindVertexArray(VAO);
+        // 16-bit indices when they fit, in several ranges for the largest meshes
+        drawIndexRanges(GL_TRIANGLES, indexType, indexRanges);
+    }
+
+private:
+    // render data (own buffers, or a range of an arena)
+    unsigned int VBO, EBO;
+    GeometryArena* arena;
+    GeometryHandle geometry;
+    // kept apart from the indices, which may be released
+    GLenum indexType;
+    std::vector<IndexRange> indexRanges;
+    size_t indexBufferSize;
+    VertexPackingReport packingReport;
+    MeshOptimizationReport optimizationReport;
+
+    // Sampler uniform of each texture ("texture_diffuse1"...), named once at setup
+    std::vector<std::string> samplerNames;
+    // Their handles in every shader the mesh was drawn with (a mesh meets a handful of shaders at most)
+    std::vector<std::pair<const Shader*, std::vector<UniformHandle>>> shaderSamplers;
+
+    // OpenGL 3.3 guarantees 16 units per stage, the meshes never use more
+    static const unsigned int MAX_TEXTURE_UNITS = GLState::MAX_TEXTURE_UNITS;
+
+    void releaseGeometry()
+    {
+        if (arena != nullptr && geometry != INVALID_GEOMETRY)
+            arena->free(geometry);
+        arena = nullptr;
+        geometry = INVALID_GEOMETRY;
+    }
+
+    void moveFrom(Mesh& other)
+    {
+        vertices = std::move(other.vertices);
+        indices = std::move(other.indices);
+        textures = std::move(other.textures);
+        VAO = other.VAO;
+        VBO = other.VBO;
+        EBO = other.EBO;
+        arena = other.arena;
+        geometry = other.geometry;
+        indexType = other.indexType;
+        indexRanges = std::move(other.indexRanges);
+        indexBufferSize = other.indexBufferSize;
+        packingReport = other.packingReport;
+        optimizationReport = other.optimizationReport;
+        samplerNames = std::move(other.samplerNames);
+        shaderSamplers = std::move(other.shaderSamplers);
+        // The range belongs to this mesh now
+        other.arena = nullptr;
+        other.geometry = INVALID_GEOMETRY;
+    }
+
+    const std::vector<UniformHandle>& getSamplerHandles(Shader& shader)
+    {
+        for (const std::pair<const Shader*, std::vector<UniformHandle>>& entry : shaderSamplers)
+        {
+            if (entry.first == &shader)
+                return entry.second;
+        }
+
+        std::vector<UniformHandle> handles;
+        for (const std::string& name : samplerNames)
+            handles.push_back(shader.getUniformHandle(name));
+        shaderSamplers.push_back(std::make_pair(&shader, handles));
+        return shaderSamplers.back().second;
+    }
+
+    // Sampler names follow the texture types: texture_diffuseN, texture_specularN, texture_normalN, texture_heightN
+    void nameSamplers()
+    {
+        // Nr = "number"
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
-        
+
+        samplerNames.clear();
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            // select active texture unit before binding
-            glActiveTexture(GL_TEXTURE0 + i);
-            
             // retrieve texture number (the N in diffuse_textureN)
             std::string number;
             std::string name = textures[i].type;
@@ -76,62 +286,69 @@ public:
             else if (name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.m_ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(name + number);
         }
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(bool packVertices, GeometryArena* sharedArena)
     {
+        // A great thing about structs is that their memory layout is sequential for all its items.
+        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+        // again translates to 3/2 floats which translates to a byte array.
+        std::vector<PackedVertex> packedVertices;
+        const void* vertexData = vertices.data();
+        GLsizei vertexStride = sizeof(Vertex);
+        if (packVertices)
+        {
+            packedVertices.reserve(vertices.size());
+            packingReport.unpackedBytes = vertices.size() * sizeof(Vertex);
+            for (const Vertex& vertex : vertices)
+                packedVertices.push_back(packVertex(vertex.Position, vertex.Normal, vertex.TexCoords, vertex.Tangent, vertex.Bitangent, &packingReport));
+            vertexData = packedVertices.data();
+            vertexStride = sizeof(PackedVertex);
+        }
+
+        // the CPU copy keeps 32-bit indices, the GPU one is as narrow as possible
+        CompactIndices compact = compactIndices(indices);
+        indexType = compact.type;
+        indexRanges = compact.ranges;
+        indexBufferSize = compact.data.size();
+
+        arena = nullptr;
+        geometry = INVALID_GEOMETRY;
+        VAO = VBO = EBO = 0;
+        if (sharedArena != nullptr)
+        {
+            if (sharedArena->getVertexStride() == vertexStride)
+            {
+                arena = sharedArena;
+                geometry = arena->allocate(vertexData, vertices.size(), compact);
+                return;
+            }
+            std::cout << "ERROR::MESH::ARENA_STRIDE_MISMATCH " << sharedArena->getVertexStride() << " != " << vertexStride << std::endl;
+        }
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        GLState::get().bindVertexArray(VAO);
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        GLState::get().bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * vertexStride, vertexData, GL_STATIC_DRAW);
+        GLState::get().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, compact.data.size(), compact.data.data(), GL_STATIC_DRAW);
 
         // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        if (packVertices)
+            setPackedVertexAttributes(true);
+        else
+            setVertexAttributes();
 
-        glBindVertexArray(0);
+        // unbound so that later buffer binds cannot modify it
+        GLState::get().bindVertexArray(0);
     }
 };
 #endif
@@ -0,0 +1,322 @@
+#include "../header/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Forsyth's scoring ("Linear-speed vertex cache optimisation"), with his published constants
+const unsigned int FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// Clusters smaller than this are not worth sorting on their own
+const size_t MIN_CLUSTER_TRIANGLES = 8;
+
+// ------------------------------------------------------------------------
+// cache simulator
+VertexCacheStats simulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty())
+        return stats;
+
+    // FIFO: a vertex is still cached as long as less than cacheSize vertices were loaded after it
+    std::vector<unsigned int> loadTimes(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    unsigned int time = cacheSize + 1;
+    size_t misses = 0;
+    size_t referencedCount = 0;
+    for (unsigned int index : indices)
+    {
+        if (time - loadTimes[index] > cacheSize)
+        {
+            loadTimes[index] = time++;
+            misses++;
+        }
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            referencedCount++;
+        }
+    }
+
+    stats.acmr = (float)misses / (indices.size() / 3);
+    stats.atvr = (float)misses / referencedCount;
+    return stats;
+}
+
+// ------------------------------------------------------------------------
+// vertex cache
+static float getForsythVertexScore(int cachePosition, unsigned int liveTriangles)
+{
+    // No triangle left to draw: the vertex does not matter anymore
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle does not 
+        // simply reuse its edge and build long strips
+        if (cachePosition < 3)
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        else
+            score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+    }
+    // Vertices with few triangles left are finished first, instead of being left alone at the end
+    score += FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)liveTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+    return score;
+}
+
+std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    // Triangles of every vertex, packed: those of vertex v are adjacency[offsets[v], offsets[v] + liveTriangles[v])
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveTriangles[index]++;
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[cursors[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = getForsythVertexScore(-1, liveTriangles[v]);
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    size_t scanCursor = 0;
+    size_t bestTriangle = triangleCount;
+
+    while (result.size() < triangleCount * 3)
+    {
+        // Nothing in the cache leads to a triangle left: start again from the next one in the input
+        if (bestTriangle == triangleCount)
+        {
+            while (emitted[scanCursor])
+                scanCursor++;
+            bestTriangle = scanCursor;
+        }
+
+        const unsigned int* triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        newCache.clear();
+        for (int corner = 0; corner < 3; corner++)
+        {
+            unsigned int v = triangle[corner];
+            result.push_back(v);
+            newCache.push_back(v);
+
+            // Remove the triangle from the live ones of its vertices
+            size_t begin = offsets[v];
+            size_t end = begin + liveTriangles[v];
+            for (size_t i = begin; i < end; i++)
+            {
+                if (adjacency[i] == bestTriangle)
+                {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    break;
+                }
+            }
+            liveTriangles[v]--;
+        }
+
+        // LRU: the triangle's vertices move to the front, the rest follows in order
+        for (unsigned int v : cache)
+        {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache.push_back(v);
+        }
+        for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = getForsythVertexScore(-1, liveTriangles[newCache[i]]);
+        }
+        if (newCache.size() > FORSYTH_CACHE_SIZE)
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            cachePositions[newCache[i]] = (int)i;
+            vertexScores[newCache[i]] = getForsythVertexScore((int)i, liveTriangles[newCache[i]]);
+        }
+        cache.swap(newCache);
+
+        // Next triangle: the best one touching the cache
+        bestTriangle = triangleCount;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache)
+        {
+            for (size_t i = offsets[v]; i < offsets[v] + liveTriangles[v]; i++)
+            {
+                unsigned int candidate = adjacency[i];
+                const unsigned int* corners = &indices[candidate * 3];
+                float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// ------------------------------------------------------------------------
+// overdraw
+
+// First triangle of every cluster. Hard boundaries are where the cache restarts (3 misses in a row 
+// for a triangle): cutting there costs nothing. Each hard cluster is then cut again where the ACMR 
+// since the last cut is within "threshold" of the ACMR of the whole hard cluster.
+static std::vector<size_t> findClusters(const std::vector<unsigned int>& indices, size_t vertexCount, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> loadTimes(vertexCount, 0);
+    unsigned int time = VERTEX_CACHE_SIZE + 1;
+
+    // Misses of every triangle
+    std::vector<unsigned int> misses(triangleCount, 0);
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            unsigned int index = indices[t * 3 + corner];
+            if (time - loadTimes[index] > VERTEX_CACHE_SIZE)
+            {
+                loadTimes[index] = time++;
+                misses[t]++;
+            }
+        }
+        if (t == 0 || misses[t] == 3)
+            hardClusters.push_back(t);
+    }
+    hardClusters.push_back(triangleCount);
+
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+    {
+        size_t begin = hardClusters[c];
+        size_t end = hardClusters[c + 1];
+        unsigned int clusterMisses = 0;
+        for (size_t t = begin; t < end; t++)
+            clusterMisses += misses[t];
+        float clusterAcmr = (float)clusterMisses / (end - begin);
+
+        clusters.push_back(begin);
+        size_t cut = begin;
+        unsigned int cutMisses = 0;
+        for (size_t t = begin; t < end; t++)
+        {
+            cutMisses += misses[t];
+            size_t cutTriangles = t + 1 - cut;
+            if (cutTriangles >= MIN_CLUSTER_TRIANGLES && end - (t + 1) >= MIN_CLUSTER_TRIANGLES 
+                && (float)cutMisses / cutTriangles <= threshold * clusterAcmr)
+            {
+                clusters.push_back(t + 1);
+                cut = t + 1;
+                cutMisses = 0;
+            }
+        }
+    }
+    return clusters;
+}
+
+std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int>& indices, const float* positions, size_t positionStride,
+    size_t vertexCount, float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return indices;
+
+    std::vector<size_t> clusters = findClusters(indices, vertexCount, threshold);
+    clusters.push_back(triangleCount);
+    size_t clusterCount = clusters.size() - 1;
+
+    // Area-weighted centroid and normal of every cluster (the cross product is twice the area)
+    std::vector<float> clusterData(clusterCount * 7, 0.0f);
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float* data = &clusterData[c * 7];
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const float* p[3];
+            for (int corner = 0; corner < 3; corner++)
+                p[corner] = (const float*)((const char*)positions + indices[t * 3 + corner] * positionStride);
+
+            float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float centroid = (p[0][axis] + p[1][axis] + p[2][axis]) / 3.0f;
+                data[axis] += centroid * area;
+                data[3 + axis] += normal[axis];
+                meshCentroid[axis] += centroid * area;
+            }
+            data[6] += area;
+            meshArea += area;
+        }
+    }
+    for (int axis = 0; axis < 3; axis++)
+        meshCentroid[axis] = meshArea > 0.0f ? meshCentroid[axis] / meshArea : 0.0f;
+
+    // Clusters facing away from the centre are on the outside of the mesh: drawn first, they hide the rest
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        const float* data = &clusterData[c * 7];
+        float normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        if (data[6] <= 0.0f || normalLength <= 0.0f)
+            continue;
+        for (int axis = 0; axis < 3; axis++)
+            sortKeys[c] += (data[axis] / data[6] - meshCentroid[axis]) * data[3 + axis] / normalLength;
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    return result;
+}
+
+// ------------------------------------------------------------------------
+// vertex fetch
+std::vector<unsigned int> optimizeVertexFetch(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    std::vector<unsigned int> remap(vertexCount, INVALID_VERTEX);
+    unsigned int nextVertex = 0;
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == INVALID_VERTEX)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    return remap;
+}
+
+void printMeshOptimizationReport(const char* name, const MeshOptimizationReport& report)
+{
+    std::cout << "Optimized indices of " << name << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+        << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << " (FIFO cache of " << VERTEX_CACHE_SIZE << ")" << std::endl;
+}
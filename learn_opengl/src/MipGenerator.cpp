@@ -0,0 +1,343 @@
+#include "../header/MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIP_GENERATOR_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE
+#endif
+
+// Below this many pixels, a pass is not worth starting threads
+static const int MIN_PIXELS_PER_THREAD = 64 * 1024;
+// Entries of the linear -> sRGB table (12 bits keep every 8-bit sRGB value reachable)
+static const int SRGB_ENCODE_TABLE_SIZE = 4096;
+
+// ------------------------------------------------------------------------
+// filters
+// Both filters are separable, and sample the source at the same positions for every destination
+// texel (the size exactly halves): one set of weights per filter.
+
+struct MipFilter
+{
+    // destination texel x reads source texels 2x + firstTap ... 2x + firstTap + tapCount - 1
+    int firstTap;
+    int tapCount;
+    float weights[6];
+};
+
+static double besselI0(double x)
+{
+    // power series, converges quickly for the small arguments of the window
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static MipFilter makeFilter(Mip_Filter filter)
+{
+    MipFilter result;
+    if (filter == Mip_Filter::BOX)
+    {
+        result.firstTap = 0;
+        result.tapCount = 2;
+        result.weights[0] = result.weights[1] = 0.5f;
+        return result;
+    }
+
+    // Sinc at the destination frequency (half the source one), windowed by a Kaiser window of
+    // 3 source texels radius. The taps are 0.5, 1.5 and 2.5 texels away from the destination center.
+    const double PI = 3.14159265358979323846;
+    const double alpha = 4.0;
+    const double radius = 3.0;
+    result.firstTap = -2;
+    result.tapCount = 6;
+    double sum = 0.0;
+    double weights[6];
+    for (int k = 0; k < 6; k++)
+    {
+        double distance = k - 2.5;
+        double x = PI * distance / 2.0;
+        double sinc = std::sin(x) / x;
+        double ratio = distance / radius;
+        double window = besselI0(alpha * std::sqrt(1.0 - ratio * ratio)) / besselI0(alpha);
+        weights[k] = sinc * window;
+        sum += weights[k];
+    }
+    for (int k = 0; k < 6; k++)
+        result.weights[k] = (float)(weights[k] / sum);
+    return result;
+}
+
+// One row of "width" texels -> half as wide
+static void filterRow(const float* in, int width, float* out, int destinationWidth, const MipFilter& filter)
+{
+    int x = 0;
+
+    // The taps of the inner texels never leave the row: no clamp there
+    int lastInner = width - filter.firstTap - filter.tapCount;
+    int innerEnd = lastInner < 0 ? 0 : std::min(destinationWidth, lastInner / 2 + 1);
+    int innerBegin = std::min(innerEnd, (-filter.firstTap + 1) / 2);
+    for (; x < innerBegin; x++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < filter.tapCount; k++)
+                sum += filter.weights[k] * in[std::min(std::max(2 * x + filter.firstTap + k, 0), width - 1) * 4 + c];
+            out[x * 4 + c] = sum;
+        }
+    }
+
+#if defined(MIP_GENERATOR_AVX)
+    // Two destination texels at once, a texel (RGBA) in each half of the register
+    for (; x + 2 <= innerEnd; x += 2)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        const float* tap = in + (2 * x + filter.firstTap) * 4;
+        for (int k = 0; k < filter.tapCount; k++, tap += 4)
+        {
+            __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(tap)), _mm_loadu_ps(tap + 8), 1);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(filter.weights[k]), texels));
+        }
+        _mm256_storeu_ps(out + x * 4, sum);
+    }
+#endif
+
+#if defined(MIP_GENERATOR_SSE)
+    for (; x < innerEnd; x++)
+    {
+        __m128 sum = _mm_setzero_ps();
+        const float* tap = in + (2 * x + filter.firstTap) * 4;
+        for (int k = 0; k < filter.tapCount; k++, tap += 4)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(filter.weights[k]), _mm_loadu_ps(tap)));
+        _mm_storeu_ps(out + x * 4, sum);
+    }
+#endif
+
+    // Remaining texels, and the right edge
+    for (; x < destinationWidth; x++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < filter.tapCount; k++)
+                sum += filter.weights[k] * in[std::min(std::max(2 * x + filter.firstTap + k, 0), width - 1) * 4 + c];
+            out[x * 4 + c] = sum;
+        }
+    }
+}
+
+// Destination rows [begin, end) from the rows filtered horizontally, clamped to [0, 1] (the Kaiser lobes overshoot)
+static void filterColumns(const float* source, int height, int width, float* destination, const MipFilter& filter, int begin, int end)
+{
+    size_t rowSize = (size_t)width * 4;
+    const float* rows[6];
+    for (int y = begin; y < end; y++)
+    {
+        for (int k = 0; k < filter.tapCount; k++)
+            rows[k] = source + std::min(std::max(2 * y + filter.firstTap + k, 0), height - 1) * rowSize;
+        float* out = destination + y * rowSize;
+        size_t i = 0;
+
+#if defined(MIP_GENERATOR_AVX)
+        const __m256 zero8 = _mm256_setzero_ps();
+        const __m256 one8 = _mm256_set1_ps(1.0f);
+        for (; i + 8 <= rowSize; i += 8)
+        {
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = 0; k < filter.tapCount; k++)
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(filter.weights[k]), _mm256_loadu_ps(rows[k] + i)));
+            _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(sum, zero8), one8));
+        }
+#endif
+
+#if defined(MIP_GENERATOR_SSE)
+        const __m128 zero4 = _mm_setzero_ps();
+        const __m128 one4 = _mm_set1_ps(1.0f);
+        for (; i + 4 <= rowSize; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < filter.tapCount; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(filter.weights[k]), _mm_loadu_ps(rows[k] + i)));
+            _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(sum, zero4), one4));
+        }
+#endif
+
+        // Remaining values
+        for (; i < rowSize; i++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < filter.tapCount; k++)
+                sum += filter.weights[k] * rows[k][i];
+            out[i] = std::min(std::max(sum, 0.0f), 1.0f);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// conversions
+
+static float decodeSRGB(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float encodeSRGB(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+struct ConversionTables
+{
+    // 8-bit value -> [0, 1], for RGB and for alpha
+    float decodeColor[256];
+    float decodeAlpha[256];
+    // [0, 1] in SRGB_ENCODE_TABLE_SIZE steps -> 8-bit value (sRGB images only)
+    unsigned char encodeColor[SRGB_ENCODE_TABLE_SIZE + 1];
+    bool sRGB;
+};
+
+static void makeTables(bool sRGB, ConversionTables& tables)
+{
+    tables.sRGB = sRGB;
+    for (int i = 0; i < 256; i++)
+    {
+        tables.decodeAlpha[i] = i / 255.0f;
+        tables.decodeColor[i] = sRGB ? decodeSRGB(i / 255.0f) : i / 255.0f;
+    }
+    for (int i = 0; i <= SRGB_ENCODE_TABLE_SIZE; i++)
+        tables.encodeColor[i] = (unsigned char)std::lround(encodeSRGB(i / (float)SRGB_ENCODE_TABLE_SIZE) * 255.0f);
+}
+
+static void decodeTexels(const unsigned char* rgba, float* texels, const ConversionTables& tables, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        texels[i * 4 + 0] = tables.decodeColor[rgba[i * 4 + 0]];
+        texels[i * 4 + 1] = tables.decodeColor[rgba[i * 4 + 1]];
+        texels[i * 4 + 2] = tables.decodeColor[rgba[i * 4 + 2]];
+        texels[i * 4 + 3] = tables.decodeAlpha[rgba[i * 4 + 3]];
+    }
+}
+
+// The texels are already clamped to [0, 1]
+static void encodeTexels(const float* texels, unsigned char* rgba, const ConversionTables& tables, size_t begin, size_t end)
+{
+    size_t i = begin * 4;
+
+#if defined(MIP_GENERATOR_SSE)
+    if (!tables.sRGB)
+    {
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for (; i + 16 <= end * 4; i += 16)
+        {
+            __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(texels + i), scale));
+            __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(texels + i + 4), scale));
+            __m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(texels + i + 8), scale));
+            __m128i d = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(texels + i + 12), scale));
+            // 32 -> 16 -> 8 bits, the values are in [0, 255] already
+            _mm_storeu_si128((__m128i*)(rgba + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+        }
+    }
+#endif
+
+    // Remaining values (every one of an sRGB image)
+    for (; i < end * 4; i++)
+    {
+        if (tables.sRGB && (i & 3) != 3)
+            rgba[i] = tables.encodeColor[(int)(texels[i] * SRGB_ENCODE_TABLE_SIZE + 0.5f)];
+        else
+            rgba[i] = (unsigned char)std::nearbyint(texels[i] * 255.0f);
+    }
+}
+
+// ------------------------------------------------------------------------
+// chain
+
+// Splits [0, count) in bands, one per thread (the calling thread takes the first), if the work is worth it
+static void parallelFor(int count, size_t pixels, unsigned int threadCount, const std::function<void(int, int)>& body)
+{
+    unsigned int bands = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(1, pixels / MIN_PIXELS_PER_THREAD));
+    bands = std::min(bands, (unsigned int)std::max(1, count));
+    if (bands <= 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned int band = 1; band < bands; band++)
+        threads.push_back(std::thread(body, (int)((size_t)count * band / bands), (int)((size_t)count * (band + 1) / bands)));
+    body(0, count / (int)bands);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+std::vector<MipLevel> generateMipChain(const unsigned char* rgba, int width, int height, const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    if (width <= 0 || height <= 0 || (width == 1 && height == 1))
+        return levels;
+
+    unsigned int threadCount = options.threadCount != 0 ? options.threadCount : std::max(1u, std::thread::hardware_concurrency());
+    MipFilter filter = makeFilter(options.filter);
+    ConversionTables tables;
+    makeTables(options.sRGB, tables);
+
+    std::vector<float> current;
+    std::vector<float> halfWidth;
+    std::vector<float> next;
+    while (width > 1 || height > 1)
+    {
+        int nextWidth = std::max(1, width / 2);
+        int nextHeight = std::max(1, height / 2);
+
+        // Rows first (every source row, half as wide), then columns
+        halfWidth.resize((size_t)nextWidth * height * 4);
+        parallelFor(height, (size_t)width * height, threadCount, [&](int begin, int end)
+        {
+            // The image is decoded a row at a time, right before its filtering: no full-size float copy
+            std::vector<float> decoded;
+            for (int y = begin; y < end; y++)
+            {
+                const float* row = current.data() + (size_t)y * width * 4;
+                if (levels.empty())
+                {
+                    decoded.resize((size_t)width * 4);
+                    decodeTexels(rgba + (size_t)y * width * 4, decoded.data(), tables, 0, width);
+                    row = decoded.data();
+                }
+                filterRow(row, width, halfWidth.data() + (size_t)y * nextWidth * 4, nextWidth, filter);
+            }
+        });
+
+        MipLevel level;
+        level.width = nextWidth;
+        level.height = nextHeight;
+        level.rgba.resize((size_t)nextWidth * nextHeight * 4);
+        next.resize((size_t)nextWidth * nextHeight * 4);
+        parallelFor(nextHeight, (size_t)nextWidth * height, threadCount, [&](int begin, int end)
+        {
+            filterColumns(halfWidth.data(), height, nextWidth, next.data(), filter, begin, end);
+            encodeTexels(next.data(), level.rgba.data(), tables, (size_t)begin * nextWidth, (size_t)end * nextWidth);
+        });
+        levels.push_back(std::move(level));
+
+        current.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return levels;
+}
@@ -0,0 +1,235 @@
+#include "../header/NormalMatrix.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NORMAL_MATRIX_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NORMAL_MATRIX_SSE
+#endif
+
+void Mat3SoA::resize(size_t count)
+{
+    for (int i = 0; i < 9; i++)
+        m[i].resize(count);
+}
+
+size_t Mat3SoA::size() const
+{
+    return m[0].size();
+}
+
+// ------------------------------------------------------------------------
+// single matrix
+
+#ifdef NORMAL_MATRIX_SSE
+// a x b = a.yzx * b.zxy - a.zxy * b.yzx
+static inline __m128 cross(__m128 a, __m128 b)
+{
+    __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+    return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+#endif
+
+glm::mat3 computeNormalMatrix(const glm::mat4& model)
+{
+#ifdef NORMAL_MATRIX_SSE
+    // Only the xyz lanes matter, w is zeroed so it stays out of the dot product
+    __m128 mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 a = _mm_and_ps(_mm_loadu_ps(&model[0][0]), mask);
+    __m128 b = _mm_and_ps(_mm_loadu_ps(&model[1][0]), mask);
+    __m128 c = _mm_and_ps(_mm_loadu_ps(&model[2][0]), mask);
+
+    __m128 bc = cross(b, c);
+    __m128 ca = cross(c, a);
+    __m128 ab = cross(a, b);
+
+    // det = a . (b x c), summed horizontally
+    __m128 dot = _mm_mul_ps(a, bc);
+    dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+    dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+    float det = _mm_cvtss_f32(dot);
+    // A singular matrix keeps the unscaled cofactors: the shader normalizes the normals anyway
+    __m128 invDet = _mm_set1_ps(det != 0.0f ? 1.0f / det : 1.0f);
+
+    float columns[3][4];
+    _mm_storeu_ps(columns[0], _mm_mul_ps(bc, invDet));
+    _mm_storeu_ps(columns[1], _mm_mul_ps(ca, invDet));
+    _mm_storeu_ps(columns[2], _mm_mul_ps(ab, invDet));
+
+    glm::mat3 normalMatrix;
+    for (int column = 0; column < 3; column++)
+        normalMatrix[column] = glm::vec3(columns[column][0], columns[column][1], columns[column][2]);
+    return normalMatrix;
+#else
+    glm::vec3 a(model[0][0], model[0][1], model[0][2]);
+    glm::vec3 b(model[1][0], model[1][1], model[1][2]);
+    glm::vec3 c(model[2][0], model[2][1], model[2][2]);
+
+    glm::vec3 bc = glm::cross(b, c);
+    float det = glm::dot(a, bc);
+    float invDet = det != 0.0f ? 1.0f / det : 1.0f;
+    return glm::mat3(bc * invDet, glm::cross(c, a) * invDet, glm::cross(a, b) * invDet);
+#endif
+}
+
+// ------------------------------------------------------------------------
+// batched kernel
+
+// Same maths as computeNormalMatrix, on one matrix of the SoA arrays
+static inline void computeNormalMatrixScalar(const float* const in[9], float* const out[9], size_t i)
+{
+    float ax = in[0][i], ay = in[1][i], az = in[2][i];
+    float bx = in[3][i], by = in[4][i], bz = in[5][i];
+    float cx = in[6][i], cy = in[7][i], cz = in[8][i];
+
+    float bcX = by * cz - bz * cy, bcY = bz * cx - bx * cz, bcZ = bx * cy - by * cx;
+    float det = ax * bcX + ay * bcY + az * bcZ;
+    float invDet = det != 0.0f ? 1.0f / det : 1.0f;
+
+    out[0][i] = bcX * invDet;
+    out[1][i] = bcY * invDet;
+    out[2][i] = bcZ * invDet;
+    out[3][i] = (cy * az - cz * ay) * invDet;
+    out[4][i] = (cz * ax - cx * az) * invDet;
+    out[5][i] = (cx * ay - cy * ax) * invDet;
+    out[6][i] = (ay * bz - az * by) * invDet;
+    out[7][i] = (az * bx - ax * bz) * invDet;
+    out[8][i] = (ax * by - ay * bx) * invDet;
+}
+
+// The kernel on the 9 element arrays of "count" matrices
+static void computeNormalMatricesSoA(const float* const in[9], float* const out[9], size_t count)
+{
+    size_t i = 0;
+
+#if defined(NORMAL_MATRIX_AVX)
+    const __m256 zero8 = _mm256_setzero_ps();
+    const __m256 one8 = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 ax = _mm256_loadu_ps(in[0] + i), ay = _mm256_loadu_ps(in[1] + i), az = _mm256_loadu_ps(in[2] + i);
+        __m256 bx = _mm256_loadu_ps(in[3] + i), by = _mm256_loadu_ps(in[4] + i), bz = _mm256_loadu_ps(in[5] + i);
+        __m256 cx = _mm256_loadu_ps(in[6] + i), cy = _mm256_loadu_ps(in[7] + i), cz = _mm256_loadu_ps(in[8] + i);
+
+        __m256 bcX = _mm256_sub_ps(_mm256_mul_ps(by, cz), _mm256_mul_ps(bz, cy));
+        __m256 bcY = _mm256_sub_ps(_mm256_mul_ps(bz, cx), _mm256_mul_ps(bx, cz));
+        __m256 bcZ = _mm256_sub_ps(_mm256_mul_ps(bx, cy), _mm256_mul_ps(by, cx));
+
+        __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bcX), _mm256_mul_ps(ay, bcY)), _mm256_mul_ps(az, bcZ));
+        __m256 singular = _mm256_cmp_ps(det, zero8, _CMP_EQ_OQ);
+        __m256 invDet = _mm256_div_ps(one8, _mm256_blendv_ps(det, one8, singular));
+
+        _mm256_storeu_ps(out[0] + i, _mm256_mul_ps(bcX, invDet));
+        _mm256_storeu_ps(out[1] + i, _mm256_mul_ps(bcY, invDet));
+        _mm256_storeu_ps(out[2] + i, _mm256_mul_ps(bcZ, invDet));
+        _mm256_storeu_ps(out[3] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cy, az), _mm256_mul_ps(cz, ay)), invDet));
+        _mm256_storeu_ps(out[4] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cz, ax), _mm256_mul_ps(cx, az)), invDet));
+        _mm256_storeu_ps(out[5] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cx, ay), _mm256_mul_ps(cy, ax)), invDet));
+        _mm256_storeu_ps(out[6] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(az, by)), invDet));
+        _mm256_storeu_ps(out[7] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(ax, bz)), invDet));
+        _mm256_storeu_ps(out[8] + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(ay, bx)), invDet));
+    }
+#endif
+
+#if defined(NORMAL_MATRIX_SSE)
+    const __m128 zero4 = _mm_setzero_ps();
+    const __m128 one4 = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 ax = _mm_loadu_ps(in[0] + i), ay = _mm_loadu_ps(in[1] + i), az = _mm_loadu_ps(in[2] + i);
+        __m128 bx = _mm_loadu_ps(in[3] + i), by = _mm_loadu_ps(in[4] + i), bz = _mm_loadu_ps(in[5] + i);
+        __m128 cx = _mm_loadu_ps(in[6] + i), cy = _mm_loadu_ps(in[7] + i), cz = _mm_loadu_ps(in[8] + i);
+
+        __m128 bcX = _mm_sub_ps(_mm_mul_ps(by, cz), _mm_mul_ps(bz, cy));
+        __m128 bcY = _mm_sub_ps(_mm_mul_ps(bz, cx), _mm_mul_ps(bx, cz));
+        __m128 bcZ = _mm_sub_ps(_mm_mul_ps(bx, cy), _mm_mul_ps(by, cx));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bcX), _mm_mul_ps(ay, bcY)), _mm_mul_ps(az, bcZ));
+        // SSE2 has no blend: select with and/andnot
+        __m128 singular = _mm_cmpeq_ps(det, zero4);
+        det = _mm_or_ps(_mm_and_ps(singular, one4), _mm_andnot_ps(singular, det));
+        __m128 invDet = _mm_div_ps(one4, det);
+
+        _mm_storeu_ps(out[0] + i, _mm_mul_ps(bcX, invDet));
+        _mm_storeu_ps(out[1] + i, _mm_mul_ps(bcY, invDet));
+        _mm_storeu_ps(out[2] + i, _mm_mul_ps(bcZ, invDet));
+        _mm_storeu_ps(out[3] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cy, az), _mm_mul_ps(cz, ay)), invDet));
+        _mm_storeu_ps(out[4] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cz, ax), _mm_mul_ps(cx, az)), invDet));
+        _mm_storeu_ps(out[5] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, ay), _mm_mul_ps(cy, ax)), invDet));
+        _mm_storeu_ps(out[6] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)), invDet));
+        _mm_storeu_ps(out[7] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)), invDet));
+        _mm_storeu_ps(out[8] + i, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)), invDet));
+    }
+#endif
+
+    // Remaining matrices
+    for (; i < count; i++)
+        computeNormalMatrixScalar(in, out, i);
+}
+
+void computeNormalMatrices(const Mat3SoA& models, Mat3SoA& normalMatrices)
+{
+    size_t count = models.size();
+    normalMatrices.resize(count);
+
+    const float* in[9];
+    float* out[9];
+    for (int j = 0; j < 9; j++)
+    {
+        in[j] = models.m[j].data();
+        out[j] = normalMatrices.m[j].data();
+    }
+    computeNormalMatricesSoA(in, out, count);
+}
+
+// Instances are converted to SoA a block at a time, in arrays on the stack that stay in L1: 
+// no allocation, and the gather and scatter touch each instance once
+const size_t INSTANCE_BLOCK_SIZE = 64;
+
+void computeNormalMatrices(std::vector<InstanceData>& instances)
+{
+    float models[9][INSTANCE_BLOCK_SIZE];
+    float normalMatrices[9][INSTANCE_BLOCK_SIZE];
+    const float* in[9];
+    float* out[9];
+    for (int j = 0; j < 9; j++)
+    {
+        in[j] = models[j];
+        out[j] = normalMatrices[j];
+    }
+
+    for (size_t first = 0; first < instances.size(); first += INSTANCE_BLOCK_SIZE)
+    {
+        size_t count = std::min(INSTANCE_BLOCK_SIZE, instances.size() - first);
+
+        // AoS -> SoA
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::mat4& model = instances[first + i].model;
+            for (int column = 0; column < 3; column++)
+            {
+                for (int row = 0; row < 3; row++)
+                    models[column * 3 + row][i] = model[column][row];
+            }
+        }
+
+        computeNormalMatricesSoA(in, out, count);
+
+        // SoA -> AoS
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::mat3& normalMatrix = instances[first + i].normalMatrix;
+            for (int column = 0; column < 3; column++)
+            {
+                for (int row = 0; row < 3; row++)
+                    normalMatrix[column][row] = normalMatrices[column * 3 + row][i];
+            }
+        }
+    }
+}
@@ -0,0 +1,273 @@
+#include "../header/PackedVertex.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+const float RADIANS_TO_DEGREES = 57.2957795f;
+
+// ------------------------------------------------------------------------
+// half floats (IEEE 754 binary16), rounded to nearest even
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    // NaN stays NaN, infinity stays infinity
+    if (exponent == 0xFF)
+        return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+
+    int halfExponent = (int)exponent - 127 + 15;
+    if (halfExponent >= 0x1F)
+        return sign | 0x7C00;
+
+    if (halfExponent <= 0)
+    {
+        // Subnormal half (or zero): shift the mantissa, implicit bit included
+        if (halfExponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+        return sign | (uint16_t)half;
+    }
+
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    // A carry into the exponent is correct, up to rounding to infinity
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return sign | (uint16_t)half;
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0x1F)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    else if (mantissa == 0)
+        bits = sign;
+    else
+    {
+        // Subnormal: normalise it
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// ------------------------------------------------------------------------
+// normalized integers
+uint16_t packUnorm16(float value)
+{
+    float clamped = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (uint16_t)std::lround(clamped * 65535.0f);
+}
+
+float unpackUnorm16(uint16_t value)
+{
+    return value / 65535.0f;
+}
+
+// 10-bit two's complement, as read by the vertex fetch with normalized = GL_TRUE
+static uint32_t packSnorm10(float value)
+{
+    float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return (uint32_t)std::lround(clamped * 511.0f) & 0x3FF;
+}
+
+static float unpackSnorm10(uint32_t bits)
+{
+    int value = (bits & 0x200) ? (int)bits - 0x400 : (int)bits;
+    float result = value / 511.0f;
+    return result < -1.0f ? -1.0f : result;
+}
+
+// ------------------------------------------------------------------------
+// octahedral directions
+static float signNotZero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// The octahedron |x| + |y| + |z| = 1, its lower half folded over the upper one
+glm::vec2 octEncode(const glm::vec3& direction)
+{
+    float norm = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+    if (norm == 0.0f)
+        return glm::vec2(0.0f, 0.0f);
+    float x = direction.x / norm;
+    float y = direction.y / norm;
+    if (direction.z < 0.0f)
+    {
+        float foldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+        float foldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    return glm::vec2(x, y);
+}
+
+glm::vec3 octDecode(const glm::vec2& encoded)
+{
+    float x = encoded.x;
+    float y = encoded.y;
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f)
+    {
+        float unfoldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+        float unfoldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+        x = unfoldedX;
+        y = unfoldedY;
+    }
+    float length = std::sqrt(x * x + y * y + z * z);
+    return glm::vec3(x / length, y / length, z / length);
+}
+
+// Rounding each coordinate to the nearest step is not always the closest direction: 
+// the 4 neighbours of the encoded point are tried, which about halves the worst error
+uint32_t packDirection(const glm::vec3& direction, float w)
+{
+    glm::vec2 encoded = octEncode(direction);
+    uint32_t packedW = (w < 0.0f ? 0x3u : 0x1u) << 30;
+
+    uint32_t best = 0;
+    float bestDot = -2.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        float x = ((i & 1) ? std::ceil(encoded.x * 511.0f) : std::floor(encoded.x * 511.0f)) / 511.0f;
+        float y = ((i & 2) ? std::ceil(encoded.y * 511.0f) : std::floor(encoded.y * 511.0f)) / 511.0f;
+        uint32_t packed = packSnorm10(x) | (packSnorm10(y) << 10);
+        glm::vec3 decoded = octDecode(glm::vec2(unpackSnorm10(packed & 0x3FF), unpackSnorm10((packed >> 10) & 0x3FF)));
+        float cosine = decoded.x * direction.x + decoded.y * direction.y + decoded.z * direction.z;
+        if (cosine > bestDot)
+        {
+            bestDot = cosine;
+            best = packed;
+        }
+    }
+    return best | packedW;
+}
+
+glm::vec3 unpackDirection(uint32_t packed, float* w)
+{
+    if (w != nullptr)
+        *w = (packed >> 31) ? -1.0f : 1.0f;
+    return octDecode(glm::vec2(unpackSnorm10(packed & 0x3FF), unpackSnorm10((packed >> 10) & 0x3FF)));
+}
+
+// ------------------------------------------------------------------------
+// vertices
+static float angleBetween(const glm::vec3& a, const glm::vec3& b)
+{
+    float lengths = std::sqrt((a.x * a.x + a.y * a.y + a.z * a.z) * (b.x * b.x + b.y * b.y + b.z * b.z));
+    if (lengths == 0.0f)
+        return 0.0f;
+    float cosine = (a.x * b.x + a.y * b.y + a.z * b.z) / lengths;
+    return std::acos(cosine > 1.0f ? 1.0f : (cosine < -1.0f ? -1.0f : cosine)) * RADIANS_TO_DEGREES;
+}
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoords,
+    const glm::vec3& tangent, const glm::vec3& bitangent, VertexPackingReport* report)
+{
+    glm::vec3 bitangentFromCross = glm::cross(normal, tangent);
+    float bitangentSign = glm::dot(bitangentFromCross, bitangent) < 0.0f ? -1.0f : 1.0f;
+
+    PackedVertex vertex;
+    for (int i = 0; i < 3; i++)
+        vertex.position[i] = floatToHalf(position[i]);
+    vertex.position[3] = floatToHalf(1.0f);
+    vertex.normal = packDirection(normal);
+    vertex.tangent = packDirection(tangent, bitangentSign);
+    vertex.texCoords[0] = packUnorm16(texCoords.x);
+    vertex.texCoords[1] = packUnorm16(texCoords.y);
+
+    if (report != nullptr)
+    {
+        glm::vec3 decodedPosition, decodedNormal, decodedTangent, decodedBitangent;
+        glm::vec2 decodedTexCoords;
+        unpackVertex(vertex, decodedPosition, decodedNormal, decodedTexCoords, decodedTangent, decodedBitangent);
+
+        report->vertexCount++;
+        report->packedBytes += sizeof(PackedVertex);
+        for (int i = 0; i < 3; i++)
+        {
+            if (std::fabs(position[i]) > 65504.0f)
+                report->overflowedPositionCount++;
+            else
+                report->maxPositionError = std::fmax(report->maxPositionError, std::fabs(decodedPosition[i] - position[i]));
+        }
+        report->maxDirectionError = std::fmax(report->maxDirectionError, angleBetween(normal, decodedNormal));
+        report->maxDirectionError = std::fmax(report->maxDirectionError, angleBetween(tangent, decodedTangent));
+        for (int i = 0; i < 2; i++)
+        {
+            if (texCoords[i] < 0.0f || texCoords[i] > 1.0f)
+                report->clampedTexCoordCount++;
+            else
+                report->maxTexCoordError = std::fmax(report->maxTexCoordError, std::fabs(decodedTexCoords[i] - texCoords[i]));
+        }
+    }
+    return vertex;
+}
+
+void unpackVertex(const PackedVertex& vertex, glm::vec3& position, glm::vec3& normal, glm::vec2& texCoords, 
+    glm::vec3& tangent, glm::vec3& bitangent)
+{
+    position = glm::vec3(halfToFloat(vertex.position[0]), halfToFloat(vertex.position[1]), halfToFloat(vertex.position[2]));
+    normal = unpackDirection(vertex.normal);
+    float bitangentSign = 1.0f;
+    tangent = unpackDirection(vertex.tangent, &bitangentSign);
+    bitangent = glm::cross(normal, tangent) * bitangentSign;
+    texCoords = glm::vec2(unpackUnorm16(vertex.texCoords[0]), unpackUnorm16(vertex.texCoords[1]));
+}
+
+// ------------------------------------------------------------------------
+// OpenGL
+void setPackedVertexAttributes(bool withTangent)
+{
+    // Half floats and 2_10_10_10 are core since OpenGL 3.3
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+    if (withTangent)
+    {
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+    }
+}
+
+void printVertexPackingReport(const char* name, const VertexPackingReport& report)
+{
+    float saving = report.unpackedBytes > 0 ? 100.0f * (1.0f - (float)report.packedBytes / report.unpackedBytes) : 0.0f;
+    std::cout << "Packed vertices of " << name << ": " << report.vertexCount << " vertices, " 
+        << report.unpackedBytes << " -> " << report.packedBytes << " bytes (-" << saving << "% memory and vertex fetch), "
+        << "max errors: position " << report.maxPositionError << ", direction " << report.maxDirectionError << " deg, "
+        << "texture coords " << report.maxTexCoordError << std::endl;
+    if (report.clampedTexCoordCount > 0 || report.overflowedPositionCount > 0)
+        std::cout << "ERROR::PACKED_VERTEX::OUT_OF_RANGE: " << report.clampedTexCoordCount << " texture coords clamped to [0, 1], "
+            << report.overflowedPositionCount << " positions past the half-float range" << std::endl;
+}
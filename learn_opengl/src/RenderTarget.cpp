@@ -0,0 +1,54 @@
+#include "../header/RenderTarget.h"
+
+#include <iostream>
+
+RenderTarget::RenderTarget(GLsizei width, GLsizei height, GLenum depthFormat) : m_width(width), m_height(height)
+{
+    glGenRenderbuffers(1, &m_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_ID);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::RENDER_TARGET::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::deleteBuffers()
+{
+    glDeleteFramebuffers(1, &m_ID);
+    glDeleteRenderbuffers(1, &m_colorBuffer);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::blitToScreen(GLsizei screenWidth, GLsizei screenHeight) const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLsizei RenderTarget::getWidth() const
+{
+    return m_width;
+}
+
+GLsizei RenderTarget::getHeight() const
+{
+    return m_height;
+}
@@ -1,160 +1,660 @@
 #include "../header/Shader.h"
+#include "../header/GLExtensions.h"
+#include "../header/GLState.h"
+#include "../header/Hash.h"
+#include "../header/ShaderCompileWorker.h"
+#include "../header/ShaderFileWatcher.h"
+#include "../header/ShaderPreprocessor.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+// Written in front of every program binary, bump it if the file layout changes
+const uint32_t PROGRAM_BINARY_MAGIC = 0x31424F4C; // "LOB1"
+
+std::string Shader::s_binaryCacheDirectory;
+ShaderCompileWorker* Shader::s_compileWorker = nullptr;
+ShaderFileWatcher* Shader::s_fileWatcher = nullptr;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, ShaderBuildMode buildMode, const ShaderDefines& defines) 
+    : m_ID(0), m_uniformLookupCount(0), m_fromBinaryCache(false), m_ready(false), m_compileOnWorker(false), m_compiledOnWorker(false),
+    m_vertexID(0), m_fragmentID(0), m_geometryID(0), m_vertexPath(vertexPath), m_fragmentPath(fragmentPath), 
+    m_geometryPath(geometryPath != nullptr ? geometryPath : ""), m_defines(defines), m_watchGeneration(0), m_reloadID(0)
 {
-    // 1. retrieve the vertex/fragment source code from filePath
-    
-    std::string vertexSourceString;
-    std::string fragmentSourceString;
-    std::string geometryCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    std::ifstream gShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try
-    {
-        // open files        
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexSourceString = vShaderStream.str();
-        fragmentSourceString = fShaderStream.str();
-        // if geometry shader path is present, also load a geometry shader
-        if (geometryPath != nullptr)
-        {
-            gShaderFile.open(geometryPath);
-            std::stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geometryCode = gShaderStream.str();
-        }
+    // 1. retrieve the vertex/fragment source code from filePath, #include directives expanded
+    // (files shared by several programs are only read once)
+
+    ShaderSources sources = readSources(m_vertexPath, m_fragmentPath, m_geometryPath, m_defines, 
+        s_fileWatcher != nullptr ? s_fileWatcher->getGeneration() : 0);
+    watchSources(sources);
+    if (!sources.read)
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    const std::string& vertexSourceString = sources.vertexCode;
+    const std::string& fragmentSourceString = sources.fragmentCode;
+    const std::string& geometryCode = sources.geometryCode;
+
+    // 2. build the program: reuse the binary saved by a previous launch if the driver accepts it, 
+    // otherwise compile from source (and save the result for the next launch)
+
+    m_binaryPath = getBinaryCachePath(vertexSourceString, fragmentSourceString, geometryCode);
+    m_fromBinaryCache = !m_binaryPath.empty() && loadProgramBinary(m_binaryPath);
+    if (m_fromBinaryCache)
+    {
+        m_binaryPath.clear();
+        finishBuild();
+        return;
+    }
+
+    m_ID = createProgramObjects(!geometryCode.empty());
+    if (submitBuild(m_ID, vertexSourceString, fragmentSourceString, geometryCode, buildMode == ShaderBuildMode::Async))
+        finishBuild();
+};
+
+// Expands the files of the program and injects the variant's defines, also listing the files read.
+// Touches no member nor OpenGL: reloads run it on a background thread.
+// The generation is taken by the caller before reading: a change made while reading triggers a reload.
+Shader::ShaderSources Shader::readSources(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath, 
+    const ShaderDefines& defines, uint64_t watchGeneration)
+{
+    ShaderSources sources;
+    sources.watchGeneration = watchGeneration;
+    sources.read = ShaderPreprocessor::load(vertexPath, sources.vertexCode, &sources.dependencies);
+    sources.read = ShaderPreprocessor::load(fragmentPath, sources.fragmentCode, &sources.dependencies) && sources.read;
+    // if geometry shader path is present, also load a geometry shader
+    if (!geometryPath.empty())
+        sources.read = ShaderPreprocessor::load(geometryPath, sources.geometryCode, &sources.dependencies) && sources.read;
+
+    // the variant's defines are part of the sources, hence of the binary cache key too
+    if (!defines.empty())
+    {
+        sources.vertexCode = injectDefines(sources.vertexCode, defines);
+        sources.fragmentCode = injectDefines(sources.fragmentCode, defines);
+        if (!sources.geometryCode.empty())
+            sources.geometryCode = injectDefines(sources.geometryCode, defines);
     }
-    catch (std::ifstream::failure& e)
+    return sources;
+}
+
+// Records the files read, watched when hot reload is on
+void Shader::watchSources(const ShaderSources& sources)
+{
+    m_watchGeneration = sources.watchGeneration;
+    // An edit may add or remove includes: the list is replaced on every read
+    m_dependencies = sources.dependencies;
+    if (s_fileWatcher != nullptr)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        for (const std::string& path : m_dependencies)
+            s_fileWatcher->watch(path);
     }
+}
 
-    const char* vertexSource = vertexSourceString.c_str();
-    const char* fragmentSource = fragmentSourceString.c_str();
-    
-    // 2. compile shaders
+GLuint Shader::createProgramObjects(bool hasGeometry)
+{
+    m_vertexID = glCreateShader(GL_VERTEX_SHADER);
+    m_fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
+    m_geometryID = hasGeometry ? glCreateShader(GL_GEOMETRY_SHADER) : 0;
+    return glCreateProgram();
+}
 
-    unsigned int vertexID, fragmentID;
+// Starts building the program. Returns true if it was built synchronously, 
+// otherwise isBuildComplete() tells when the driver (or the compile worker) is done.
+bool Shader::submitBuild(GLuint program, const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode, bool async)
+{
+    m_compileOnWorker = false;
+
+    if (async && GLExt::parallelShaderCompile)
+    {
+        // Submitted to the driver's compiler threads, polled by isBuildComplete()
+        compileAndLink(program, vertexCode, fragmentCode, geometryCode);
+        return false;
+    }
+    if (async && s_compileWorker != nullptr)
+    {
+        // Compiled in the worker's shared context. glFinish makes the results visible 
+        // to the main context before the flag is raised.
+        m_compileOnWorker = true;
+        m_compiledOnWorker.store(false);
+        s_compileWorker->submit([this, program, vertexCode, fragmentCode, geometryCode]()
+        {
+            compileAndLink(program, vertexCode, fragmentCode, geometryCode);
+            glFinish();
+            m_compiledOnWorker.store(true, std::memory_order_release);
+        });
+        return false;
+    }
+
+    compileAndLink(program, vertexCode, fragmentCode, geometryCode);
+    return true;
+}
+
+// Submits the compilation and the link without querying any status: a status query would wait 
+// for the driver to finish. Safe to call from the compile worker thread.
+void Shader::compileAndLink(GLuint program, const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode)
+{
+    const char* vertexSource = vertexCode.c_str();
+    const char* fragmentSource = fragmentCode.c_str();
     
     // vertex shader
-    vertexID = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexID, 1, &vertexSource, NULL);
-    glCompileShader(vertexID);
-    checkCompileErrors(vertexID, "VERTEX");
+    glShaderSource(m_vertexID, 1, &vertexSource, NULL);
+    glCompileShader(m_vertexID);
     
     // fragment Shader
-    fragmentID = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentID, 1, &fragmentSource, NULL);
-    glCompileShader(fragmentID);
-    checkCompileErrors(fragmentID, "FRAGMENT");
+    glShaderSource(m_fragmentID, 1, &fragmentSource, NULL);
+    glCompileShader(m_fragmentID);
     
     // if geometry shader is given, compile geometry shader
-    unsigned int geometryID;
-    if (geometryPath != nullptr)
+    if (m_geometryID != 0)
     {
         const char* gShaderCode = geometryCode.c_str();
-        geometryID = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometryID, 1, &gShaderCode, NULL);
-        glCompileShader(geometryID);
-        checkCompileErrors(geometryID, "GEOMETRY");
+        glShaderSource(m_geometryID, 1, &gShaderCode, NULL);
+        glCompileShader(m_geometryID);
     }
     
     // shader Program
-    m_ID = glCreateProgram();
-    glAttachShader(m_ID, vertexID);
-    glAttachShader(m_ID, fragmentID);
-    if (geometryPath != nullptr)
-        glAttachShader(m_ID, geometryID);
-    glLinkProgram(m_ID);
-    checkCompileErrors(m_ID, "PROGRAM");
-    
+    glAttachShader(program, m_vertexID);
+    glAttachShader(program, m_fragmentID);
+    if (m_geometryID != 0)
+        glAttachShader(program, m_geometryID);
+    // the binary can only be retrieved later if asked before linking
+    if (!m_binaryPath.empty())
+        GLExt::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+}
+
+// Reports the errors and deletes the shader objects, which are linked into the program now. 
+// Returns false if a stage or the link failed.
+bool Shader::checkAndDeleteStages(GLuint program)
+{
+    bool success = checkCompileErrors(m_vertexID, "VERTEX");
+    success = checkCompileErrors(m_fragmentID, "FRAGMENT") && success;
+    if (m_geometryID != 0)
+        success = checkCompileErrors(m_geometryID, "GEOMETRY") && success;
+    success = checkCompileErrors(program, "PROGRAM") && success;
+
     // delete the shaders as they're linked into our program now and no longer necessery
-    glDeleteShader(vertexID);
-    glDeleteShader(fragmentID);
-    if (geometryPath != nullptr)
-        glDeleteShader(geometryID);
-};
+    glDeleteShader(m_vertexID);
+    glDeleteShader(m_fragmentID);
+    if (m_geometryID != 0)
+        glDeleteShader(m_geometryID);
+    m_vertexID = m_fragmentID = m_geometryID = 0;
+    return success;
+}
+
+// Reports the errors, saves the binary and fills the uniform cache, once the driver is done
+void Shader::finishBuild()
+{
+    if (m_vertexID != 0)
+    {
+        checkAndDeleteStages(m_ID);
+        if (!m_binaryPath.empty())
+            saveProgramBinary(m_binaryPath);
+    }
+
+    // cache the uniform locations once, so the setters never call glGetUniformLocation
+    cacheUniformLocations();
+    m_ready = true;
+}
+
+// ------------------------------------------------------------------------
+// asynchronous build
+void Shader::setCompileWorker(ShaderCompileWorker* worker)
+{
+    s_compileWorker = worker;
+}
+
+bool Shader::isBuildComplete(GLuint program) const
+{
+    if (m_compileOnWorker)
+        return m_compiledOnWorker.load(std::memory_order_acquire);
+
+    // KHR_parallel_shader_compile: the driver compiles on its own threads, this query does not block
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed != GL_FALSE;
+}
+
+bool Shader::isReady()
+{
+    if (m_ready)
+        return true;
+    if (!isBuildComplete(m_ID))
+        return false;
+
+    finishBuild();
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// hot reload
+void Shader::setFileWatcher(ShaderFileWatcher* watcher)
+{
+    s_fileWatcher = watcher;
+}
+
+bool Shader::reloadIfChanged()
+{
+    // Nothing to swap before the first build is done
+    if (s_fileWatcher == nullptr || !m_ready)
+        return false;
+
+    if (m_reloadSources.valid())
+    {
+        if (m_reloadSources.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return false;
+        return submitReload(m_reloadSources.get());
+    }
+    if (m_reloadID != 0)
+        return isBuildComplete(m_reloadID) && finishReload();
+
+    uint64_t generation = s_fileWatcher->getGeneration();
+    if (generation == m_watchGeneration)
+        return false;
+    if (!s_fileWatcher->hasChangedSince(m_dependencies, m_watchGeneration))
+    {
+        // Other programs' files
+        m_watchGeneration = generation;
+        return false;
+    }
+    startReload();
+    return false;
+}
+
+// Reads the sources (file I/O and #include expansion) on a background thread, picked up by a later reloadIfChanged()
+void Shader::startReload()
+{
+    // Copies: the thread touches no member of the shader
+    std::string vertexPath = m_vertexPath;
+    std::string fragmentPath = m_fragmentPath;
+    std::string geometryPath = m_geometryPath;
+    ShaderDefines defines = m_defines;
+    uint64_t watchGeneration = s_fileWatcher->getGeneration();
+    m_reloadSources = std::async(std::launch::async, [vertexPath, fragmentPath, geometryPath, defines, watchGeneration]()
+    {
+        return readSources(vertexPath, fragmentPath, geometryPath, defines, watchGeneration);
+    });
+}
+
+// Builds the new program next to the current one, which stays in use until the swap. 
+// Returns true if the build was synchronous and the program already swapped.
+bool Shader::submitReload(const ShaderSources& sources)
+{
+    watchSources(sources);
+    if (!sources.read)
+    {
+        // Probably caught in the middle of a save: the watcher reports the end of it
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        return false;
+    }
+
+    std::cout << "Reloading shader " << m_vertexPath << " + " << m_fragmentPath << std::endl;
+    if (!GLExt::parallelShaderCompile && s_compileWorker == nullptr)
+        std::cout << "Shader reload compiled on the render thread: no KHR_parallel_shader_compile nor compile worker" << std::endl;
+    m_binaryPath = getBinaryCachePath(sources.vertexCode, sources.fragmentCode, sources.geometryCode);
+    m_reloadID = createProgramObjects(!sources.geometryCode.empty());
+    if (submitBuild(m_reloadID, sources.vertexCode, sources.fragmentCode, sources.geometryCode, true))
+        return finishReload();
+    return false;
+}
+
+// Swaps the rebuilt program in if it compiled and linked, otherwise drops it
+bool Shader::finishReload()
+{
+    GLuint program = m_reloadID;
+    m_reloadID = 0;
+
+    if (!checkAndDeleteStages(program))
+    {
+        std::cout << "ERROR::SHADER::RELOAD_FAILED: keeping the previous program" << std::endl;
+        glDeleteProgram(program);
+        return false;
+    }
+
+    glDeleteProgram(m_ID);
+    m_ID = program;
+    m_fromBinaryCache = false;
+    if (!m_binaryPath.empty())
+        saveProgramBinary(m_binaryPath);
+    // Handles keep working: they are resolved again against the new program
+    cacheUniformLocations();
+    return true;
+}
+
+// ------------------------------------------------------------------------
+// program binary cache
+void Shader::setBinaryCacheDirectory(const std::string& directory)
+{
+    s_binaryCacheDirectory = directory;
+    if (!directory.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+}
+
+bool Shader::isFromBinaryCache() const
+{
+    return m_fromBinaryCache;
+}
+
+// A binary is only valid for the exact same sources on the exact same driver, 
+// both are part of the key. Returns an empty path when the cache is disabled or unsupported.
+std::string Shader::getBinaryCachePath(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode) const
+{
+    if (s_binaryCacheDirectory.empty() || !GLExt::programBinary)
+        return std::string();
+
+    uint64_t key = FNV1A_64_OFFSET;
+    key = hashString(vertexCode, key);
+    key = hashString(fragmentCode, key);
+    key = hashString(geometryCode, key);
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : driverStrings)
+    {
+        const char* value = (const char*)glGetString(name);
+        key = hashString(value != nullptr ? value : "", key);
+    }
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(s_binaryCacheDirectory) / fileName).string();
+}
+
+bool Shader::loadProgramBinary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    uint32_t magic = 0;
+    GLenum format = 0;
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&format, sizeof(format));
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (magic != PROGRAM_BINARY_MAGIC || binary.empty())
+        return false;
+
+    m_ID = glCreateProgram();
+    GLExt::ProgramBinary(m_ID, format, binary.data(), (GLsizei)binary.size());
+
+    // The driver rejects binaries from other versions (after an update for instance): fall back to the sources
+    GLint success = 0;
+    glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(m_ID);
+        m_ID = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::saveProgramBinary(const std::string& path) const
+{
+    GLint success = 0;
+    GLint length = 0;
+    glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
+    glGetProgramiv(m_ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLExt::GetProgramBinary(m_ID, length, NULL, &format, binary.data());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::SHADER::BINARY_CACHE_NOT_WRITABLE: " << path << std::endl;
+        return;
+    }
+    file.write((const char*)&PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+    file.write((const char*)&format, sizeof(format));
+    file.write(binary.data(), binary.size());
+}
 
 void Shader::use()
 {
-    glUseProgram(m_ID);
+    GLState::get().useProgram(m_ID);
 }
 
 // utility uniform functions
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(m_ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
 }
 // ------------------------------------------------------------------------
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(m_ID, name.c_str()), value);
+    glUniform1i(getUniformLocation(name), value);
 }
 // ------------------------------------------------------------------------
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(m_ID, name.c_str()), value);
+    glUniform1f(getUniformLocation(name), value);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(m_ID, name.c_str()), x, y);
+    glUniform2f(getUniformLocation(name), x, y);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(m_ID, name.c_str()), x, y, z);
+    glUniform3f(getUniformLocation(name), x, y, z);
 }
 // ------------------------------------------------------------------------
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(m_ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(getUniformLocation(name), 1, &value[0]);
 }
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w)
 {
-    glUniform4f(glGetUniformLocation(m_ID, name.c_str()), x, y, z, w);
+    glUniform4f(getUniformLocation(name), x, y, z, w);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(m_ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+// ------------------------------------------------------------------------
+// uniform location cache
+void Shader::cacheUniformLocations()
+{
+    m_uniformLocations.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLsizei nameLength = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), nameLength);
+
+        // Uniforms stored in a uniform block have no location
+        GLint location = glGetUniformLocation(m_ID, name.c_str());
+        if (location < 0)
+            continue;
+        m_uniformLocations[name] = location;
+
+        // Arrays of basic types are only reported once, as "name[0]": register the bare name and every element
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+        {
+            std::string baseName = name.substr(0, name.size() - 3);
+            m_uniformLocations[baseName] = location;
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                m_uniformLocations[elementName] = glGetUniformLocation(m_ID, elementName.c_str());
+            }
+        }
+    }
+
+    // Handles given out before a relink keep pointing to the same name
+    for (size_t handle = 0; handle < m_handleNames.size(); handle++)
+    {
+        std::unordered_map<std::string, GLint>::const_iterator it = m_uniformLocations.find(m_handleNames[handle]);
+        m_handleLocations[handle] = it != m_uniformLocations.end() ? it->second : -1;
+        // A new program starts with its own uniform values
+        m_handleSamplerUnits[handle] = -1;
+    }
+}
+
+UniformHandle Shader::getUniformHandle(const std::string& name)
+{
+    for (size_t handle = 0; handle < m_handleNames.size(); handle++)
+    {
+        if (m_handleNames[handle] == name)
+            return (UniformHandle)handle;
+    }
+
+    m_handleNames.push_back(name);
+    m_handleLocations.push_back(getUniformLocation(name));
+    m_handleSamplerUnits.push_back(-1);
+    return (UniformHandle)(m_handleNames.size() - 1);
+}
+
+// Unknown or inactive uniforms return -1, which glUniform* silently ignores
+GLint Shader::getUniformLocation(const std::string& name) const
+{
+    m_uniformLookupCount++;
+    std::unordered_map<std::string, GLint>::const_iterator it = m_uniformLocations.find(name);
+    return it != m_uniformLocations.end() ? it->second : -1;
+}
+
+unsigned int Shader::getUniformLookupCount() const
+{
+    return m_uniformLookupCount;
+}
+
+void Shader::resetUniformLookupCount()
+{
+    m_uniformLookupCount = 0;
+}
+
+void Shader::bindUniformBlock(const std::string& blockName, GLuint bindingPoint) const
+{
+    GLuint blockIndex = glGetUniformBlockIndex(m_ID, blockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX)
+    {
+        std::cout << "ERROR::SHADER::UNIFORM_BLOCK_NOT_FOUND: " << blockName << std::endl;
+        return;
+    }
+    glUniformBlockBinding(m_ID, blockIndex, bindingPoint);
+}
+
+// ------------------------------------------------------------------------
+// utility uniform functions taking a handle
+void Shader::setBool(UniformHandle handle, bool value) const
+{
+    glUniform1i(m_handleLocations[handle], (int)value);
+}
+// ------------------------------------------------------------------------
+void Shader::setInt(UniformHandle handle, int value) const
+{
+    glUniform1i(m_handleLocations[handle], value);
+}
+// ------------------------------------------------------------------------
+void Shader::setFloat(UniformHandle handle, float value) const
+{
+    glUniform1f(m_handleLocations[handle], value);
+}
+// ------------------------------------------------------------------------
+void Shader::setVec2(UniformHandle handle, const glm::vec2& value) const
+{
+    glUniform2fv(m_handleLocations[handle], 1, &value[0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setVec3(UniformHandle handle, const glm::vec3& value) const
+{
+    glUniform3fv(m_handleLocations[handle], 1, &value[0]);
+}
+void Shader::setVec3(UniformHandle handle, float x, float y, float z) const
+{
+    glUniform3f(m_handleLocations[handle], x, y, z);
+}
+// ------------------------------------------------------------------------
+void Shader::setVec4(UniformHandle handle, const glm::vec4& value) const
+{
+    glUniform4fv(m_handleLocations[handle], 1, &value[0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setMat3(UniformHandle handle, const glm::mat3& mat) const
+{
+    glUniformMatrix3fv(m_handleLocations[handle], 1, GL_FALSE, &mat[0][0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setMat4(UniformHandle handle, const glm::mat4& mat) const
+{
+    glUniformMatrix4fv(m_handleLocations[handle], 1, GL_FALSE, &mat[0][0]);
+}
+// ------------------------------------------------------------------------
+void Shader::setSampler(UniformHandle handle, int unit)
+{
+    if (m_handleSamplerUnits[handle] == unit)
+        return;
+    glUniform1i(m_handleLocations[handle], unit);
+    m_handleSamplerUnits[handle] = unit;
+}
+
+// The defines go right after #version, which must stay the first directive of the stage. 
+// A #line directive follows them so that error messages keep the line numbers of the file.
+std::string Shader::injectDefines(const std::string& source, const ShaderDefines& defines)
+{
+    std::string result = source;
+
+    size_t insertAt = 0;
+    size_t versionAt = result.find("#version");
+    if (versionAt != std::string::npos)
+    {
+        size_t endOfLine = result.find('\n', versionAt);
+        if (endOfLine == std::string::npos)
+        {
+            result += '\n';
+            endOfLine = result.size() - 1;
+        }
+        insertAt = endOfLine + 1;
+    }
+    int nextLine = 1 + (int)std::count(result.begin(), result.begin() + insertAt, '\n');
+
+    std::string injected;
+    for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+        injected += "#define " + it->first + " " + it->second + "\n";
+    // GLSL 3.30: the line following "#line N" is line N
+    injected += "#line " + std::to_string(nextLine) + "\n";
+
+    result.insert(insertAt, injected);
+    return result;
 }
 
-void Shader::checkCompileErrors(GLuint shader, std::string type)
+bool Shader::checkCompileErrors(GLuint shader, std::string type)
 {
     GLint success;
     GLchar infoLog[1024];
@@ -164,7 +664,7 @@ void Shader::checkCompileErrors(GLuint shader, std::string type)
         if (!success)
         {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << ShaderPreprocessor::remapErrorLog(infoLog) << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
     else
@@ -176,4 +676,5 @@ void Shader::checkCompileErrors(GLuint shader, std::string type)
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success != GL_FALSE;
 }
@@ -0,0 +1,48 @@
+#include "../header/ShaderCompileWorker.h"
+
+ShaderCompileWorker::ShaderCompileWorker(std::function<void()> makeContextCurrent, std::function<void()> releaseContext)
+    : m_makeContextCurrent(makeContextCurrent), m_releaseContext(releaseContext), m_stop(false)
+{
+    // Started last, once every member it uses is initialised
+    m_thread = std::thread(&ShaderCompileWorker::run, this);
+}
+
+ShaderCompileWorker::~ShaderCompileWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+}
+
+void ShaderCompileWorker::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(job);
+    }
+    m_condition.notify_one();
+}
+
+void ShaderCompileWorker::run()
+{
+    m_makeContextCurrent();
+
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                break;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+        job();
+    }
+
+    m_releaseContext();
+}
@@ -0,0 +1,144 @@
+#include "../header/ShaderFileWatcher.h"
+#include "../header/ShaderPreprocessor.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <filesystem>
+#else
+#include <chrono>
+#endif
+
+// How often the thread checks that it must stop (Linux) or polls the files (elsewhere)
+const int WATCH_PERIOD_MS = 250;
+
+ShaderFileWatcher::ShaderFileWatcher()
+    : m_generation(0), m_running(true)
+{
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0)
+        std::cout << "ERROR::SHADER_FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+#endif
+    // Started last, once every member it uses is initialised
+    m_thread = std::thread(&ShaderFileWatcher::run, this);
+}
+
+ShaderFileWatcher::~ShaderFileWatcher()
+{
+    m_running.store(false);
+    m_thread.join();
+#ifdef __linux__
+    if (m_inotify >= 0)
+        close(m_inotify);
+#endif
+}
+
+void ShaderFileWatcher::watch(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_changes.find(path) != m_changes.end())
+        return;
+    m_changes[path] = 0;
+
+#ifdef __linux__
+    if (m_inotify < 0)
+        return;
+    // One watch per directory: adding it again returns the same descriptor
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int descriptor = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (descriptor < 0)
+        std::cout << "ERROR::SHADER_FILE_WATCHER::CANNOT_WATCH: " << directory << std::endl;
+    else
+        m_directories[descriptor] = directory;
+#else
+    std::error_code error;
+    m_writeTimes[path] = std::filesystem::last_write_time(path, error);
+#endif
+}
+
+uint64_t ShaderFileWatcher::getGeneration() const
+{
+    return m_generation.load(std::memory_order_acquire);
+}
+
+bool ShaderFileWatcher::hasChangedSince(const std::vector<std::string>& paths, uint64_t generation) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::string& path : paths)
+    {
+        std::unordered_map<std::string, uint64_t>::const_iterator it = m_changes.find(path);
+        if (it != m_changes.end() && it->second > generation)
+            return true;
+    }
+    return false;
+}
+
+// Called on the watcher thread with m_mutex locked
+void ShaderFileWatcher::onFileChanged(const std::string& path)
+{
+    std::unordered_map<std::string, uint64_t>::iterator it = m_changes.find(path);
+    if (it == m_changes.end())
+        return;
+
+    // The next build reads the file again instead of using the preprocessor's copy
+    ShaderPreprocessor::invalidate(path);
+    it->second = m_generation.load() + 1;
+    m_generation.store(it->second, std::memory_order_release);
+}
+
+#ifdef __linux__
+void ShaderFileWatcher::run()
+{
+    if (m_inotify < 0)
+        return;
+
+    // Large enough for several events, aligned like the structure read into it
+    alignas(struct inotify_event) char buffer[4096];
+    while (m_running.load())
+    {
+        pollfd descriptor = { m_inotify, POLLIN, 0 };
+        if (poll(&descriptor, 1, WATCH_PERIOD_MS) <= 0)
+            continue;
+
+        ssize_t length;
+        while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (char* event = buffer; event < buffer + length; )
+            {
+                const inotify_event* info = (const inotify_event*)event;
+                std::unordered_map<int, std::string>::const_iterator directory = m_directories.find(info->wd);
+                if (info->len > 0 && directory != m_directories.end())
+                    onFileChanged((std::filesystem::path(directory->second) / info->name).string());
+                event += sizeof(inotify_event) + info->len;
+            }
+        }
+    }
+}
+#else
+void ShaderFileWatcher::run()
+{
+    while (m_running.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_PERIOD_MS));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::pair<const std::string, std::filesystem::file_time_type>& file : m_writeTimes)
+        {
+            // A file being replaced may briefly not exist: keep the last time until it is back
+            std::error_code error;
+            std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file.first, error);
+            if (!error && writeTime != file.second)
+            {
+                file.second = writeTime;
+                onFileChanged(file.first);
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,222 @@
+#include "../header/ShaderPreprocessor.h"
+#include "../header/Hash.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+std::mutex ShaderPreprocessor::s_mutex;
+std::vector<ShaderPreprocessor::FileEntry> ShaderPreprocessor::s_files;
+std::unordered_map<std::string, size_t> ShaderPreprocessor::s_fileNumbers;
+std::unordered_map<uint64_t, ShaderPreprocessor::ParsedSource> ShaderPreprocessor::s_sources;
+unsigned int ShaderPreprocessor::s_fileReadCount = 0;
+
+bool ShaderPreprocessor::load(const std::string& path, std::string& source, std::vector<std::string>* dependencies)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    source.clear();
+    std::unordered_set<size_t> included;
+    return expand(getFileNumber(canonicalPath(path)), true, source, included, dependencies);
+}
+
+void ShaderPreprocessor::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    std::unordered_map<std::string, size_t>::const_iterator it = s_fileNumbers.find(canonicalPath(path));
+    if (it != s_fileNumbers.end())
+        s_files[it->second - 1].loaded = false;
+}
+
+unsigned int ShaderPreprocessor::getFileReadCount()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_fileReadCount;
+}
+
+// ------------------------------------------------------------------------
+// files
+std::string ShaderPreprocessor::canonicalPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
+
+// File numbers never change, even when a file is reloaded
+size_t ShaderPreprocessor::getFileNumber(const std::string& canonical)
+{
+    std::unordered_map<std::string, size_t>::const_iterator it = s_fileNumbers.find(canonical);
+    if (it != s_fileNumbers.end())
+        return it->second;
+
+    FileEntry entry;
+    entry.path = canonical;
+    entry.hash = 0;
+    entry.loaded = false;
+    s_files.push_back(entry);
+    s_fileNumbers[canonical] = s_files.size();
+    return s_files.size();
+}
+
+const ShaderPreprocessor::ParsedSource* ShaderPreprocessor::readFile(size_t fileNumber)
+{
+    FileEntry& entry = s_files[fileNumber - 1];
+    if (!entry.loaded)
+    {
+        std::ifstream file(entry.path, std::ios::binary);
+        if (!file)
+            return nullptr;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string text = stream.str();
+        s_fileReadCount++;
+
+        // Files with the same content share their parsed source
+        uint64_t previousHash = entry.hash;
+        entry.hash = hashString(text);
+        entry.loaded = true;
+        if (s_sources.find(entry.hash) == s_sources.end())
+            s_sources[entry.hash] = parse(text);
+        // Reloaded with new content: the old version goes, unless another file still has it
+        if (previousHash != 0 && previousHash != entry.hash)
+            releaseSource(previousHash);
+    }
+    return &s_sources[entry.hash];
+}
+
+void ShaderPreprocessor::releaseSource(uint64_t hash)
+{
+    for (const FileEntry& file : s_files)
+    {
+        if (file.loaded && file.hash == hash)
+            return;
+    }
+    s_sources.erase(hash);
+}
+
+ShaderPreprocessor::ParsedSource ShaderPreprocessor::parse(const std::string& text)
+{
+    ParsedSource parsed;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        // #include "path" (or <path>), spaces allowed around the '#'
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line[start] == '#')
+        {
+            size_t directive = line.find_first_not_of(" \t", start + 1);
+            if (directive != std::string::npos && line.compare(directive, 7, "include") == 0)
+            {
+                size_t open = line.find_first_of("\"<", directive + 7);
+                size_t close = open != std::string::npos ? line.find_first_of("\">", open + 1) : std::string::npos;
+                if (close != std::string::npos)
+                    parsed.includes[parsed.lines.size()] = line.substr(open + 1, close - open - 1);
+            }
+        }
+        parsed.lines.push_back(line);
+    }
+    return parsed;
+}
+
+// ------------------------------------------------------------------------
+// expansion
+bool ShaderPreprocessor::expand(size_t fileNumber, bool isRoot, std::string& source, std::unordered_set<size_t>& included, std::vector<std::string>* dependencies)
+{
+    included.insert(fileNumber);
+    const std::string path = s_files[fileNumber - 1].path;
+    if (dependencies != nullptr)
+        dependencies->push_back(path);
+
+    const ParsedSource* parsed = readFile(fileNumber);
+    if (parsed == nullptr)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    const std::string number = std::to_string(fileNumber);
+
+    // #version has to stay the first directive of the root file: the numbering starts after it
+    size_t firstLine = 0;
+    if (isRoot)
+    {
+        for (size_t i = 0; i < parsed->lines.size(); i++)
+        {
+            if (parsed->lines[i].find("#version") != std::string::npos)
+            {
+                for (size_t j = 0; j <= i; j++)
+                    source += parsed->lines[j] + "\n";
+                firstLine = i + 1;
+                break;
+            }
+        }
+    }
+    // GLSL 3.30: the line following "#line N S" is line N of source string S
+    source += "#line " + std::to_string(firstLine + 1) + " " + number + "\n";
+
+    bool success = true;
+    for (size_t i = firstLine; i < parsed->lines.size(); i++)
+    {
+        std::unordered_map<size_t, std::string>::const_iterator include = parsed->includes.find(i);
+        if (include == parsed->includes.end())
+        {
+            // An included file must not redeclare the version
+            if (!isRoot && parsed->lines[i].find("#version") != std::string::npos)
+                source += "\n";
+            else
+                source += parsed->lines[i] + "\n";
+            continue;
+        }
+
+        std::filesystem::path includePath = std::filesystem::path(path).parent_path() / include->second;
+        size_t includeNumber = getFileNumber(canonicalPath(includePath.string()));
+        if (included.count(includeNumber) != 0)
+        {
+            // Already expanded in this program, the empty line keeps the numbering
+            source += "\n";
+            continue;
+        }
+
+        success = expand(includeNumber, false, source, included, dependencies) && success;
+        // Back to this file, on the line after the directive
+        source += "#line " + std::to_string(i + 2) + " " + number + "\n";
+    }
+    return success;
+}
+
+// ------------------------------------------------------------------------
+// error messages
+
+// Compilers print the location as "S(L)" (NVIDIA), "S:L" (Mesa, Intel) or "ERROR: S:L" (AMD)
+std::string ShaderPreprocessor::remapErrorLog(const std::string& log)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    static const std::regex location("^(\\s*(?:ERROR|WARNING)?:?\\s*)(\\d+)([:(]\\d+)");
+
+    std::istringstream stream(log);
+    std::string result;
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::smatch match;
+        if (std::regex_search(line, match, location))
+        {
+            size_t fileNumber = std::stoul(match[2].str());
+            if (fileNumber >= 1 && fileNumber <= s_files.size())
+            {
+                std::string fileName = std::filesystem::path(s_files[fileNumber - 1].path).filename().string();
+                line = match[1].str() + fileName + match[3].str() + match.suffix().str();
+            }
+        }
+        result += line + "\n";
+    }
+    return result;
+}
@@ -0,0 +1,34 @@
+#include "../header/ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geometryPath, ShaderBuildMode buildMode)
+    : m_vertexPath(vertexPath), m_fragmentPath(fragmentPath), m_geometryPath(geometryPath != nullptr ? geometryPath : ""), m_buildMode(buildMode)
+{
+
+}
+
+Shader& ShaderVariants::get(const ShaderDefines& defines)
+{
+    std::string key = makeKey(defines);
+    std::unordered_map<std::string, std::unique_ptr<Shader>>::iterator it = m_variants.find(key);
+    if (it != m_variants.end())
+        return *it->second;
+
+    const char* geometryPath = m_geometryPath.empty() ? nullptr : m_geometryPath.c_str();
+    std::unique_ptr<Shader> variant(new Shader(m_vertexPath.c_str(), m_fragmentPath.c_str(), geometryPath, m_buildMode, defines));
+    Shader& shader = *variant;
+    m_variants[key] = std::move(variant);
+    return shader;
+}
+
+size_t ShaderVariants::getVariantCount() const
+{
+    return m_variants.size();
+}
+
+std::string ShaderVariants::makeKey(const ShaderDefines& defines)
+{
+    std::string key;
+    for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); ++it)
+        key += it->first + "=" + it->second + ";";
+    return key;
+}
@@ -0,0 +1,159 @@
+#include "../header/Std140.h"
+
+#include <cstring>
+
+Std140Buffer::Std140Buffer() : m_dirtyBegin(0), m_dirtyEnd(0)
+{
+
+}
+
+// ------------------------------------------------------------------------
+// layout
+size_t Std140Buffer::push(size_t alignment, size_t size)
+{
+    size_t offset = (m_data.size() + alignment - 1) / alignment * alignment;
+    m_data.resize(offset + size, 0);
+
+    // A freshly pushed member has never been uploaded
+    m_dirtyEnd = m_data.size();
+    return offset;
+}
+
+size_t Std140Buffer::pushFloat()
+{
+    return push(4, 4);
+}
+
+size_t Std140Buffer::pushInt()
+{
+    return push(4, 4);
+}
+
+size_t Std140Buffer::pushVec2()
+{
+    return push(8, 8);
+}
+
+// A vec3 is aligned like a vec4 but only takes 12 bytes: a scalar pushed right after fills the gap
+size_t Std140Buffer::pushVec3()
+{
+    return push(16, 12);
+}
+
+size_t Std140Buffer::pushVec4()
+{
+    return push(16, 16);
+}
+
+// Matrices are stored as arrays of column vectors, each column padded to a vec4
+size_t Std140Buffer::pushMat3()
+{
+    return push(16, 3 * 16);
+}
+
+size_t Std140Buffer::pushMat4()
+{
+    return push(16, 4 * 16);
+}
+
+size_t Std140Buffer::beginStruct()
+{
+    return push(16, 0);
+}
+
+// The member following a struct starts on the next multiple of 16
+void Std140Buffer::endStruct()
+{
+    push(16, 0);
+}
+
+// ------------------------------------------------------------------------
+// values
+void Std140Buffer::write(size_t offset, const void* source, size_t size)
+{
+    if (std::memcmp(&m_data[offset], source, size) == 0)
+        return;
+
+    std::memcpy(&m_data[offset], source, size);
+    if (m_dirtyBegin == m_dirtyEnd)
+    {
+        m_dirtyBegin = offset;
+        m_dirtyEnd = offset + size;
+    }
+    else
+    {
+        if (offset < m_dirtyBegin)
+            m_dirtyBegin = offset;
+        if (offset + size > m_dirtyEnd)
+            m_dirtyEnd = offset + size;
+    }
+}
+
+void Std140Buffer::setFloat(size_t offset, float value)
+{
+    write(offset, &value, sizeof(float));
+}
+
+void Std140Buffer::setInt(size_t offset, int value)
+{
+    write(offset, &value, sizeof(int));
+}
+
+void Std140Buffer::setVec2(size_t offset, const glm::vec2& value)
+{
+    write(offset, &value[0], 2 * sizeof(float));
+}
+
+void Std140Buffer::setVec3(size_t offset, const glm::vec3& value)
+{
+    write(offset, &value[0], 3 * sizeof(float));
+}
+
+void Std140Buffer::setVec4(size_t offset, const glm::vec4& value)
+{
+    write(offset, &value[0], 4 * sizeof(float));
+}
+
+void Std140Buffer::setMat3(size_t offset, const glm::mat3& mat)
+{
+    for (int column = 0; column < 3; column++)
+        write(offset + column * 16, &mat[column][0], 3 * sizeof(float));
+}
+
+void Std140Buffer::setMat4(size_t offset, const glm::mat4& mat)
+{
+    write(offset, &mat[0][0], 16 * sizeof(float));
+}
+
+// ------------------------------------------------------------------------
+// data
+const unsigned char* Std140Buffer::data() const
+{
+    return m_data.data();
+}
+
+size_t Std140Buffer::size() const
+{
+    return m_data.size();
+}
+
+bool Std140Buffer::isDirty() const
+{
+    return m_dirtyEnd > m_dirtyBegin;
+}
+
+size_t Std140Buffer::getDirtyBegin() const
+{
+    return m_dirtyBegin;
+}
+
+size_t Std140Buffer::getDirtyEnd() const
+{
+    return m_dirtyEnd;
+}
+
+void Std140Buffer::clearDirty()
+{
+    m_dirtyBegin = 0;
+    m_dirtyEnd = 0;
+}
@@ -0,0 +1,167 @@
+#include "../header/TextureCache.h"
+#include "../header/GLState.h"
+#include "../header/Hash.h"
+#include "../header/TextureStreamer.h"
+#include "../header/stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+TextureCache::TextureCache(TextureStreamer& streamer)
+    : m_streamer(streamer)
+{
+}
+
+// ------------------------------------------------------------------------
+// references
+void TextureCache::prefetch(const std::vector<std::string>& paths)
+{
+    std::vector<std::string> canonicalPaths;
+    for (const std::string& path : paths)
+    {
+        std::string canonical = canonicalPath(path);
+        if (m_paths.find(canonical) == m_paths.end() && m_prefetched.find(canonical) == m_prefetched.end())
+            canonicalPaths.push_back(canonical);
+    }
+
+    std::vector<MappedFile> files = mapFiles(canonicalPaths);
+    std::shared_ptr<PrefetchBatch> batch(new PrefetchBatch());
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!files[i].isOpen())
+            continue;
+        m_prefetched[canonicalPaths[i]] = std::make_pair(batch, batch->files.size());
+        batch->files.push_back(std::move(files[i]));
+    }
+    if (batch->files.empty())
+        return;
+    batch->digests.resize(batch->files.size());
+
+    // Reading the pages to hash them is file I/O: not on the render thread. The batch owns the futures,
+    // so it outlives the threads. hardware_concurrency() is 0 when unknown.
+    size_t threadCount = std::min(batch->files.size(), (size_t)std::max(1u, std::thread::hardware_concurrency()));
+    PrefetchBatch* hashedBatch = batch.get();
+    for (size_t thread = 0; thread < threadCount; thread++)
+    {
+        batch->hashed.push_back(std::async(std::launch::async, [hashedBatch, thread, threadCount]()
+        {
+            for (size_t i = thread; i < hashedBatch->files.size(); i += threadCount)
+            {
+                const MappedFile& file = hashedBatch->files[i];
+                FileDigest& digest = hashedBatch->digests[i];
+                digest.contentHash = hashBytes(file.data(), file.size());
+                // Size from the header only, the decode is the streamer's job. The streamer uploads RGBA whatever
+                // the file holds (4 bytes a texel), and a full mip chain adds a third. stbi takes an int length.
+                digest.bytes = 0;
+                int width, height, components;
+                if (file.size() <= (size_t)INT_MAX && stbi_info_from_memory(file.data(), (int)file.size(), &width, &height, &components))
+                    digest.bytes = (size_t)width * height * 4 * 4 / 3;
+            }
+        }));
+    }
+}
+
+GLuint TextureCache::acquire(const std::string& path)
+{
+    std::string canonical = canonicalPath(path);
+
+    std::unordered_map<std::string, GLuint>::const_iterator pathIt = m_paths.find(canonical);
+    if (pathIt != m_paths.end())
+    {
+        m_entries[pathIt->second].references++;
+        m_stats.pathHits++;
+        return pathIt->second;
+    }
+
+    // Not prefetched: shared by path only, the streamer's thread maps the file
+    Entry entry = { false, 0, 1, 0 };
+    MappedFile file;
+    std::unordered_map<std::string, std::pair<std::shared_ptr<PrefetchBatch>, size_t>>::iterator prefetchedIt = m_prefetched.find(canonical);
+    if (prefetchedIt != m_prefetched.end())
+    {
+        std::shared_ptr<PrefetchBatch> batch = prefetchedIt->second.first;
+        size_t index = prefetchedIt->second.second;
+        m_prefetched.erase(prefetchedIt);
+        // Only blocks if the thread hashing the file is not done yet
+        batch->hashed[index % batch->hashed.size()].wait();
+        file = std::move(batch->files[index]);
+        entry = { true, batch->digests[index].contentHash, 1, batch->digests[index].bytes };
+
+        // Same image under another path: the path now leads to it too
+        std::unordered_map<uint64_t, GLuint>::const_iterator contentIt = m_contents.find(entry.contentHash);
+        if (contentIt != m_contents.end())
+        {
+            m_paths[canonical] = contentIt->second;
+            m_entries[contentIt->second].references++;
+            m_stats.contentHits++;
+            return contentIt->second;
+        }
+    }
+
+    GLuint texture = m_streamer.request(canonical, std::move(file));
+    m_entries[texture] = entry;
+    m_paths[canonical] = texture;
+    if (entry.hashed)
+        m_contents[entry.contentHash] = texture;
+    m_stats.misses++;
+    return texture;
+}
+
+void TextureCache::release(GLuint texture)
+{
+    std::unordered_map<GLuint, Entry>::iterator it = m_entries.find(texture);
+    if (it == m_entries.end())
+        return;
+    if (--it->second.references == 0)
+        destroy(texture);
+}
+
+void TextureCache::clear()
+{
+    m_prefetched.clear();
+    while (!m_entries.empty())
+        destroy(m_entries.begin()->first);
+}
+
+void TextureCache::destroy(GLuint texture)
+{
+    const Entry& entry = m_entries[texture];
+    if (entry.hashed)
+        m_contents.erase(entry.contentHash);
+    // Every path leading to it
+    for (std::unordered_map<std::string, GLuint>::iterator it = m_paths.begin(); it != m_paths.end();)
+    {
+        if (it->second == texture)
+            it = m_paths.erase(it);
+        else
+            ++it;
+    }
+    m_entries.erase(texture);
+
+    // Not uploaded yet: the upload would recreate the name
+    m_streamer.cancel(texture);
+    GLState::get().forgetTexture(texture);
+    glDeleteTextures(1, &texture);
+}
+
+// ------------------------------------------------------------------------
+// statistics
+TextureCacheStats TextureCache::getStats() const
+{
+    TextureCacheStats stats = m_stats;
+    stats.residentTextures = m_entries.size();
+    for (const std::pair<const GLuint, Entry>& entry : m_entries)
+        stats.residentBytes += entry.second.bytes != 0 ? entry.second.bytes : m_streamer.getTextureBytes(entry.first);
+    return stats;
+}
+
+std::string TextureCache::canonicalPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? path : canonical.string();
+}
@@ -0,0 +1,260 @@
+#include "../header/TextureStreamer.h"
+#include "../header/GLState.h"
+#include "../header/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer(unsigned int threadCount, size_t uploadBudgetBytes, double uploadBudgetMs, const MipOptions& mipOptions)
+    : m_uploadBudgetBytes(uploadBudgetBytes), m_uploadBudgetMs(uploadBudgetMs), m_mipOptions(mipOptions), m_pixelBuffer(0), m_pendingCount(0), 
+    m_stop(false), m_uploadedTextures(0), m_uploadedBytes(0)
+{
+    // The decode threads already run side by side
+    m_mipOptions.threadCount = 1;
+
+    glGenBuffers(1, &m_pixelBuffer);
+
+    if (threadCount == 0)
+    {
+        // One core left to the render thread. hardware_concurrency() is 0 when unknown.
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 1;
+    }
+    // Started last, once every member they use is initialised
+    for (unsigned int i = 0; i < threadCount; i++)
+        m_threads.push_back(std::thread(&TextureStreamer::run, this));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void TextureStreamer::deleteBuffers()
+{
+    GLState::get().forgetBuffer(m_pixelBuffer);
+    glDeleteBuffers(1, &m_pixelBuffer);
+    m_pixelBuffer = 0;
+}
+
+GLuint TextureStreamer::request(const std::string& path)
+{
+    return request(path, MappedFile());
+}
+
+GLuint TextureStreamer::request(const std::string& path, MappedFile file)
+{
+    GLuint texture = createPlaceholder();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({ path, texture, std::move(file) });
+        m_requested.insert(texture);
+        m_pendingCount++;
+    }
+    m_condition.notify_one();
+    return texture;
+}
+
+void TextureStreamer::cancel(GLuint texture)
+{
+    m_textureBytes.erase(texture);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Already uploaded (or cancelled)
+    if (m_requested.erase(texture) == 0)
+        return;
+
+    for (std::deque<Job>::iterator it = m_jobs.begin(); it != m_jobs.end(); ++it)
+    {
+        if (it->texture == texture)
+        {
+            m_jobs.erase(it);
+            m_pendingCount--;
+            return;
+        }
+    }
+    // Being decoded or waiting for its upload: dropped by update()
+    m_cancelled.insert(texture);
+}
+
+GLuint TextureStreamer::createPlaceholder() const
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+
+    // Mid grey until the image arrives
+    const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+    GLState::get().bindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+// ------------------------------------------------------------------------
+// decode threads
+void TextureStreamer::run()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                break;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        DecodedImage image = { job.texture, 0, 0, std::unique_ptr<unsigned char, void (*)(void*)>(nullptr, stbi_image_free), std::vector<MipLevel>() };
+        // Straight from the page cache, no copy through a read buffer
+        if (!job.file.isOpen())
+            job.file = MappedFile(job.path);
+        // Always RGBA: the mips are built on 4 channels, and the drivers pad RGB8 textures to 32 bits anyway
+        int components;
+        if (job.file.data() != nullptr && job.file.size() <= (size_t)INT_MAX)
+            image.pixels.reset(stbi_load_from_memory(job.file.data(), (int)job.file.size(), &image.width, &image.height, &components, 4));
+        job.file.close();
+        if (image.pixels)
+            image.mips = generateMipChain(image.pixels.get(), image.width, image.height, m_mipOptions);
+        else
+            std::cout << "Texture failed to load at path: " << job.path << std::endl;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.push_back(std::move(image));
+    }
+}
+
+// ------------------------------------------------------------------------
+// uploads
+void TextureStreamer::update()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t frameBytes = 0;
+
+    while (true)
+    {
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (frameBytes >= m_uploadBudgetBytes || elapsedMs >= m_uploadBudgetMs)
+            break;
+
+        DecodedImage image = { 0, 0, 0, std::unique_ptr<unsigned char, void (*)(void*)>(nullptr, stbi_image_free), std::vector<MipLevel>() };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_decoded.empty())
+                break;
+            image = std::move(m_decoded.front());
+            m_decoded.pop_front();
+            m_pendingCount--;
+            if (m_cancelled.erase(image.texture) > 0)
+                continue;
+            m_requested.erase(image.texture);
+        }
+
+        // A failed load keeps its placeholder
+        if (!image.pixels)
+            continue;
+        // An image larger than the budget still goes through, alone in its frame
+        frameBytes += upload(image);
+    }
+
+    // Frames that had nothing to do are not counted
+    float stallMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (frameBytes > 0)
+        m_stallTimes.push_back(stallMs);
+}
+
+size_t TextureStreamer::upload(const DecodedImage& image)
+{
+    // Every level, one after the other in the pixel buffer
+    std::vector<const unsigned char*> levelPixels(1, image.pixels.get());
+    std::vector<size_t> levelSizes(1, (size_t)image.width * image.height * 4);
+    std::vector<size_t> levelOffsets(1, 0);
+    size_t size = levelSizes[0];
+    for (const MipLevel& mip : image.mips)
+    {
+        levelPixels.push_back(mip.rgba.data());
+        levelSizes.push_back(mip.rgba.size());
+        levelOffsets.push_back(size);
+        size += mip.rgba.size();
+    }
+
+    // The copy to the texture is done by the driver from the pixel buffer, asynchronously.
+    // Orphaned at each upload: the previous transfer does not have to finish first.
+    GLState& glState = GLState::get();
+    glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped != nullptr)
+    {
+        for (size_t level = 0; level < levelPixels.size(); level++)
+            std::memcpy(mapped + levelOffsets[level], levelPixels[level], levelSizes[level]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        // The mapping failed: straight from the decoded image instead. Unbound first: with a pixel buffer 
+        // bound, the pointers would be read as offsets in it.
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glState.bindTexture(GL_TEXTURE_2D, image.texture);
+    for (size_t level = 0; level < levelPixels.size(); level++)
+    {
+        int width = level == 0 ? image.width : image.mips[level - 1].width;
+        int height = level == 0 ? image.height : image.mips[level - 1].height;
+        const void* pixels = mapped != nullptr ? (const void*)levelOffsets[level] : (const void*)levelPixels[level];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+    glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.mips.size());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    m_textureBytes[image.texture] = size;
+    m_uploadedTextures++;
+    m_uploadedBytes += size;
+    return size;
+}
+
+// ------------------------------------------------------------------------
+// statistics
+size_t TextureStreamer::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingCount;
+}
+
+size_t TextureStreamer::getTextureBytes(GLuint texture) const
+{
+    std::unordered_map<GLuint, size_t>::const_iterator it = m_textureBytes.find(texture);
+    return it != m_textureBytes.end() ? it->second : 0;
+}
+
+TextureStreamStats TextureStreamer::getStats() const
+{
+    TextureStreamStats stats;
+    stats.frames = m_stallTimes.size();
+    stats.uploadedTextures = m_uploadedTextures;
+    stats.uploadedBytes = m_uploadedBytes;
+    if (m_stallTimes.empty())
+        return stats;
+
+    std::vector<float> sorted = m_stallTimes;
+    std::sort(sorted.begin(), sorted.end());
+    stats.p50StallMs = sorted[sorted.size() / 2];
+    stats.p99StallMs = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    stats.maxStallMs = sorted.back();
+    return stats;
+}
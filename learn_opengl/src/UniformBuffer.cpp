@@ -0,0 +1,39 @@
+#include "../header/UniformBuffer.h"
+#include "../header/GLState.h"
+
+#include <iostream>
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, GLuint bindingPoint) : m_bindingPoint(bindingPoint)
+{
+    // Blocks end on a vec4 boundary in std140
+    m_size = (size + 15) / 16 * 16;
+
+    glGenBuffers(1, &m_ID);
+    GLState::get().bindBuffer(GL_UNIFORM_BUFFER, m_ID);
+    // DYNAMIC_DRAW: the data store contents will be modified repeatedly and used many times
+    glBufferData(GL_UNIFORM_BUFFER, m_size, NULL, GL_DYNAMIC_DRAW);
+
+    GLState::get().bindBufferBase(GL_UNIFORM_BUFFER, m_bindingPoint, m_ID);
+}
+
+void UniformBuffer::upload(Std140Buffer& block)
+{
+    if (!block.isDirty())
+        return;
+
+    if ((GLsizeiptr)block.getDirtyEnd() > m_size)
+    {
+        std::cout << "ERROR::UNIFORM_BUFFER::BLOCK_LARGER_THAN_BUFFER" << std::endl;
+        return;
+    }
+
+    GLState::get().bindBuffer(GL_UNIFORM_BUFFER, m_ID);
+    glBufferSubData(GL_UNIFORM_BUFFER, block.getDirtyBegin(), block.getDirtyEnd() - block.getDirtyBegin(), block.data() + block.getDirtyBegin());
+
+    block.clearDirty();
+}
+
+GLuint UniformBuffer::getBindingPoint() const
+{
+    return m_bindingPoint;
+}
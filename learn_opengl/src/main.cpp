@@ -10,8 +10,34 @@
 
 #include <iostream>
 
+#include "../header/GLExtensions.h"
+#include "../header/GLState.h"
 #include "../header/Shader.h"
+#include "../header/ShaderCompileWorker.h"
+#include "../header/ShaderFileWatcher.h"
+#include "../header/ShaderVariants.h"
 #include "../header/Camera.h"
+#include "../header/LightBlock.h"
+#include "../header/FrameBlock.h"
+#include "../header/UniformBuffer.h"
+#include "../header/InstanceBuffer.h"
+#include "../header/NormalMatrix.h"
+#include "../header/PackedVertex.h"
+#include "../header/RenderTarget.h"
+#include "../header/CompressedImage.h"
+#include "../header/MappedFile.h"
+#include "../header/TextureCache.h"
+#include "../header/TextureStreamer.h"
+#include "../header/CompactIndices.h"
+#include "../header/GeometryArena.h"
+#include "../header/IndirectRenderer.h"
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
 
 // ----- CONSTANTS
 
@@ -21,6 +47,31 @@ const unsigned int SCR_HEIGHT = 1080;
 const float NEAR_PLANE = 0.1f;
 const float FAR_PLANE = 100.0f;
 
+const unsigned int NR_POINT_LIGHTS = LightBlock::MAX_POINT_LIGHTS;
+// Uniform buffer binding points
+const unsigned int LIGHT_BLOCK_BINDING = 0;
+const unsigned int FRAME_BLOCK_BINDING = 1;
+
+// Cube vertices in the compact layout (20 bytes instead of 32, see PackedVertex)
+const bool PACKED_VERTICES = true;
+// Cubes drawn from a geometry arena with multi-draw indirect, one call per program whatever the cube count
+const bool INDIRECT_DRAWS = true;
+// Shaders are rebuilt when their files are edited, without restarting the app.
+// A development feature: release builds (NDEBUG) start no file watcher.
+#ifdef NDEBUG
+const bool HOT_RELOAD_SHADERS = false;
+#else
+const bool HOT_RELOAD_SHADERS = true;
+#endif
+// No far plane and a float depth buffer with reverse-Z (when the driver has glClipControl, FAR_PLANE is then unused)
+const bool REVERSE_Z = true;
+// Textures decoded on worker threads and uploaded a few per frame, placeholders drawn meanwhile
+const bool STREAM_TEXTURES = true;
+// Block-compressed maps cooked by tools/texture_cooker (BC1: 1/8 of the VRAM), uploaded as they are.
+// Takes precedence over streaming; a map whose .ktx2 is missing loads its source image instead.
+const bool COMPRESSED_TEXTURES = false;
+// Linked shader programs are saved here, so that the next launches skip compilation
+const char* PATH_SHADER_CACHE = "shader_cache";
 const char* PATH_COLOR_VS = "1.colors.vs";
 const char* PATH_COLOR_FS = "1.colors.fs";
 const char* PATH_LIGHT_CUBE_VS = "1.light_cube.vs";
@@ -28,6 +79,10 @@ const char* PATH_LIGHT_CUBE_FS = "1.light_cube.fs";
 const char* PATH_TEXTURE_DIFFUSE = "../textures/container2_diffuse_map.png";
 const char* PATH_TEXTURE_SPECULAR = "../textures/container2_specular_map.png";
 const char* PATH_TEXTURE_EMISSIVE = "../textures/container2_emissive_map.jpg";
+// Cooked without --srgb: like loadTexture, the shaders take the colors as they are stored
+const char* PATH_COMPRESSED_DIFFUSE = "../textures/container2_diffuse_map.ktx2";
+const char* PATH_COMPRESSED_SPECULAR = "../textures/container2_specular_map.ktx2";
+const char* PATH_COMPRESSED_EMISSIVE = "../textures/container2_emissive_map.ktx2";
 
 // ----- CALLBACKS & FUNCTIONS
 
@@ -37,6 +92,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 unsigned int loadTexture(const char* path);
+unsigned int loadCompressedTexture(const char* path, const char* fallbackPath);
 
 // ----- CAMERA
 
@@ -104,16 +160,87 @@ int main()
         std::cout << "Failed to initialise GLAD" << std::endl;
         return -1;
     }
+    // Entry points that are not part of OpenGL 3.3 (only used when the driver has them)
+    GLExt::load((GLADloadproc)glfwGetProcAddress);
+
+    // ----- SHADER COMPILE WORKER
+
+    // Async shader builds run on the driver's own threads with KHR_parallel_shader_compile.
+    // Without it, they run on a worker thread whose context (a hidden window) shares objects with ours.
+    GLFWwindow* compileWindow = NULL;
+    std::unique_ptr<ShaderCompileWorker> compileWorker;
+    if (!GLExt::parallelShaderCompile)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        compileWindow = glfwCreateWindow(1, 1, "", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (compileWindow != NULL)
+        {
+            compileWorker.reset(new ShaderCompileWorker(
+                [compileWindow]() { glfwMakeContextCurrent(compileWindow); },
+                []() { glfwMakeContextCurrent(NULL); }));
+            Shader::setCompileWorker(compileWorker.get());
+        }
+    }
+
+    // ----- SHADER HOT RELOAD
+
+    // Set before the shaders are built: they register their files with it
+    std::unique_ptr<ShaderFileWatcher> shaderWatcher;
+    if (HOT_RELOAD_SHADERS)
+    {
+        shaderWatcher.reset(new ShaderFileWatcher());
+        Shader::setFileWatcher(shaderWatcher.get());
+    }
 
     // ----- Z BUFFER 
     
     glEnable(GL_DEPTH_TEST);
 
+    // Reverse-Z: depth 1 on the near plane and 0 at infinity (see Depth_Mode). The window has no 
+    // floating-point depth buffer, so the scene is drawn into a render target, then blitted.
+    std::unique_ptr<RenderTarget> sceneTarget;
+    if (REVERSE_Z && GLExt::clipControl)
+    {
+        GLExt::ClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        // Closer fragments now have the greater depth, the buffer is cleared to the farthest one
+        glDepthFunc(GL_GREATER);
+        glClearDepth(0.0);
+        camera.SetDepthMode(Depth_Mode::REVERSE_Z_INFINITE);
+        sceneTarget.reset(new RenderTarget(SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_COMPONENT32F));
+    }
+
+    // ----- TEXTURE FILES
+
+    // Streamed textures go through the cache, so that a path (or an image) used twice is loaded once. 
+    // Their files are prefetched first: the disk reads them and the cache hashes them in the background 
+    // while the programs and the geometry are set up, before they are acquired (see TEXTURE).
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    std::unique_ptr<TextureCache> textureCache;
+    if (!COMPRESSED_TEXTURES && STREAM_TEXTURES)
+    {
+        textureStreamer.reset(new TextureStreamer());
+        textureCache.reset(new TextureCache(*textureStreamer));
+        textureCache->prefetch({ PATH_TEXTURE_DIFFUSE, PATH_TEXTURE_SPECULAR, PATH_TEXTURE_EMISSIVE });
+    }
+
     // ----- SHADER PROGRAMS (build and compile)
 
     // Files are written by default in the dir containing "srd" and "header"
-    Shader lightingShader(PATH_COLOR_VS, PATH_COLOR_FS);
+    Shader::setBinaryCacheDirectory(PATH_SHADER_CACHE);
+    // The light cube program is tiny and doubles as the fallback drawn until the lighting program is ready
+    double shaderSetupStart = glfwGetTime();
+    // The lighting program is specialized for the scene: 4 point lights, the flashlight, a specular map
+    ShaderVariants lightingShaders(PATH_COLOR_VS, PATH_COLOR_FS, nullptr, ShaderBuildMode::Async);
+    ShaderDefines lightingDefines;
+    lightingDefines["NR_POINT_LIGHTS"] = std::to_string(NR_POINT_LIGHTS);
+    lightingDefines["USE_DIR_LIGHT"] = "1";
+    lightingDefines["USE_SPOT_LIGHT"] = "1";
+    lightingDefines["HAS_SPECULAR_MAP"] = "1";
+    lightingDefines["PACKED_VERTEX"] = PACKED_VERTICES ? "1" : "0";
+    Shader& lightingShader = lightingShaders.get(lightingDefines);
     Shader lightCubeShader(PATH_LIGHT_CUBE_VS, PATH_LIGHT_CUBE_FS);    
+    lightCubeShader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
 
     // ----- VERTEX DATA
 
@@ -206,54 +333,232 @@ int main()
     // -- Vertex buffer objects (and EBO ?) associated with vertex attributes by calls to glVertexAttribPointer
     // -- Vertex attribute configurations via glVertexAttribPointer
     // -- Calls to glEnableVertexAttribArray or glDisableVertexAttribArray
-    glBindVertexArray(cubeVAO);
+    // All the binds go through GLState, which drops those that would not change anything
+    GLState& glState = GLState::get();
+    glState.bindVertexArray(cubeVAO);
 
     // 3/ Bind VBO <-> make it the currently active vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // 4/ Copy the vertex array, located on the CPU, into the vertex buffer (GPU memory)
-    // STATIC_DRAW: the data store contents will be modified once and used many times
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // 5/ Define pointers to the vertex attributes
-    // Structure of the vertex attributes here: vertex position, normal and texture coords here
-    // from docs.GL: define an array of generic vertex attribute data
-    // Tell OpenGL how the vertex attributes are stored in one vertex
-    // glVertexAttribPointer(attributePos, nbChannelsInAttribute, dataType, shouldDataBeNormalised, strideAttrib, offsetWhereAttribBegins)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    std::vector<PackedVertex> packedVertices;
+    if (PACKED_VERTICES)
+    {
+        // 4/ Pack the vertices, then copy them into the vertex buffer (GPU memory)
+        VertexPackingReport packingReport;
+        packingReport.unpackedBytes = sizeof(vertices);
+        for (unsigned int i = 0; i < 36; i++)
+        {
+            const float* vertex = &vertices[i * 8];
+            packedVertices.push_back(packVertex(glm::vec3(vertex[0], vertex[1], vertex[2]), glm::vec3(vertex[3], vertex[4], vertex[5]), 
+                glm::vec2(vertex[6], vertex[7]), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), &packingReport));
+        }
+        printVertexPackingReport("cube", packingReport);
+        glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
+
+        // 5/ and 6/ Pointers to the packed attributes, enabled (no tangent: the cube is not normal mapped)
+        setPackedVertexAttributes(false);
+    }
+    else
+    {
+        // 4/ Copy the vertex array, located on the CPU, into the vertex buffer (GPU memory)
+        // STATIC_DRAW: the data store contents will be modified once and used many times
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+        // 5/ Define pointers to the vertex attributes
+        // Structure of the vertex attributes here: vertex position, normal and texture coords here
+        // from docs.GL: define an array of generic vertex attribute data
+        // Tell OpenGL how the vertex attributes are stored in one vertex
+        // glVertexAttribPointer(attributePos, nbChannelsInAttribute, dataType, shouldDataBeNormalised, strideAttrib, offsetWhereAttribBegins)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     
-    // 6/ Enable each attribute, so here, position, normal and texture
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+        // 6/ Enable each attribute, so here, position, normal and texture
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+    }
 
     // ----- LIGHT CUBE
 
     unsigned int lightCubeVAO;
     glGenVertexArrays(1, &lightCubeVAO);
-    glBindVertexArray(lightCubeVAO);
+    glState.bindVertexArray(lightCubeVAO);
     // We only need to bind to the VBO, the cube's VBO's data already contains the data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
     // Set the vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    if (PACKED_VERTICES)
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     // Enable position attribute 
     // No need to use the normal and texture attributes for the light cube
     glEnableVertexAttribArray(0);
 
+    // ----- INSTANCES
+
+    // Every cube is drawn through instancing: the per-object model and normal matrices
+    // are read from an instance buffer, so N cubes cost a single draw call.
+    std::vector<InstanceData> cubeInstances;
+    for (unsigned int i = 0; i < 10; i++)
+    {
+        InstanceData instance;
+        instance.model = glm::mat4(1.0f);
+        instance.model = glm::translate(instance.model, cubePositions[i]);
+        float angle = 20.0f * i;
+        instance.model = glm::rotate(instance.model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+        cubeInstances.push_back(instance);
+    }
+    // Normal matrices of all the instances in one batch
+    computeNormalMatrices(cubeInstances);
+    InstanceBuffer cubeInstanceBuffer((GLsizei)cubeInstances.size());
+    cubeInstanceBuffer.attach(cubeVAO);
+    cubeInstanceBuffer.upload(cubeInstances);
+
+    // Bounding spheres of the containers for frustum culling (unit cubes: the radius is half the diagonal)
+    BoundingSphereSoA cubeBounds;
+    cubeBounds.resize(cubeInstances.size());
+    for (unsigned int i = 0; i < 10; i++)
+        cubeBounds.set(i, cubePositions[i], 0.5f * std::sqrt(3.0f));
+    std::vector<uint32_t> visibleCubes;
+
+    // We draw as many light bulbs as we have point lights, only their model matrix is needed
+    std::vector<InstanceData> lightCubeInstances;
+    for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+    {
+        InstanceData instance;
+        instance.model = glm::mat4(1.0f);
+        instance.model = glm::translate(instance.model, pointLightPositions[i]);
+        instance.model = glm::scale(instance.model, glm::vec3(0.2f)); // Make it a smaller cube
+        instance.normalMatrix = glm::mat3(1.0f);
+        lightCubeInstances.push_back(instance);
+    }
+    InstanceBuffer lightCubeInstanceBuffer((GLsizei)lightCubeInstances.size());
+    lightCubeInstanceBuffer.attach(lightCubeVAO, false);
+    lightCubeInstanceBuffer.upload(lightCubeInstances);
+
+    // ----- MULTI-DRAW INDIRECT
+
+    // The cube geometry is suballocated in an arena, each visible cube becomes an indirect command 
+    // reading its matrices at its base instance (see IndirectRenderer)
+    std::unique_ptr<GeometryArena> cubeArena;
+    std::unique_ptr<IndirectRenderer> cubeRenderer;
+    std::unique_ptr<IndirectRenderer> lightCubeRenderer;
+    GeometryHandle cubeGeometry = INVALID_GEOMETRY;
+    if (INDIRECT_DRAWS)
+    {
+        std::function<void()> setCubeAttributes = []()
+        {
+            if (PACKED_VERTICES)
+            {
+                setPackedVertexAttributes(false);
+                return;
+            }
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+            glEnableVertexAttribArray(0);
+            glEnableVertexAttribArray(1);
+            glEnableVertexAttribArray(2);
+        };
+        GLsizei cubeStride = PACKED_VERTICES ? sizeof(PackedVertex) : 8 * sizeof(float);
+        cubeArena.reset(new GeometryArena(cubeStride, setCubeAttributes));
+
+        // The cube vertices are not shared between triangles: the indices just count them
+        std::vector<unsigned int> cubeIndices(36);
+        std::iota(cubeIndices.begin(), cubeIndices.end(), 0);
+        const void* cubeVertices = PACKED_VERTICES ? (const void*)packedVertices.data() : (const void*)vertices;
+        cubeGeometry = cubeArena->allocate(cubeVertices, 36, compactIndices(cubeIndices));
+
+        cubeRenderer.reset(new IndirectRenderer(*cubeArena, (GLsizei)cubeInstances.size()));
+        lightCubeRenderer.reset(new IndirectRenderer(*cubeArena, (GLsizei)lightCubeInstances.size()));
+        // The light cubes never move, their commands are written once
+        for (const InstanceData& instance : lightCubeInstances)
+            lightCubeRenderer->add(cubeGeometry, instance);
+    }
+
     // ----- TEXTURE
 
-    unsigned int diffuseMap = loadTexture(PATH_TEXTURE_DIFFUSE);
-    unsigned int specularMap = loadTexture(PATH_TEXTURE_SPECULAR);
-    unsigned int emissiveMap = loadTexture(PATH_TEXTURE_EMISSIVE);
+    // Streamed: the first frame does not wait for the images, they show up as they are uploaded
+    unsigned int diffuseMap, specularMap, emissiveMap;
+    if (COMPRESSED_TEXTURES)
+    {
+        diffuseMap = loadCompressedTexture(PATH_COMPRESSED_DIFFUSE, PATH_TEXTURE_DIFFUSE);
+        specularMap = loadCompressedTexture(PATH_COMPRESSED_SPECULAR, PATH_TEXTURE_SPECULAR);
+        emissiveMap = loadCompressedTexture(PATH_COMPRESSED_EMISSIVE, PATH_TEXTURE_EMISSIVE);
+    }
+    else if (STREAM_TEXTURES)
+    {
+        diffuseMap = textureCache->acquire(PATH_TEXTURE_DIFFUSE);
+        specularMap = textureCache->acquire(PATH_TEXTURE_SPECULAR);
+        emissiveMap = textureCache->acquire(PATH_TEXTURE_EMISSIVE);
+    }
+    else
+    {
+        diffuseMap = loadTexture(PATH_TEXTURE_DIFFUSE);
+        specularMap = loadTexture(PATH_TEXTURE_SPECULAR);
+        emissiveMap = loadTexture(PATH_TEXTURE_EMISSIVE);
+    }
+
+    // ----- LIGHTS
+
+    // All the lights live in one uniform buffer, shared by every program declaring the LightBlock.
+    // They are written once here; afterwards only the values that change (the spotlight following
+    // the camera) are re-uploaded, through the dirty range of the block.
+    LightBlock lightBlock;
+    UniformBuffer lightUBO(lightBlock.getBuffer().size(), LIGHT_BLOCK_BINDING);
 
-    // ----- SHADER PROGRAM
+    DirLight dirLight;
+    dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+    lightBlock.setDirLight(dirLight);
 
-    lightingShader.use();
-    // 0, 1 and 2 are the texture units assigned to material.diffuse and material.specular
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);    
+    for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+    {
+        PointLight pointLight;
+        pointLight.position = pointLightPositions[i];
+        pointLight.constant = 1.0f;
+        pointLight.linear = 0.09f;
+        pointLight.quadratic = 0.032f;
+        pointLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+        pointLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        pointLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        lightBlock.setPointLight(i, pointLight);
+    }
+
+    // Flashlight, its position and direction follow the camera
+    SpotLight spotLight;
+    // We pass a cosine and not an angle because in the frag shader we compute a dot prod which returns a cos
+    // It saves some performance to pass the cos instead of computing the inverse cosine in the shader
+    spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    spotLight.outerCutOff = glm::cos(glm::radians(17.5f));
+    spotLight.constant = 1.0f;
+    spotLight.linear = 0.09f;
+    spotLight.quadratic = 0.032f;
+    spotLight.ambient = glm::vec3(0.5f, 0.5f, 0.5f);
+    spotLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+    spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+
+    // ----- CAMERA CONSTANTS
+
+    // View and projection matrices, shared by every program through one uniform buffer.
+    // Uploaded when the camera changed, not every frame.
+    camera.SetPerspective((float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+    FrameBlock frameBlock;
+    UniformBuffer frameUBO(frameBlock.getBuffer().size(), FRAME_BLOCK_BINDING);
+    // The camera has not changed yet, but nothing was uploaded either
+    unsigned int uploadedCameraChange = camera.GetChangeCount() - 1;
+
+    // ----- UNIFORM HANDLES
+
+    // Resolved once here, so that the render loop never looks a uniform up by name.
+    // Handles can be taken before an async build is done, they are resolved when it completes.
+    UniformHandle shininessLoc = lightingShader.getUniformHandle("material.shininess");
+
+    // Program state set as soon as the async build of the lighting program is done, and after every reload
+    bool lightingShaderConfigured = false;
 
     // ----- RENDER LOOP
 
@@ -269,131 +574,130 @@ int main()
 
         processInput(window);
 
+        // ----- SHADER HOT RELOAD
+
+        // Edited programs are swapped here, never in the middle of the frame. A new program 
+        // comes without the state of the old one (sampler units, uniform block bindings).
+        if (lightingShader.reloadIfChanged())
+            lightingShaderConfigured = false;
+        if (lightCubeShader.reloadIfChanged())
+            lightCubeShader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+
+        // ----- TEXTURE STREAMING
+
+        // Decoded images uploaded within the frame budget
+        if (textureStreamer)
+            textureStreamer->update();
+
         // Clear the frame and depth buffers and apply new color to window
         // The depth buffer (z-buffer) contains the depth (z coord) of each fragment
         // The z-buffer should be cleared at each new render. Depths are considered only for the current frame.
+        if (sceneTarget)
+            sceneTarget->bind();
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // ----- SHADER PROGRAM WOODEN CONTAINER
-
-        lightingShader.use();
-
-        lightingShader.setVec3("light.position", camera.Position);
-        lightingShader.setVec3("light.direction", camera.Front);
-        // We pass a cosine and not an angle because in the frag shader we compute a dot prod which returns a cos
-        // It saves some performance to pass the cos instead of computing the inverse cosine in the shader
-        lightingShader.setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
-        lightingShader.setFloat("light.outerCutOff", glm::cos(glm::radians(17.5f)));
-        lightingShader.setVec3("viewPos", camera.Position);
-
-        // LIGHT properties
-        lightingShader.setVec3("light.ambient", 0.5f, 0.5f, 0.5f);
-        lightingShader.setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-
-        lightingShader.setFloat("light.constant", 1.0f);
-        lightingShader.setFloat("light.linear", 0.09f);
-        lightingShader.setFloat("light.quadratic", 0.032f);
-
-        // MATERIAL properties
-        lightingShader.setFloat("material.shininess", 64.0f);
-        /*
-        Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-        the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-        by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-        by using 'Uniform buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-        */
-        // directional light
-        lightingShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        lightingShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        lightingShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        lightingShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        lightingShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("pointLights[0].constant", 1.0f);
-        lightingShader.setFloat("pointLights[0].linear", 0.09);
-        lightingShader.setFloat("pointLights[0].quadratic", 0.032);
-        // point light 2
-        lightingShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        lightingShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("pointLights[1].constant", 1.0f);
-        lightingShader.setFloat("pointLights[1].linear", 0.09);
-        lightingShader.setFloat("pointLights[1].quadratic", 0.032);
-        // point light 3
-        lightingShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-        lightingShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("pointLights[2].constant", 1.0f);
-        lightingShader.setFloat("pointLights[2].linear", 0.09);
-        lightingShader.setFloat("pointLights[2].quadratic", 0.032);
-        // point light 4
-        lightingShader.setVec3("pointLights[3].position", pointLightPositions[3]);
-        lightingShader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("pointLights[3].constant", 1.0f);
-        lightingShader.setFloat("pointLights[3].linear", 0.09);
-        lightingShader.setFloat("pointLights[3].quadratic", 0.032);
-
         // ----- TRANSFORMS
 
-        // PROJECTION and VIEW matrices
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        // ----- BIND LIGHTING MAPS
-
-        // Bind diffuse map to texture unit 0
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        // Bind specular map to texture unit 1
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
+        // PROJECTION and VIEW matrices, rebuilt and uploaded only when the camera moved, turned or zoomed
+        if (camera.GetChangeCount() != uploadedCameraChange)
+        {
+            frameBlock.setCamera(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.GetViewProjectionMatrix(), camera.Position);
+            frameUBO.upload(frameBlock.getBuffer());
+            uploadedCameraChange = camera.GetChangeCount();
+        }
 
-        // ----- RENDER WOODEN CONTAINER
+        // ----- VISIBLE OBJECTS
 
-        // MODEL matrix (used in the draw call)
-        glm::mat4 model = glm::mat4(1.0f);
-        lightingShader.setMat4("model", model);
+        // Containers outside the view frustum get no command (the instanced path draws them all).
+        // Rebuilt every frame; objects in a row sharing a mesh merge into one instanced command.
+        if (INDIRECT_DRAWS)
+        {
+            cullSpheres(camera.GetFrustum(), cubeBounds, visibleCubes);
+            cubeRenderer->clear();
+            for (uint32_t i : visibleCubes)
+                cubeRenderer->add(cubeGeometry, cubeInstances[i]);
+        }
 
-        glBindVertexArray(cubeVAO);
+        // ----- SHADER PROGRAM WOODEN CONTAINER
 
-        for (unsigned int i = 0; i < 10; i++)
+        if (lightingShader.isReady())
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            lightingShader.setMat4("model", model);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            if (!lightingShaderConfigured)
+            {
+                // Cold start (compiled from source) vs warm start (loaded from the binary cache). The lighting
+                // program builds asynchronously: this is when it is ready, to one frame (tools/shader_cache_bench)
+                std::cout << "Shader setup: " << (glfwGetTime() - shaderSetupStart) * 1000.0 << " ms until the lighting program is ready ("
+                    << (lightingShader.isFromBinaryCache() + lightCubeShader.isFromBinaryCache()) << "/2 from binary cache)" << std::endl;
+                lightingShader.use();
+                // 0, 1 and 2 are the texture units assigned to material.diffuse and material.specular
+                lightingShader.setInt("material.diffuse", 0);
+                lightingShader.setInt("material.specular", 1);
+                lightingShader.bindUniformBlock("LightBlock", LIGHT_BLOCK_BINDING);
+                lightingShader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+                lightingShaderConfigured = true;
+            }
+
+            lightingShader.use();
+
+            // MATERIAL properties
+            lightingShader.setFloat(shininessLoc, 64.0f);
+
+            // LIGHTS: one buffer update at most, nothing at all when the camera did not move
+            spotLight.position = camera.Position;
+            spotLight.direction = camera.Front;
+            lightBlock.setSpotLight(spotLight);
+            lightUBO.upload(lightBlock.getBuffer());
+
+            // ----- BIND LIGHTING MAPS
+
+            // Bind diffuse map to texture unit 0
+            glState.bindTexture(0, GL_TEXTURE_2D, diffuseMap);
+            // Bind specular map to texture unit 1
+            glState.bindTexture(1, GL_TEXTURE_2D, specularMap);
+
+            // ----- RENDER WOODEN CONTAINER
+
+            // One draw call for all the containers
+            if (INDIRECT_DRAWS)
+                cubeRenderer->submit();
+            else
+            {
+                glState.bindVertexArray(cubeVAO);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, cubeInstanceBuffer.getCount());
+            }
+        }
+        else
+        {
+            // Lighting program still compiling: draw the containers flat with the light cube program
+            lightCubeShader.use();
+            if (INDIRECT_DRAWS)
+                cubeRenderer->submit();
+            else
+            {
+                glState.bindVertexArray(cubeVAO);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, cubeInstanceBuffer.getCount());
+            }
         }
 
         // ----- RENDER LIGHT CUBE
         
         lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
 
-        // we now draw as many light bulbs as we have point lights.
-        glBindVertexArray(lightCubeVAO);
-        for (unsigned int i = 0; i < 4; i++)
+        if (INDIRECT_DRAWS)
+            lightCubeRenderer->submit();
+        else
+        {
+            glState.bindVertexArray(lightCubeVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lightCubeInstanceBuffer.getCount());
+        }
+
+        if (sceneTarget)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-            lightCubeShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }   
+            int screenWidth, screenHeight;
+            glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
+            sceneTarget->blitToScreen(screenWidth, screenHeight);
+        }
 
         // Swap front (img displayed on screen) and back (img being rendered) buffers to render img without flickering effect
         glfwSwapBuffers(window);
@@ -402,10 +706,39 @@ int main()
         glfwPollEvents();
     }
 
+    std::cout << "GL state cache: " << glState.getIssuedCallCount() << " binds issued, " 
+        << glState.getSavedCallCount() << " redundant binds dropped" << std::endl;
+
     // De-allocate resources
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &lightCubeVAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &lightUBO.m_ID);
+    glDeleteBuffers(1, &frameUBO.m_ID);
+    if (sceneTarget)
+        sceneTarget->deleteBuffers();
+    if (textureStreamer)
+    {
+        TextureStreamStats streamStats = textureStreamer->getStats();
+        std::cout << "Texture streaming: " << streamStats.uploadedTextures << " textures (" << streamStats.uploadedBytes / 1024 << " KiB) over "
+            << streamStats.frames << " frames, stall p50 " << streamStats.p50StallMs << " ms, p99 " << streamStats.p99StallMs 
+            << " ms, max " << streamStats.maxStallMs << " ms" << std::endl;
+        TextureCacheStats cacheStats = textureCache->getStats();
+        std::cout << "Texture cache: " << cacheStats.residentTextures << " textures (" << cacheStats.residentBytes / 1024 << " KiB), "
+            << cacheStats.pathHits << " path hits, " << cacheStats.contentHits << " content hits, " << cacheStats.misses << " misses" << std::endl;
+        textureCache->clear();
+        textureStreamer->deleteBuffers();
+    }
+    glDeleteBuffers(1, &cubeInstanceBuffer.m_ID);
+    glDeleteBuffers(1, &lightCubeInstanceBuffer.m_ID);
+    if (INDIRECT_DRAWS)
+    {
+        std::cout << "Indirect draws: " << cubeRenderer->getObjectCount() << " containers in " << cubeRenderer->getCommandCount()
+            << " commands, " << cubeRenderer->getDrawCallCount() << " draw calls" << (GLExt::multiDrawIndirect ? "" : " (no multi-draw indirect)") << std::endl;
+        cubeRenderer->deleteBuffers();
+        lightCubeRenderer->deleteBuffers();
+        cubeArena->deleteBuffers();
+    }
 
     // glfwPollEvents() checks if any events are triggered (like keyboard input or mouse movement events), 
     // updates the window state, and calls the corresponding functions (which we can register via callback methods)
@@ -417,6 +750,13 @@ int main()
 
     // ----- FREE MEMORY
 
+    // The compile worker releases its context before its window goes away
+    compileWorker.reset();
+    if (compileWindow != NULL)
+        glfwDestroyWindow(compileWindow);
+    Shader::setFileWatcher(nullptr);
+    shaderWatcher.reset();
+
     // Delete all of GLFW's resources that were allocated
     glfwTerminate();
 
@@ -474,7 +814,7 @@ unsigned int loadTexture(char const* path)
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char* data = loadImageMapped(path, &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
@@ -485,7 +825,7 @@ unsigned int loadTexture(char const* path)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::get().bindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -502,5 +842,60 @@ unsigned int loadTexture(char const* path)
         stbi_image_free(data);
     }
 
+    return textureID;
+}
+
+// The blocks are uploaded as stored, mip chain included: no decode, no glGenerateMipmap
+unsigned int loadCompressedTexture(char const* path, char const* fallbackPath)
+{
+    CompressedImage image;
+    if (!loadCompressedImage(path, image))
+        return loadTexture(fallbackPath);
+
+    GLenum internalFormat = 0;
+    switch (image.format)
+    {
+    case Block_Format::BC1:
+        if (GLExt::textureCompressionS3TC)
+            internalFormat = image.sRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case Block_Format::BC3:
+        if (GLExt::textureCompressionS3TC)
+            internalFormat = image.sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        break;
+    case Block_Format::BC4:
+        internalFormat = GL_COMPRESSED_RED_RGTC1;
+        break;
+    case Block_Format::BC5:
+        internalFormat = GL_COMPRESSED_RG_RGTC2;
+        break;
+    case Block_Format::BC7:
+        if (GLExt::textureCompressionBPTC)
+            internalFormat = image.sRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        break;
+    }
+    if (internalFormat == 0)
+    {
+        std::cout << "ERROR::TEXTURE::UNSUPPORTED_FORMAT " << getBlockFormatName(image.format) << " " << path << std::endl;
+        return loadTexture(fallbackPath);
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::get().bindTexture(GL_TEXTURE_2D, textureID);
+    for (size_t level = 0; level < image.levels.size(); level++)
+    {
+        const CompressedLevel& compressed = image.levels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, compressed.width, compressed.height, 0, 
+            (GLsizei)compressed.size, image.data.data() + compressed.offset);
+    }
+    // A chain stopping before 1x1 is still complete
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
     return textureID;
 }
\ No newline at end of file
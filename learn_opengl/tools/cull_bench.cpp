@@ -0,0 +1,157 @@
+// Frustum culling benchmark: runs cullSpheres and cullBoxes over 1M random objects in SoA layout,
+// reports their throughput in objects/ns next to the one-object tests of Frustum, and checks that
+// every kernel keeps exactly the objects Frustum::intersectsSphere / intersectsBox keep. Headless, no OpenGL.
+//
+//   cull_bench [--count n]          1M objects by default, exits with 1 if a visible list differs
+//
+// The camera is main.cpp's (45 degrees, 16:9, near 0.1, far 100) at the center of a 400-unit cube
+// of objects, so under 1% of them are visible. The kernels compiled in follow the flags:
+// -mavx for 8 objects per iteration, SSE2 (x86-64 default) for 4.
+// Built from learn_opengl/ with the include paths of the app (glm, glad), e.g.
+//   g++ -std=c++17 -O2 -mavx tools/cull_bench.cpp src/Frustum.cpp -o cull_bench
+
+#include "../header/Camera.h"
+#include "../header/Frustum.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+
+// Runs "cull" for at least "minSeconds", in objects/ns
+static double timeCull(const std::function<void()>& cull, size_t count, double minSeconds)
+{
+    int runs = 0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        cull();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return (double)count * runs / (seconds * 1e9);
+}
+
+static const char* getKernelName()
+{
+#if defined(__AVX__)
+    return "AVX, 8 objects per iteration";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2, 4 objects per iteration";
+#else
+    return "scalar";
+#endif
+}
+
+// Number of positions where the two lists differ (different lengths count the missing entries)
+static size_t countDifferences(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+    size_t common = a.size() < b.size() ? a.size() : b.size();
+    size_t differences = a.size() > b.size() ? a.size() - b.size() : b.size() - a.size();
+    for (size_t i = 0; i < common; i++)
+    {
+        if (a[i] != b[i])
+            differences++;
+    }
+    return differences;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 1000000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            count = (size_t)std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
+    camera.SetPerspective(1920.0f / 1080.0f, 0.1f, 100.0f);
+    Frustum frustum = camera.GetFrustum();
+
+    // Fixed seed: the same scene on every run
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    BoundingSphereSoA spheres;
+    BoundingBoxSoA boxes;
+    spheres.resize(count);
+    boxes.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        spheres.set(i, center, size(random));
+        glm::vec3 extent(size(random), size(random), size(random));
+        boxes.set(i, center - extent, center + extent);
+    }
+
+    std::cout << count << " objects, " << getKernelName() << std::endl;
+    std::cout << std::left << std::setw(10) << "volume" << std::right << std::setw(12) << "visible"
+        << std::setw(16) << "kernel obj/ns" << std::setw(16) << "scalar obj/ns" << std::setw(10) << "speedup" << std::endl;
+
+    int failures = 0;
+
+    // Spheres
+    {
+        std::vector<uint32_t> visible;
+        std::vector<uint32_t> reference;
+        reference.reserve(count);
+        double kernel = timeCull([&]() { cullSpheres(frustum, spheres, visible); }, count, MIN_SECONDS);
+        double scalar = timeCull([&]()
+        {
+            reference.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                if (frustum.intersectsSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]))
+                    reference.push_back((uint32_t)i);
+            }
+        }, count, MIN_SECONDS);
+
+        std::cout << std::left << std::setw(10) << "spheres" << std::right << std::setw(12) << visible.size() << std::fixed << std::setprecision(3)
+            << std::setw(16) << kernel << std::setw(16) << scalar << std::setw(9) << std::setprecision(1) << kernel / scalar << "x" << std::endl;
+        size_t differences = countDifferences(visible, reference);
+        if (differences != 0)
+        {
+            std::cout << "ERROR::CULL_BENCH::SPHERES_DIFFER " << differences << " of " << reference.size() << std::endl;
+            failures++;
+        }
+    }
+
+    // Boxes
+    {
+        std::vector<uint32_t> visible;
+        std::vector<uint32_t> reference;
+        reference.reserve(count);
+        double kernel = timeCull([&]() { cullBoxes(frustum, boxes, visible); }, count, MIN_SECONDS);
+        double scalar = timeCull([&]()
+        {
+            reference.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                glm::vec3 min(boxes.minX[i], boxes.minY[i], boxes.minZ[i]);
+                glm::vec3 max(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+                if (frustum.intersectsBox(min, max))
+                    reference.push_back((uint32_t)i);
+            }
+        }, count, MIN_SECONDS);
+
+        std::cout << std::left << std::setw(10) << "boxes" << std::right << std::setw(12) << visible.size() << std::fixed << std::setprecision(3)
+            << std::setw(16) << kernel << std::setw(16) << scalar << std::setw(9) << std::setprecision(1) << kernel / scalar << "x" << std::endl;
+        size_t differences = countDifferences(visible, reference);
+        if (differences != 0)
+        {
+            std::cout << "ERROR::CULL_BENCH::BOXES_DIFFER " << differences << " of " << reference.size() << std::endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+// Depth precision check of the camera projections: runs the cached projection of Camera on the CPU
+// for both Depth_Mode values at distances from the near plane to 1e5, and prints what the depth
+// buffer stores there and the smallest distance step it can still tell apart. Headless, no OpenGL.
+//
+//   depth_precision          exits with 1 if a check fails
+//
+// The buffers are the ones main.cpp uses: 24-bit fixed-point depth (the window's) for STANDARD,
+// 32-bit float depth in a [0, 1] clip range (the RenderTarget's) for REVERSE_Z_INFINITE.
+// Checks, REVERSE_Z_INFINITE:
+// - nothing is clipped from the near plane to 1e5 (depth in (0, 1], inside every frustum plane)
+// - the stored depth keeps decreasing with the distance
+// - the resolvable step stays under 2^-22 of the distance, and two surfaces 1e-5 of the distance
+//   apart (transformed in float, like the vertex shader does) get different depths
+// STANDARD is checked to clip past its far plane, as it should.
+// Built from learn_opengl/ with the include paths of the app (glm, glad), e.g.
+//   g++ -std=c++17 -O2 tools/depth_precision.cpp src/Frustum.cpp -o depth_precision
+
+#include "../header/Camera.h"
+#include "../header/Frustum.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+const float ASPECT = 1920.0f / 1080.0f;
+const double MAX_DISTANCE = 1e5;
+// Float mantissa: 23 bits, the mapping costs at most one more
+const double MAX_RELATIVE_STEP = 1.0 / (1 << 22);
+const double SURFACE_GAP = 1e-5;
+
+// What the depth buffer stores for a view-space point (0, 0, -distance), from the float matrix
+static double storedDepth(const glm::mat4& viewProjection, Depth_Mode mode, float distance, bool& clipped)
+{
+    glm::vec4 clip = viewProjection * glm::vec4(0.0f, 0.0f, -distance, 1.0f);
+    float ndc = clip.z / clip.w;
+    if (mode == Depth_Mode::REVERSE_Z_INFINITE)
+    {
+        // [0, 1] clip depth, written to a 32-bit float buffer as is
+        clipped = clip.z < 0.0f || clip.z > clip.w;
+        return ndc;
+    }
+    // [-1, 1] clip depth, mapped to [0, 1] and rounded to 24 bits
+    clipped = clip.z < -clip.w || clip.z > clip.w;
+    const double maxValue = (double)((1 << 24) - 1);
+    return std::nearbyint((ndc * 0.5 + 0.5) * maxValue) / maxValue;
+}
+
+// Smallest distance change the buffer can tell apart around "distance": one stored step divided by
+// the slope of the mapping. The slope is taken from the matrix in double, the step is the buffer's.
+static double resolvableStep(const glm::mat4& viewProjection, Depth_Mode mode, double distance)
+{
+    // Depth row of the matrix: ndc(d) = (a * -d + b) / (c * -d + e)
+    double a = viewProjection[2][2], b = viewProjection[3][2], c = viewProjection[2][3], e = viewProjection[3][3];
+    double h = distance * 1e-6;
+    double ndcBefore = (a * -(distance - h) + b) / (c * -(distance - h) + e);
+    double ndcAfter = (a * -(distance + h) + b) / (c * -(distance + h) + e);
+    double slope = std::fabs(ndcAfter - ndcBefore) / (2.0 * h);
+
+    if (mode == Depth_Mode::REVERSE_Z_INFINITE)
+    {
+        // Farther is smaller: the next float down
+        float depth = (float)((a * -distance + b) / (c * -distance + e));
+        double ulp = (double)depth - (double)std::nextafter(depth, 0.0f);
+        return ulp / slope;
+    }
+    // One 24-bit step in window depth is two in NDC
+    return 2.0 / (double)((1 << 24) - 1) / slope;
+}
+
+static const char* getDepthModeName(Depth_Mode mode)
+{
+    return mode == Depth_Mode::REVERSE_Z_INFINITE ? "REVERSE_Z_INFINITE" : "STANDARD";
+}
+
+int main()
+{
+    // Near plane, then 1, 2, 5 per decade up to 1e5
+    std::vector<float> distances;
+    distances.push_back(NEAR_PLANE);
+    for (double decade = 0.1; decade < MAX_DISTANCE; decade *= 10.0)
+    {
+        for (double factor : { 2.0, 5.0, 10.0 })
+            distances.push_back((float)(decade * factor));
+    }
+
+    int failures = 0;
+    const Depth_Mode modes[] = { Depth_Mode::STANDARD, Depth_Mode::REVERSE_Z_INFINITE };
+    for (Depth_Mode mode : modes)
+    {
+        // Default orientation: looking down -Z from the origin
+        Camera camera;
+        camera.SetPerspective(ASPECT, NEAR_PLANE, FAR_PLANE);
+        camera.SetDepthMode(mode);
+        const glm::mat4& viewProjection = camera.GetViewProjectionMatrix();
+        Frustum frustum = camera.GetFrustum();
+        bool reverseZ = mode == Depth_Mode::REVERSE_Z_INFINITE;
+
+        std::cout << getDepthModeName(mode) << std::endl;
+        std::cout << std::setw(10) << "distance" << std::setw(16) << "stored depth" << std::setw(14) << "step"
+            << std::setw(14) << "step/dist" << std::endl;
+
+        double previousDepth = 0.0;
+        for (size_t i = 0; i < distances.size(); i++)
+        {
+            float distance = distances[i];
+            bool clipped;
+            double depth = storedDepth(viewProjection, mode, distance, clipped);
+            double step = resolvableStep(viewProjection, mode, distance);
+            bool gapClipped;
+            double gapDepth = storedDepth(viewProjection, mode, distance * (float)(1.0 + SURFACE_GAP), gapClipped);
+
+            std::cout << std::setw(10) << std::defaultfloat << distance << std::setw(16) << std::setprecision(9) << depth
+                << std::setw(14) << std::setprecision(3) << std::scientific << step << std::setw(14) << step / distance
+                << std::defaultfloat << std::setprecision(6) << (clipped ? "  clipped" : "") << std::endl;
+
+            if (reverseZ)
+            {
+                // The near plane itself is inside, on the boundary
+                bool inside = frustum.intersectsSphere(glm::vec3(0.0f, 0.0f, -distance), 0.0f);
+                if (clipped || depth <= 0.0 || depth > 1.0 || !inside)
+                {
+                    std::cout << "ERROR::DEPTH_PRECISION::CLIPPED at " << distance << std::endl;
+                    failures++;
+                }
+                if (i > 0 && depth >= previousDepth)
+                {
+                    std::cout << "ERROR::DEPTH_PRECISION::NOT_DECREASING at " << distance << std::endl;
+                    failures++;
+                }
+                if (step / distance > MAX_RELATIVE_STEP)
+                {
+                    std::cout << "ERROR::DEPTH_PRECISION::STEP_TOO_LARGE at " << distance << std::endl;
+                    failures++;
+                }
+                if (gapDepth == depth)
+                {
+                    std::cout << "ERROR::DEPTH_PRECISION::SURFACES_MERGED at " << distance << std::endl;
+                    failures++;
+                }
+            }
+            else if (clipped != (distance > FAR_PLANE))
+            {
+                std::cout << "ERROR::DEPTH_PRECISION::FAR_PLANE at " << distance << std::endl;
+                failures++;
+            }
+            previousDepth = depth;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << (failures == 0 ? "All depth checks passed" : "Depth checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
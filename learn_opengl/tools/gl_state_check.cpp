@@ -0,0 +1,146 @@
+// GL state cache check: GLState runs on a recording backend instead of the driver, and the calls
+// that reach it are compared with the ones expected. Headless, no OpenGL context.
+//
+//   gl_state_check           exits with 1 if a check fails
+//
+// - Two frames of main.cpp's binds (two programs, two texture units, one vertex array): the first
+//   frame issues what the cold cache does not know, the second only the program switches.
+// - The rules of the shadow: the element array buffer follows the vertex array, bindBufferBase sets
+//   the generic binding, forgotten and invalidated bindings are issued again.
+// Built from learn_opengl/ with the include paths of the app (glad), e.g.
+//   g++ -std=c++17 -O2 tools/gl_state_check.cpp src/GLState.cpp src/glad.c -o gl_state_check
+// (glad only provides the symbols of the default backend, never called here)
+
+#include "../header/GLState.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Every call the cache let through, in order
+static std::vector<std::string> calls;
+
+static GLStateBackend recordingBackend()
+{
+    GLStateBackend backend;
+    backend.useProgram = [](GLuint program) { calls.push_back("useProgram " + std::to_string(program)); };
+    backend.bindVertexArray = [](GLuint vertexArray) { calls.push_back("bindVertexArray " + std::to_string(vertexArray)); };
+    backend.bindBuffer = [](GLenum target, GLuint buffer) { calls.push_back("bindBuffer " + std::to_string(target) + " " + std::to_string(buffer)); };
+    backend.bindBufferBase = [](GLenum target, GLuint index, GLuint buffer)
+    {
+        calls.push_back("bindBufferBase " + std::to_string(target) + " " + std::to_string(index) + " " + std::to_string(buffer));
+    };
+    backend.activeTexture = [](GLenum unit) { calls.push_back("activeTexture " + std::to_string(unit - GL_TEXTURE0)); };
+    backend.bindTexture = [](GLenum target, GLuint texture) { calls.push_back("bindTexture " + std::to_string(target) + " " + std::to_string(texture)); };
+    return backend;
+}
+
+static int failures = 0;
+
+static void checkCalls(const std::vector<std::string>& expected, const char* what)
+{
+    if (calls == expected)
+    {
+        calls.clear();
+        return;
+    }
+    std::cout << "ERROR::GL_STATE_CHECK::" << what << std::endl << "  issued:";
+    for (const std::string& call : calls)
+        std::cout << " [" << call << "]";
+    std::cout << std::endl << "  expected:";
+    for (const std::string& call : expected)
+        std::cout << " [" << call << "]";
+    std::cout << std::endl;
+    failures++;
+    calls.clear();
+}
+
+static void checkCount(unsigned int count, unsigned int expected, const char* what)
+{
+    if (count == expected)
+        return;
+    std::cout << "ERROR::GL_STATE_CHECK::" << what << " " << count << " != " << expected << std::endl;
+    failures++;
+}
+
+// The binds of one frame of main.cpp: containers then light cubes, both drawn from one vertex array
+static void drawFrame(GLState& state)
+{
+    const GLuint lightingProgram = 1, lightCubeProgram = 2;
+    const GLuint diffuseMap = 10, specularMap = 11;
+    const GLuint cubeVertexArray = 5;
+
+    state.useProgram(lightingProgram);
+    state.bindTexture(0, GL_TEXTURE_2D, diffuseMap);
+    state.bindTexture(1, GL_TEXTURE_2D, specularMap);
+    state.bindVertexArray(cubeVertexArray);
+
+    state.useProgram(lightCubeProgram);
+    state.bindVertexArray(cubeVertexArray);
+}
+
+static void checkFrames()
+{
+    GLState state(recordingBackend());
+    const std::string texture2D = std::to_string(GL_TEXTURE_2D);
+
+    // Cold cache: everything but the second vertex array bind
+    drawFrame(state);
+    checkCalls({ "useProgram 1", "activeTexture 0", "bindTexture " + texture2D + " 10", "activeTexture 1", "bindTexture " + texture2D + " 11",
+        "bindVertexArray 5", "useProgram 2" }, "FIRST_FRAME");
+    // Steady state: the program switches only
+    drawFrame(state);
+    checkCalls({ "useProgram 1", "useProgram 2" }, "SECOND_FRAME");
+
+    checkCount(state.getIssuedCallCount(), 9, "ISSUED_COUNT");
+    checkCount(state.getSavedCallCount(), 5, "SAVED_COUNT");
+    std::cout << "Two frames: " << state.getIssuedCallCount() << " calls issued, " << state.getSavedCallCount() << " dropped" << std::endl;
+}
+
+static void checkRules()
+{
+    GLState state(recordingBackend());
+    const std::string elementArray = std::to_string(GL_ELEMENT_ARRAY_BUFFER);
+    const std::string uniform = std::to_string(GL_UNIFORM_BUFFER);
+    const std::string texture2D = std::to_string(GL_TEXTURE_2D);
+
+    // The element array buffer is unknown once another vertex array is bound
+    state.bindVertexArray(5);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+    state.bindVertexArray(6);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+    checkCalls({ "bindVertexArray 5", "bindBuffer " + elementArray + " 7", "bindVertexArray 6", "bindBuffer " + elementArray + " 7" }, "ELEMENT_ARRAY_BUFFER");
+
+    // bindBufferBase also binds the generic target
+    state.bindBufferBase(GL_UNIFORM_BUFFER, 0, 8);
+    state.bindBuffer(GL_UNIFORM_BUFFER, 8);
+    checkCalls({ "bindBufferBase " + uniform + " 0 8" }, "BIND_BUFFER_BASE");
+
+    // A deleted texture is unbound by OpenGL: binding the name again is issued
+    state.bindTexture(0, GL_TEXTURE_2D, 10);
+    state.forgetTexture(10);
+    state.bindTexture(0, GL_TEXTURE_2D, 10);
+    checkCalls({ "activeTexture 0", "bindTexture " + texture2D + " 10", "bindTexture " + texture2D + " 10" }, "FORGET_TEXTURE");
+
+    // After calls behind the cache's back nothing is assumed
+    state.useProgram(1);
+    state.invalidate();
+    state.useProgram(1);
+    checkCalls({ "useProgram 1", "useProgram 1" }, "INVALIDATE");
+
+    // Targets that are not shadowed are always forwarded
+    state.bindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 9);
+    state.bindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 9);
+    checkCount((unsigned int)calls.size(), 2, "UNSHADOWED_TARGET");
+    calls.clear();
+}
+
+int main()
+{
+    checkFrames();
+    checkRules();
+
+    std::cout << (failures == 0 ? "All GL state checks passed" : "GL state checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
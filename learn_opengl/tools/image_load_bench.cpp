@@ -0,0 +1,209 @@
+// Image loading benchmark: decodes every JPG/PNG of a folder through each way of reading the file,
+// with the files in the page cache (warm) and, on POSIX, dropped from it before each pass (cold).
+//
+//   image_load_bench [folder] [--runs n]      folder defaults to ../textures, 5 runs per mode
+//
+//   stdio       stbi_load, the file read through a FILE* buffer
+//   ifstream    the whole file read into a vector, then stbi_load_from_memory
+//   mmap        stbi_load_from_memory on a mapping of the file (loadImageMapped)
+//   mmap batch  every file mapped and prefetched first (mapFiles), then decoded in turn
+//
+// Cold passes use posix_fadvise(DONTNEED), which only drops clean pages: not a guaranteed cold disk,
+// but the read path of each mode shows. Built from learn_opengl/ e.g.
+//   g++ -std=c++17 -O2 tools/image_load_bench.cpp src/MappedFile.cpp src/stb_image.cpp -o image_load_bench
+
+#include "../header/MappedFile.h"
+#include "../header/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Checksum of the decoded pixels, so that every mode is checked against the others
+typedef std::function<size_t(const std::vector<std::string>& paths)> LoadAll;
+
+static size_t sumPixels(unsigned char* pixels, int width, int height, int components)
+{
+    if (pixels == nullptr)
+        return 0;
+    size_t sum = 0;
+    size_t count = (size_t)width * height * components;
+    for (size_t i = 0; i < count; i += 61)
+        sum += pixels[i];
+    stbi_image_free(pixels);
+    return sum + count;
+}
+
+static size_t loadStdio(const std::vector<std::string>& paths)
+{
+    size_t sum = 0;
+    for (const std::string& path : paths)
+    {
+        int width, height, components;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+        sum += sumPixels(pixels, width, height, components);
+    }
+    return sum;
+}
+
+static size_t loadIfstream(const std::vector<std::string>& paths)
+{
+    size_t sum = 0;
+    for (const std::string& path : paths)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        int width, height, components;
+        unsigned char* pixels = bytes.empty() || bytes.size() > (size_t)INT_MAX ? nullptr
+            : stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &components, 0);
+        sum += sumPixels(pixels, width, height, components);
+    }
+    return sum;
+}
+
+static size_t loadMapped(const std::vector<std::string>& paths)
+{
+    size_t sum = 0;
+    for (const std::string& path : paths)
+    {
+        int width, height, components;
+        unsigned char* pixels = loadImageMapped(path, &width, &height, &components, 0);
+        sum += sumPixels(pixels, width, height, components);
+    }
+    return sum;
+}
+
+static size_t loadMappedBatch(const std::vector<std::string>& paths)
+{
+    size_t sum = 0;
+    std::vector<MappedFile> files = mapFiles(paths);
+    for (MappedFile& file : files)
+    {
+        int width, height, components;
+        unsigned char* pixels = file.data() == nullptr || file.size() > (size_t)INT_MAX ? nullptr
+            : stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &components, 0);
+        sum += sumPixels(pixels, width, height, components);
+        // Unmapped as soon as decoded, as the streamer does
+        file.close();
+    }
+    return sum;
+}
+
+// Asks the kernel to drop the cached pages of the files. False where it cannot be done.
+static bool dropFromPageCache(const std::vector<std::string>& paths)
+{
+#ifdef _WIN32
+    (void)paths;
+    return false;
+#else
+    for (const std::string& path : paths)
+    {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            continue;
+        fdatasync(file);
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+    return true;
+#endif
+}
+
+// Best of the runs, in ms
+static double timeLoad(const LoadAll& load, const std::vector<std::string>& paths, int runs, bool cold, size_t& checksum)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        if (cold)
+            dropFromPageCache(paths);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        checksum = load(paths);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    std::string folder = "../textures";
+    int runs = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else
+            folder = argv[i];
+    }
+
+    std::vector<std::string> paths;
+    size_t totalBytes = 0;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder, error))
+    {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg"))
+        {
+            paths.push_back(entry.path().string());
+            totalBytes += (size_t)entry.file_size();
+        }
+    }
+    if (paths.empty())
+    {
+        std::cout << "ERROR::IMAGE_LOAD_BENCH::NO_IMAGES " << folder << std::endl;
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+    std::cout << paths.size() << " images, " << std::fixed << std::setprecision(2) << totalBytes / (1024.0 * 1024.0)
+        << " MiB encoded, best of " << runs << " runs" << std::endl;
+
+    struct Mode
+    {
+        const char* name;
+        LoadAll load;
+    };
+    const Mode modes[] = {
+        { "stdio", loadStdio },
+        { "ifstream", loadIfstream },
+        { "mmap", loadMapped },
+        { "mmap batch", loadMappedBatch },
+    };
+    bool coldPossible = dropFromPageCache(paths);
+
+    std::cout << std::left << std::setw(12) << "mode" << std::right << std::setw(12) << "warm ms";
+    if (coldPossible)
+        std::cout << std::setw(12) << "cold ms";
+    std::cout << std::endl;
+
+    size_t reference = 0;
+    for (const Mode& mode : modes)
+    {
+        size_t checksum = 0;
+        double warm = timeLoad(mode.load, paths, runs, false, checksum);
+        if (reference == 0)
+            reference = checksum;
+        std::cout << std::left << std::setw(12) << mode.name << std::right << std::setw(12) << warm;
+        if (coldPossible)
+            std::cout << std::setw(12) << timeLoad(mode.load, paths, runs, true, checksum);
+        if (checksum != reference)
+            std::cout << "  ERROR::IMAGE_LOAD_BENCH::PIXELS_DIFFER";
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,371 @@
+// Indirect draw benchmark: draws N objects of a geometry arena both ways main.cpp has drawn its
+// containers, for N from 10 to 1M, and reports the CPU cost of submitting a frame and its draw calls.
+// Needs an OpenGL 3.3 context: opens a hidden window and renders into a 256x256 framebuffer of its own.
+//
+//   indirect_bench [--max n] [--sorted]          N up to 1M by default, exits with 1 if the two images differ
+//
+//   per object   one glUniformMatrix4fv (model) + glUniformMatrix3fv (normal matrix) + glDrawElementsBaseVertex
+//                per object (what Shader::setMat4/setMat3 with handles and GeometryArena::draw issue)
+//   indirect     IndirectRenderer: clear, add every object, submit (one glMultiDrawElementsIndirect per
+//                index type, or a loop of instanced draws per command without multi-draw indirect)
+//
+// "submit" is the CPU time of a frame (the adds and uploads of the indirect path included), "frame" adds
+// glFinish. "build" is the part of the indirect submit spent in IndirectRenderer::clear and add.
+// A software renderer transforms the vertices in the draw calls themselves: there, the rest of the
+// submit grows with N whatever the number of calls. The objects cycle through MESH_COUNT meshes, so no
+// two neighbours share one: every object is a command of its own, the worst case for the indirect
+// path. With --sorted, the objects of a mesh follow each other and merge into one instanced command.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/indirect_bench.cpp src/IndirectRenderer.cpp src/GeometryArena.cpp src/InstanceBuffer.cpp
+//       src/CompactIndices.cpp src/NormalMatrix.cpp src/GLExtensions.cpp src/GLState.cpp src/glad.c -lglfw -o indirect_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../header/GLExtensions.h"
+#include "../header/GLState.h"
+#include "../header/GeometryArena.h"
+#include "../header/IndirectRenderer.h"
+#include "../header/NormalMatrix.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+const int TARGET_SIZE = 256;
+const int MESH_COUNT = 8;
+
+// Both programs write the world-space normal, so their images can be compared
+const char* PER_OBJECT_VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+out vec3 Normal;
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+    Normal = normalMatrix * aNormal;
+}
+)";
+
+const char* INDIRECT_VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 5) in mat4 aModel;
+layout (location = 9) in mat3 aNormalMatrix;
+out vec3 Normal;
+void main()
+{
+    gl_Position = aModel * vec4(aPos, 1.0);
+    Normal = aNormalMatrix * aNormal;
+}
+)";
+
+const char* FRAGMENT_SOURCE = R"(#version 330 core
+in vec3 Normal;
+out vec4 FragColor;
+void main()
+{
+    FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
+)";
+
+static GLuint compileStage(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::INDIRECT_BENCH::COMPILE " << infoLog << std::endl;
+    }
+    return shader;
+}
+
+static GLuint buildProgram(const char* vertexSource)
+{
+    GLuint vertex = compileStage(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compileStage(GL_FRAGMENT_SHADER, FRAGMENT_SOURCE);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return program;
+}
+
+// 24 vertices (position and normal) and 36 indices of a unit cube
+static void buildCube(std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (float side : { -0.5f, 0.5f })
+        {
+            // Two other axes of the face, ordered so that the triangles face outwards
+            int u = (axis + (side > 0.0f ? 1 : 2)) % 3;
+            int v = (axis + (side > 0.0f ? 2 : 1)) % 3;
+            const float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+            unsigned int first = (unsigned int)(vertices.size() / 6);
+            for (const float* corner : corners)
+            {
+                float vertex[6] = {};
+                vertex[axis] = side;
+                vertex[u] = corner[0];
+                vertex[v] = corner[1];
+                vertex[3 + axis] = side > 0.0f ? 1.0f : -1.0f;
+                vertices.insert(vertices.end(), vertex, vertex + 6);
+            }
+            const unsigned int quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Mesh of object "i" of "count"
+static int getMeshIndex(size_t i, size_t count, bool sorted)
+{
+    return sorted ? (int)(i * MESH_COUNT / count) : (int)(i % MESH_COUNT);
+}
+
+// N objects on a square grid covering clip space, each turned like the containers of main.cpp
+static std::vector<InstanceData> buildInstances(size_t count)
+{
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    float cell = 2.0f / side;
+    std::vector<InstanceData> instances(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(-1.0f + cell * (i % side + 0.5f), -1.0f + cell * (i / side + 0.5f), 0.0f);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+        model = glm::rotate(model, glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+        instances[i].model = glm::scale(model, glm::vec3(cell * 0.5f));
+    }
+    computeNormalMatrices(instances);
+    return instances;
+}
+
+struct FrameTimes
+{
+    double submitMs;
+    double frameMs;
+};
+
+// Runs "draw" for at least "minSeconds" (one frame at least), mean times of a frame
+static FrameTimes timeFrames(const std::function<void()>& draw, double minSeconds)
+{
+    int runs = 0;
+    double submitSeconds = 0.0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        draw();
+        submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        glFinish();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return { submitSeconds * 1000.0 / runs, seconds * 1000.0 / runs };
+}
+
+static std::vector<unsigned char> readPixels()
+{
+    std::vector<unsigned char> pixels((size_t)TARGET_SIZE * TARGET_SIZE * 4);
+    glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// Pixels with a channel more than 1 apart (the two paths may round the normal differently)
+static size_t countDifferentPixels(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    size_t different = 0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (size_t channel = 0; channel < 4; channel++)
+        {
+            if (std::abs((int)a[i + channel] - (int)b[i + channel]) > 1)
+            {
+                different++;
+                break;
+            }
+        }
+    }
+    return different;
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxCount = 1000000;
+    bool sorted = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+            maxCount = (size_t)std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--sorted") == 0)
+            sorted = true;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::INDIRECT_BENCH::NO_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::INDIRECT_BENCH::GLAD" << std::endl;
+        return 1;
+    }
+    GLExt::load((GLADloadproc)glfwGetProcAddress);
+
+    // Render target
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_SIZE, TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::INDIRECT_BENCH::FRAMEBUFFER" << std::endl;
+        return 1;
+    }
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    GLState& state = GLState::get();
+    GLuint perObjectProgram = buildProgram(PER_OBJECT_VERTEX_SOURCE);
+    GLuint indirectProgram = buildProgram(INDIRECT_VERTEX_SOURCE);
+    GLint modelLocation = glGetUniformLocation(perObjectProgram, "model");
+    GLint normalMatrixLocation = glGetUniformLocation(perObjectProgram, "normalMatrix");
+
+    // The same cube allocated MESH_COUNT times: as many meshes for the draws to switch between
+    std::vector<float> cubeVertices;
+    std::vector<unsigned int> cubeIndices;
+    buildCube(cubeVertices, cubeIndices);
+    GeometryArena arena(6 * sizeof(float), []()
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    });
+    GeometryHandle meshes[MESH_COUNT];
+    for (GeometryHandle& mesh : meshes)
+        mesh = arena.allocate(cubeVertices.data(), cubeVertices.size() / 6, compactIndices(cubeIndices));
+    IndirectRenderer renderer(arena);
+
+    std::cout << "Frame of N objects (" << MESH_COUNT << " meshes, " << (sorted ? "sorted" : "alternating") << ") into " << TARGET_SIZE << "x" << TARGET_SIZE << ", "
+        << glGetString(GL_RENDERER) << (GLExt::multiDrawIndirect ? "" : ", no multi-draw indirect") << std::endl;
+    std::cout << std::setw(9) << "" << std::setw(34) << "per object" << std::setw(56) << "indirect" << std::endl;
+    std::cout << std::setw(9) << "N" << std::setw(12) << "submit ms" << std::setw(12) << "frame ms" << std::setw(10) << "draws"
+        << std::setw(12) << "build ms" << std::setw(12) << "submit ms" << std::setw(12) << "frame ms" << std::setw(10) << "commands"
+        << std::setw(10) << "draws" << std::endl;
+
+    // The cleared target: opaque black
+    std::vector<unsigned char> background((size_t)TARGET_SIZE * TARGET_SIZE * 4, 0);
+    for (size_t i = 3; i < background.size(); i += 4)
+        background[i] = 255;
+
+    int failures = 0;
+    for (size_t count = 10; count <= maxCount; count *= 10)
+    {
+        std::vector<InstanceData> instances = buildInstances(count);
+
+        size_t perObjectDraws = 0;
+        FrameTimes perObject = timeFrames([&]()
+        {
+            state.useProgram(perObjectProgram);
+            arena.bind();
+            perObjectDraws = 0;
+            for (size_t i = 0; i < instances.size(); i++)
+            {
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &instances[i].model[0][0]);
+                glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &instances[i].normalMatrix[0][0]);
+                arena.draw(meshes[getMeshIndex(i, count, sorted)]);
+                perObjectDraws++;
+            }
+        }, MIN_SECONDS);
+        std::vector<unsigned char> perObjectImage = readPixels();
+
+        double buildSeconds = 0.0;
+        int frames = 0;
+        FrameTimes indirect = timeFrames([&]()
+        {
+            std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+            renderer.clear();
+            for (size_t i = 0; i < instances.size(); i++)
+                renderer.add(meshes[getMeshIndex(i, count, sorted)], instances[i]);
+            buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+            frames++;
+            state.useProgram(indirectProgram);
+            renderer.submit();
+        }, MIN_SECONDS);
+        std::vector<unsigned char> indirectImage = readPixels();
+
+        std::cout << std::setw(9) << count << std::fixed << std::setprecision(3) << std::setw(12) << perObject.submitMs << std::setw(12)
+            << perObject.frameMs << std::setw(10) << perObjectDraws << std::setw(12) << buildSeconds * 1000.0 / frames << std::setw(12)
+            << indirect.submitMs << std::setw(12) << indirect.frameMs << std::setw(10) << renderer.getCommandCount() << std::setw(10)
+            << renderer.getDrawCallCount() << std::endl;
+
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            std::cout << "ERROR::INDIRECT_BENCH::GL_ERROR " << error << " at N = " << count << std::endl;
+            failures++;
+        }
+        // Something was drawn at all: the cubes cover part of the black background
+        size_t covered = countDifferentPixels(background, indirectImage);
+        if (covered == 0)
+        {
+            std::cout << "ERROR::INDIRECT_BENCH::EMPTY_IMAGE at N = " << count << std::endl;
+            failures++;
+        }
+        size_t different = countDifferentPixels(perObjectImage, indirectImage);
+        if (different != 0)
+        {
+            std::cout << "ERROR::INDIRECT_BENCH::IMAGES_DIFFER " << different << " pixels at N = " << count << std::endl;
+            failures++;
+        }
+    }
+
+    renderer.deleteBuffers();
+    arena.deleteBuffers();
+    glDeleteProgram(perObjectProgram);
+    glDeleteProgram(indirectProgram);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,344 @@
+// Instancing benchmark: draws N cubes both ways main.cpp has drawn its containers, for N from 10 to
+// 1M, and reports the cost of a frame. Needs an OpenGL 3.3 context: opens a hidden window and
+// renders into a 256x256 framebuffer of its own.
+//
+//   instancing_bench [--max n]          N up to 1M by default, exits with 1 if the two images differ
+//
+//   per draw     one glUniformMatrix4fv (model) + glUniformMatrix3fv (normal matrix) + glDrawArrays per cube
+//   instanced    the matrices uploaded to an InstanceBuffer, then one glDrawArraysInstanced
+//
+// "submit" is the CPU time of the calls, "frame" adds glFinish: what the GPU took to catch up.
+// The instanced frame includes the upload of every matrix (main.cpp uploads them once), so it is
+// the cost of a scene whose objects all move. The cubes sit on a grid filling the framebuffer, small
+// enough that the vertex work and the draw calls dominate, not the fill.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/instancing_bench.cpp src/InstanceBuffer.cpp src/NormalMatrix.cpp src/GLState.cpp
+//       src/glad.c -lglfw -o instancing_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../header/GLState.h"
+#include "../header/InstanceBuffer.h"
+#include "../header/NormalMatrix.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+const int TARGET_SIZE = 256;
+
+// Both programs write the world-space normal, so their images can be compared
+const char* PER_DRAW_VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+out vec3 Normal;
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0);
+    Normal = normalMatrix * aNormal;
+}
+)";
+
+const char* INSTANCED_VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 5) in mat4 aModel;
+layout (location = 9) in mat3 aNormalMatrix;
+out vec3 Normal;
+void main()
+{
+    gl_Position = aModel * vec4(aPos, 1.0);
+    Normal = aNormalMatrix * aNormal;
+}
+)";
+
+const char* FRAGMENT_SOURCE = R"(#version 330 core
+in vec3 Normal;
+out vec4 FragColor;
+void main()
+{
+    FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
+)";
+
+static GLuint compileStage(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cout << "ERROR::INSTANCING_BENCH::COMPILE " << infoLog << std::endl;
+    }
+    return shader;
+}
+
+static GLuint buildProgram(const char* vertexSource)
+{
+    GLuint vertex = compileStage(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compileStage(GL_FRAGMENT_SHADER, FRAGMENT_SOURCE);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return program;
+}
+
+// 36 vertices of a unit cube, position and normal
+static std::vector<float> buildCube()
+{
+    std::vector<float> vertices;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (float side : { -0.5f, 0.5f })
+        {
+            // Two other axes of the face, ordered so that the triangles face outwards
+            int u = (axis + (side > 0.0f ? 1 : 2)) % 3;
+            int v = (axis + (side > 0.0f ? 2 : 1)) % 3;
+            const float corners[6][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+            for (const float* corner : corners)
+            {
+                float vertex[6] = {};
+                vertex[axis] = side;
+                vertex[u] = corner[0];
+                vertex[v] = corner[1];
+                vertex[3 + axis] = side > 0.0f ? 1.0f : -1.0f;
+                vertices.insert(vertices.end(), vertex, vertex + 6);
+            }
+        }
+    }
+    return vertices;
+}
+
+// N cubes on a square grid covering clip space, each turned like the containers of main.cpp
+static std::vector<InstanceData> buildInstances(size_t count)
+{
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    float cell = 2.0f / side;
+    std::vector<InstanceData> instances(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 center(-1.0f + cell * (i % side + 0.5f), -1.0f + cell * (i / side + 0.5f), 0.0f);
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+        model = glm::rotate(model, glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+        instances[i].model = glm::scale(model, glm::vec3(cell * 0.5f));
+    }
+    computeNormalMatrices(instances);
+    return instances;
+}
+
+struct FrameTimes
+{
+    double submitMs;
+    double frameMs;
+};
+
+// Runs "draw" for at least "minSeconds" (one frame at least), mean times of a frame
+static FrameTimes timeFrames(const std::function<void()>& draw, double minSeconds)
+{
+    int runs = 0;
+    double submitSeconds = 0.0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        draw();
+        submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        glFinish();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return { submitSeconds * 1000.0 / runs, seconds * 1000.0 / runs };
+}
+
+static std::vector<unsigned char> readPixels()
+{
+    std::vector<unsigned char> pixels((size_t)TARGET_SIZE * TARGET_SIZE * 4);
+    glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// Pixels with a channel more than 1 apart (the two paths may round the normal differently)
+static size_t countDifferentPixels(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    size_t different = 0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (size_t channel = 0; channel < 4; channel++)
+        {
+            if (std::abs((int)a[i + channel] - (int)b[i + channel]) > 1)
+            {
+                different++;
+                break;
+            }
+        }
+    }
+    return different;
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxCount = 1000000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+            maxCount = (size_t)std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::INSTANCING_BENCH::NO_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::INSTANCING_BENCH::GLAD" << std::endl;
+        return 1;
+    }
+
+    // Render target
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_SIZE, TARGET_SIZE);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::INSTANCING_BENCH::FRAMEBUFFER" << std::endl;
+        return 1;
+    }
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    GLState& state = GLState::get();
+    GLuint perDrawProgram = buildProgram(PER_DRAW_VERTEX_SOURCE);
+    GLuint instancedProgram = buildProgram(INSTANCED_VERTEX_SOURCE);
+    GLint modelLocation = glGetUniformLocation(perDrawProgram, "model");
+    GLint normalMatrixLocation = glGetUniformLocation(perDrawProgram, "normalMatrix");
+
+    // One cube, shared by a VAO for each path
+    std::vector<float> cube = buildCube();
+    GLuint VBO;
+    glGenBuffers(1, &VBO);
+    state.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, cube.size() * sizeof(float), cube.data(), GL_STATIC_DRAW);
+    GLuint VAOs[2];
+    glGenVertexArrays(2, VAOs);
+    for (GLuint VAO : VAOs)
+    {
+        state.bindVertexArray(VAO);
+        state.bindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+    GLuint perDrawVAO = VAOs[0];
+    GLuint instancedVAO = VAOs[1];
+    InstanceBuffer instanceBuffer;
+    instanceBuffer.attach(instancedVAO);
+
+    std::cout << "Frame of N cubes into " << TARGET_SIZE << "x" << TARGET_SIZE << ", " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << std::setw(9) << "" << std::setw(26) << "per draw (N draws)" << std::setw(26) << "instanced (1 draw)" << std::endl;
+    std::cout << std::setw(9) << "N" << std::setw(14) << "submit ms" << std::setw(12) << "frame ms" << std::setw(14) << "submit ms"
+        << std::setw(12) << "frame ms" << std::setw(10) << "speedup" << std::setw(16) << "saved us/draw" << std::endl;
+
+    // The cleared target: opaque black
+    std::vector<unsigned char> background((size_t)TARGET_SIZE * TARGET_SIZE * 4, 0);
+    for (size_t i = 3; i < background.size(); i += 4)
+        background[i] = 255;
+
+    int failures = 0;
+    for (size_t count = 10; count <= maxCount; count *= 10)
+    {
+        std::vector<InstanceData> instances = buildInstances(count);
+
+        FrameTimes perDraw = timeFrames([&]()
+        {
+            state.useProgram(perDrawProgram);
+            state.bindVertexArray(perDrawVAO);
+            for (const InstanceData& instance : instances)
+            {
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &instance.model[0][0]);
+                glUniformMatrix3fv(normalMatrixLocation, 1, GL_FALSE, &instance.normalMatrix[0][0]);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
+        }, MIN_SECONDS);
+        std::vector<unsigned char> perDrawImage = readPixels();
+
+        FrameTimes instanced = timeFrames([&]()
+        {
+            instanceBuffer.upload(instances);
+            state.useProgram(instancedProgram);
+            state.bindVertexArray(instancedVAO);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instanceBuffer.getCount());
+        }, MIN_SECONDS);
+        std::vector<unsigned char> instancedImage = readPixels();
+
+        // What each draw call cost on top of the instanced frame
+        double savedPerDraw = (perDraw.frameMs - instanced.frameMs) * 1000.0 / count;
+        std::cout << std::setw(9) << count << std::fixed << std::setprecision(3) << std::setw(14) << perDraw.submitMs << std::setw(12) << perDraw.frameMs
+            << std::setw(14) << instanced.submitMs << std::setw(12) << instanced.frameMs << std::setw(9) << std::setprecision(1)
+            << perDraw.frameMs / instanced.frameMs << "x" << std::setw(16) << std::setprecision(3) << savedPerDraw << std::endl;
+
+        // Something was drawn at all: the cubes cover part of the black background
+        size_t covered = countDifferentPixels(background, instancedImage);
+        if (covered == 0)
+        {
+            std::cout << "ERROR::INSTANCING_BENCH::EMPTY_IMAGE at N = " << count << std::endl;
+            failures++;
+        }
+        size_t different = countDifferentPixels(perDrawImage, instancedImage);
+        if (different != 0)
+        {
+            std::cout << "ERROR::INSTANCING_BENCH::IMAGES_DIFFER " << different << " pixels at N = " << count << std::endl;
+            failures++;
+        }
+    }
+
+    glDeleteVertexArrays(2, VAOs);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &instanceBuffer.m_ID);
+    glDeleteProgram(perDrawProgram);
+    glDeleteProgram(instancedProgram);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+// Mesh draw benchmark: submits 10k meshes of two textures each and reports the CPU cost of a draw,
+// for the original Mesh::Draw (sampler names formatted, glGetUniformLocation and every bind on each
+// draw) and the current one (sampler handles, binds through GLState), with own buffers and in a
+// GeometryArena. Needs an OpenGL 3.3 context: opens a hidden window.
+//
+//   mesh_draw_bench [--count n]          10k meshes by default, exits with 1 on an OpenGL error
+//
+// Each mesh is one triangle drawn with rasterization discarded, so that the time is the submission
+// and not the GPU work. The textures come from 16 materials, drawn in two orders:
+//   sorted       meshes grouped by material, as a renderer sorting its draws would submit them
+//   interleaved  a different material on every mesh: no bind can be skipped
+// "ns/draw" is the CPU time of the loop of draws (glFinish runs between frames, outside of it).
+// "binds/draw" are the binds GLState let through, "dropped/draw" the ones it found redundant.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/mesh_draw_bench.cpp src/GeometryArena.cpp src/GLState.cpp src/CompactIndices.cpp
+//       src/MeshOptimizer.cpp src/PackedVertex.cpp src/Shader.cpp src/ShaderPreprocessor.cpp
+//       src/ShaderCompileWorker.cpp src/ShaderFileWatcher.cpp src/GLExtensions.cpp src/glad.c -lglfw
+//       -o mesh_draw_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../header/GLExtensions.h"
+#include "../src/Mesh.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+const unsigned int MATERIAL_COUNT = 16;
+
+const char* VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+out vec2 TexCoords;
+void main()
+{
+    gl_Position = vec4(aPos, 1.0);
+    TexCoords = aTexCoords;
+}
+)";
+
+const char* FRAGMENT_SOURCE = R"(#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+void main()
+{
+    FragColor = texture(texture_diffuse1, TexCoords) + texture(texture_specular1, TexCoords);
+}
+)";
+
+// Mesh::Draw as it was: names formatted and looked up by the driver, every bind issued, then unbound
+static void drawOriginal(const Mesh& mesh, const Shader& shader)
+{
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    unsigned int normalNr = 1;
+    unsigned int heightNr = 1;
+
+    for (unsigned int i = 0; i < mesh.textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+
+        std::string number;
+        std::string name = mesh.textures[i].type;
+        if (name == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if (name == "texture_specular")
+            number = std::to_string(specularNr++);
+        else if (name == "texture_normal")
+            number = std::to_string(normalNr++);
+        else if (name == "texture_height")
+            number = std::to_string(heightNr++);
+
+        glUniform1i(glGetUniformLocation(shader.m_ID, (name + number).c_str()), i);
+        glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+    }
+
+    glBindVertexArray(mesh.VAO);
+    // The meshes upload 16-bit indices now, the call costs the same
+    glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_SHORT, 0);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Runs "frame" for at least "minSeconds", CPU time of a frame in ns (glFinish excluded)
+static double timeFrames(const std::function<void()>& frame, double minSeconds)
+{
+    int runs = 0;
+    double frameSeconds = 0.0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        frame();
+        frameSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        glFinish();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return frameSeconds * 1e9 / runs;
+}
+
+static bool writeFile(const std::string& path, const char* source)
+{
+    std::ofstream file(path);
+    file << source;
+    return (bool)file;
+}
+
+// One triangle somewhere in clip space, with the textures of its material
+static std::vector<Mesh> buildMeshes(size_t count, const std::vector<GLuint>& textureIDs, bool sorted, GeometryArena* arena)
+{
+    MeshOptions options;
+    options.arena = arena;
+
+    std::vector<Mesh> meshes;
+    meshes.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        float x = -1.0f + 2.0f * (float)(i % 100) / 100.0f;
+        float y = -1.0f + 2.0f * (float)(i / 100 % 100) / 100.0f;
+        std::vector<Vertex> vertices(3);
+        vertices[0].Position = glm::vec3(x, y, 0.0f);
+        vertices[1].Position = glm::vec3(x + 0.02f, y, 0.0f);
+        vertices[2].Position = glm::vec3(x, y + 0.02f, 0.0f);
+
+        size_t material = sorted ? i * MATERIAL_COUNT / count : i % MATERIAL_COUNT;
+        std::vector<Texture> textures(2);
+        textures[0].id = textureIDs[material * 2];
+        textures[0].type = "texture_diffuse";
+        textures[1].id = textureIDs[material * 2 + 1];
+        textures[1].type = "texture_specular";
+        meshes.emplace_back(std::move(vertices), std::vector<unsigned int>{ 0, 1, 2 }, std::move(textures), options);
+    }
+    return meshes;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 10000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            count = (size_t)std::max(1, std::atoi(argv[++i]));
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::MESH_DRAW_BENCH::NO_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::MESH_DRAW_BENCH::GLAD" << std::endl;
+        return 1;
+    }
+    GLExt::load((GLADloadproc)glfwGetProcAddress);
+
+    // A framebuffer of its own, the draws need a complete one even with rasterization discarded
+    GLuint framebuffer, colorBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 16, 16);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::MESH_DRAW_BENCH::FRAMEBUFFER" << std::endl;
+        return 1;
+    }
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    std::filesystem::path folder = std::filesystem::temp_directory_path();
+    std::string vertexPath = (folder / "mesh_draw_bench.vs").string();
+    std::string fragmentPath = (folder / "mesh_draw_bench.fs").string();
+    if (!writeFile(vertexPath, VERTEX_SOURCE) || !writeFile(fragmentPath, FRAGMENT_SOURCE))
+    {
+        std::cout << "ERROR::MESH_DRAW_BENCH::WRITE " << folder.string() << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+        GLState& state = GLState::get();
+
+        // A diffuse and a specular 1x1 texture per material
+        std::vector<GLuint> textureIDs(MATERIAL_COUNT * 2);
+        glGenTextures((GLsizei)textureIDs.size(), textureIDs.data());
+        for (size_t i = 0; i < textureIDs.size(); i++)
+        {
+            unsigned char texel[4] = { (unsigned char)i, 0, 0, 255 };
+            state.bindTexture(0, GL_TEXTURE_2D, textureIDs[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        }
+
+        std::unique_ptr<GeometryArena> arena(new GeometryArena(sizeof(Vertex), Mesh::setVertexAttributes, count * 3, count * 8));
+
+        std::cout << count << " meshes, 2 textures each, " << MATERIAL_COUNT << " materials, " << glGetString(GL_RENDERER) << std::endl;
+        std::cout << std::left << std::setw(13) << "order" << std::setw(20) << "path" << std::right << std::setw(10) << "ns/draw"
+            << std::setw(12) << "binds/draw" << std::setw(14) << "dropped/draw" << std::endl;
+
+        for (bool sorted : { true, false })
+        {
+            std::vector<Mesh> meshes = buildMeshes(count, textureIDs, sorted, nullptr);
+            std::vector<Mesh> arenaMeshes = buildMeshes(count, textureIDs, sorted, arena.get());
+
+            struct Path
+            {
+                const char* name;
+                std::function<void()> frame;
+                bool throughGLState;
+            };
+            const Path paths[] = {
+                { "original", [&]()
+                    {
+                        shader.use();
+                        for (const Mesh& mesh : meshes)
+                            drawOriginal(mesh, shader);
+                        // Bound behind the cache's back
+                        state.invalidate();
+                    }, false },
+                { "Mesh::Draw", [&]()
+                    {
+                        shader.use();
+                        for (Mesh& mesh : meshes)
+                            mesh.Draw(shader);
+                    }, true },
+                { "Mesh::Draw, arena", [&]()
+                    {
+                        shader.use();
+                        for (Mesh& mesh : arenaMeshes)
+                            mesh.Draw(shader);
+                    }, true },
+            };
+
+            for (const Path& path : paths)
+            {
+                // Warm: the sampler handles resolved and the units sent, as after the first frame
+                path.frame();
+                glFinish();
+                unsigned int issued = state.getIssuedCallCount();
+                unsigned int saved = state.getSavedCallCount();
+                path.frame();
+                double bindsPerDraw = (double)(state.getIssuedCallCount() - issued) / count;
+                double droppedPerDraw = (double)(state.getSavedCallCount() - saved) / count;
+
+                double ns = timeFrames(path.frame, MIN_SECONDS) / count;
+                std::cout << std::left << std::setw(13) << (sorted ? "sorted" : "interleaved") << std::setw(20) << path.name << std::right
+                    << std::fixed << std::setprecision(1) << std::setw(10) << ns;
+                if (path.throughGLState)
+                    std::cout << std::setprecision(2) << std::setw(12) << bindsPerDraw << std::setw(14) << droppedPerDraw;
+                else // 2 x (glActiveTexture, glBindTexture), the VAO bound and unbound, unit 0 restored
+                    std::cout << std::setw(12) << "7" << std::setw(14) << "-";
+                std::cout << std::endl;
+            }
+        }
+
+        // Every path drew without an OpenGL error
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            std::cout << "ERROR::MESH_DRAW_BENCH::GL_ERROR " << error << std::endl;
+            failures++;
+        }
+
+        glDeleteTextures((GLsizei)textureIDs.size(), textureIDs.data());
+        arena->deleteBuffers();
+    }
+
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    std::filesystem::remove(vertexPath);
+    std::filesystem::remove(fragmentPath);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
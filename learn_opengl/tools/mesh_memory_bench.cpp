@@ -0,0 +1,265 @@
+// Mesh memory benchmark: builds one large synthetic mesh (a 1000x1000 grid, 2M triangles) the ways a
+// loader can hand it to Mesh, and measures the resident memory of the process: the peak while the
+// mesh is built and uploaded, and what stays once the loader's vectors are gone. Linux only (each
+// mode runs in a child process of its own, so that every peak starts from the same point).
+// Needs an OpenGL 3.3 context: opens a hidden window.
+//
+//   mesh_memory_bench [--size n]          1000x1000 quads by default, exits with 1 if a check fails
+//
+//   original   the copies of the constructor before it moved: a by-value copy and a member copy
+//   lvalue     the vectors passed as lvalues: one copy
+//   moved      the vectors passed with std::move: no copy
+//   released   moved, and MeshOptions::keepCpuData = false: the CPU copy freed after the upload
+//
+// Memory is read from /proc/self/statm (resident now) and getrusage (resident peak), relative to the
+// process before the mesh data is generated. The driver's own copy of the buffers counts too: with a
+// software renderer it stays in RAM. The indices are not optimized (MeshOptions::optimizeIndices is
+// opt-in), which would add its own peak.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/mesh_memory_bench.cpp src/GeometryArena.cpp src/GLState.cpp src/CompactIndices.cpp
+//       src/MeshOptimizer.cpp src/PackedVertex.cpp src/Shader.cpp src/ShaderPreprocessor.cpp
+//       src/ShaderCompileWorker.cpp src/ShaderFileWatcher.cpp src/GLExtensions.cpp src/glad.c -lglfw
+//       -o mesh_memory_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../src/Mesh.cpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+enum class MeshHandOff
+{
+    ORIGINAL,
+    LVALUE,
+    MOVED,
+    RELEASED
+};
+
+// What a child measured, in bytes
+struct MemoryReport
+{
+    size_t dataBytes;
+    size_t peakBytes;
+    size_t steadyBytes;
+    size_t cpuDataBytes;
+    bool ok;
+};
+
+#ifdef __linux__
+
+static size_t getResidentBytes()
+{
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr)
+        return 0;
+    unsigned long pages = 0, resident = 0;
+    int read = std::fscanf(file, "%lu %lu", &pages, &resident);
+    std::fclose(file);
+    return read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+static size_t getPeakResidentBytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // Kilobytes on Linux
+    return (size_t)usage.ru_maxrss * 1024;
+}
+
+// (size + 1)^2 vertices, 2 triangles per quad
+static void buildGrid(unsigned int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.resize((size_t)(size + 1) * (size + 1));
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+        {
+            Vertex& vertex = vertices[(size_t)y * (size + 1) + x];
+            vertex.Position = glm::vec3((float)x, (float)y, 0.0f);
+            vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.TexCoords = glm::vec2((float)x / size, (float)y / size);
+            vertex.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+            vertex.Bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+    indices.reserve((size_t)size * size * 6);
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            unsigned int corner = y * (size + 1) + x;
+            unsigned int quad[6] = { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Builds the mesh in a fresh context, in the child process
+static MemoryReport measure(MeshHandOff handOff, unsigned int size)
+{
+    MemoryReport report = {};
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+        return report;
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        return report;
+
+    size_t baseline = getResidentBytes();
+    {
+        std::unique_ptr<Mesh> mesh;
+        {
+            // The loader's vectors
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            buildGrid(size, vertices, indices);
+            report.dataBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int);
+
+            MeshOptions options;
+            if (handOff == MeshHandOff::ORIGINAL)
+            {
+                // The old constructor took copies by value, then copy-assigned them to the members:
+                // the member copy is alive while the parameters are
+                std::vector<Vertex> memberVertices = vertices;
+                std::vector<unsigned int> memberIndices = indices;
+                mesh.reset(new Mesh(vertices, indices, std::vector<Texture>(), options));
+            }
+            else if (handOff == MeshHandOff::LVALUE)
+                mesh.reset(new Mesh(vertices, indices, std::vector<Texture>(), options));
+            else
+            {
+                options.keepCpuData = handOff != MeshHandOff::RELEASED;
+                mesh.reset(new Mesh(std::move(vertices), std::move(indices), std::vector<Texture>(), options));
+            }
+            glFinish();
+        }
+        // The loader is done: what is left is the mesh
+        report.steadyBytes = getResidentBytes() - baseline;
+        report.peakBytes = getPeakResidentBytes() - baseline;
+        report.cpuDataBytes = mesh->getCpuDataSize();
+        report.ok = true;
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return report;
+}
+
+// Runs "measure" in a child process, its report comes back through a pipe
+static MemoryReport measureInChild(MeshHandOff handOff, unsigned int size)
+{
+    MemoryReport report = {};
+    int channel[2];
+    if (pipe(channel) != 0)
+        return report;
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(channel[0]);
+        MemoryReport childReport = measure(handOff, size);
+        ssize_t written = write(channel[1], &childReport, sizeof(childReport));
+        close(channel[1]);
+        _exit(written == (ssize_t)sizeof(childReport) ? 0 : 1);
+    }
+    close(channel[1]);
+    if (child > 0)
+    {
+        if (read(channel[0], &report, sizeof(report)) != (ssize_t)sizeof(report))
+            report.ok = false;
+        waitpid(child, nullptr, 0);
+    }
+    close(channel[0]);
+    return report;
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+#ifndef __linux__
+    (void)argc;
+    (void)argv;
+    std::cout << "ERROR::MESH_MEMORY_BENCH::LINUX_ONLY" << std::endl;
+    return 1;
+#else
+    unsigned int size = 1000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = (unsigned int)std::max(1, std::atoi(argv[++i]));
+    }
+
+    struct Mode
+    {
+        const char* name;
+        MeshHandOff handOff;
+    };
+    const Mode modes[] = {
+        { "original", MeshHandOff::ORIGINAL },
+        { "lvalue", MeshHandOff::LVALUE },
+        { "moved", MeshHandOff::MOVED },
+        { "released", MeshHandOff::RELEASED },
+    };
+
+    const double MB = 1024.0 * 1024.0;
+    int failures = 0;
+    MemoryReport reports[4];
+    for (int i = 0; i < 4; i++)
+    {
+        reports[i] = measureInChild(modes[i].handOff, size);
+        if (!reports[i].ok)
+        {
+            std::cout << "ERROR::MESH_MEMORY_BENCH::NO_REPORT " << modes[i].name << std::endl;
+            return 1;
+        }
+        if (i == 0)
+        {
+            std::cout << size << "x" << size << " grid, " << (size_t)size * size * 2 << " triangles, " << std::fixed << std::setprecision(1)
+                << reports[0].dataBytes / MB << " MB of vertices and indices" << std::endl;
+            std::cout << std::left << std::setw(12) << "mode" << std::right << std::setw(12) << "peak MB" << std::setw(12) << "steady MB"
+                << std::setw(14) << "CPU data MB" << std::endl;
+        }
+        std::cout << std::left << std::setw(12) << modes[i].name << std::right << std::setw(12) << reports[i].peakBytes / MB
+            << std::setw(12) << reports[i].steadyBytes / MB << std::setw(14) << reports[i].cpuDataBytes / MB << std::endl;
+    }
+
+    // Each copy the constructor no longer makes is the size of the data off the peak (90% of it at
+    // least, the allocator and the driver move a little), and releasing frees the CPU copy
+    const MemoryReport& original = reports[0];
+    const MemoryReport& lvalue = reports[1];
+    const MemoryReport& moved = reports[2];
+    const MemoryReport& released = reports[3];
+    size_t dataBytes = original.dataBytes;
+    if (original.peakBytes < lvalue.peakBytes + dataBytes * 9 / 10 || lvalue.peakBytes < moved.peakBytes + dataBytes * 9 / 10)
+    {
+        std::cout << "ERROR::MESH_MEMORY_BENCH::PEAK_NOT_REDUCED" << std::endl;
+        failures++;
+    }
+    if (released.cpuDataBytes != 0 || moved.steadyBytes < released.steadyBytes + dataBytes * 9 / 10)
+    {
+        std::cout << "ERROR::MESH_MEMORY_BENCH::CPU_DATA_NOT_RELEASED" << std::endl;
+        failures++;
+    }
+    return failures == 0 ? 0 : 1;
+#endif
+}
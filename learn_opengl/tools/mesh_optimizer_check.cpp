@@ -0,0 +1,167 @@
+// Mesh optimizer check: a 300x300 grid with its triangles shuffled goes through optimizeMesh, the
+// cache simulator runs before and after, and every triangle is checked to come out of the three
+// passes whole and with its winding. Headless, no OpenGL.
+//
+//   mesh_optimizer_check [--size n]          300x300 quads by default, exits with 1 if a check fails
+//
+// Checks:
+// - ACMR and ATVR go down, the ACMR under MAX_ACMR (0.5 is the ideal of a large grid)
+// - the same triangles come out: each one found among the input ones (through the positions, the
+//   vertices being renumbered), with its corners in the same cyclic order
+// - no triangle turns around: the grid faces +Z, every signed area stays positive
+// Built from learn_opengl/ e.g.
+//   g++ -std=c++17 -O2 tools/mesh_optimizer_check.cpp src/MeshOptimizer.cpp -o mesh_optimizer_check
+
+#include "../header/MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+const float MAX_ACMR = 0.8f;
+
+struct GridVertex
+{
+    float position[3];
+};
+
+// A triangle as the corners' grid coordinates, rotated so that the smallest comes first: the
+// cyclic order (the winding) is kept, so a flipped triangle does not compare equal
+typedef std::tuple<uint64_t, uint64_t, uint64_t> TriangleKey;
+
+static uint64_t gridKey(const GridVertex& vertex)
+{
+    return ((uint64_t)(uint32_t)vertex.position[1] << 32) | (uint32_t)vertex.position[0];
+}
+
+static TriangleKey triangleKey(const std::vector<GridVertex>& vertices, const unsigned int* triangle)
+{
+    uint64_t a = gridKey(vertices[triangle[0]]), b = gridKey(vertices[triangle[1]]), c = gridKey(vertices[triangle[2]]);
+    if (b < a && b < c)
+        return TriangleKey(b, c, a);
+    if (c < a && c < b)
+        return TriangleKey(c, a, b);
+    return TriangleKey(a, b, c);
+}
+
+// Twice the area in the XY plane, positive when counter-clockwise seen from +Z
+static float signedArea(const std::vector<GridVertex>& vertices, const unsigned int* triangle)
+{
+    const float* a = vertices[triangle[0]].position;
+    const float* b = vertices[triangle[1]].position;
+    const float* c = vertices[triangle[2]].position;
+    return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+static std::map<TriangleKey, int> countTriangles(const std::vector<GridVertex>& vertices, const std::vector<unsigned int>& indices)
+{
+    std::map<TriangleKey, int> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        triangles[triangleKey(vertices, &indices[i])]++;
+    return triangles;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int size = 300;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = (unsigned int)std::max(1, std::atoi(argv[++i]));
+    }
+
+    // (size + 1)^2 vertices on integer coordinates, two counter-clockwise triangles per quad
+    std::vector<GridVertex> vertices;
+    vertices.reserve((size_t)(size + 1) * (size + 1));
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+            vertices.push_back({ { (float)x, (float)y, 0.0f } });
+    }
+    std::vector<unsigned int> indices;
+    indices.reserve((size_t)size * size * 6);
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            unsigned int corner = y * (size + 1) + x;
+            unsigned int quad[6] = { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    // Fixed seed: triangles in random order, each starting from a random corner (same winding)
+    std::mt19937 random(12345);
+    size_t triangleCount = indices.size() / 3;
+    std::vector<size_t> order(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+    std::vector<unsigned int> shuffled;
+    shuffled.reserve(indices.size());
+    for (size_t triangle : order)
+    {
+        unsigned int first = random() % 3;
+        for (unsigned int corner = 0; corner < 3; corner++)
+            shuffled.push_back(indices[triangle * 3 + (first + corner) % 3]);
+    }
+    indices.swap(shuffled);
+
+    std::map<TriangleKey, int> expected = countTriangles(vertices, indices);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MeshOptimizationReport report = optimizeMesh(vertices, indices, 0);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << size << "x" << size << " grid, " << triangleCount << " triangles, shuffled, optimized in "
+        << std::fixed << std::setprecision(1) << ms << " ms" << std::endl;
+    std::cout << std::setprecision(3) << "ACMR " << report.before.acmr << " -> " << report.after.acmr << " ("
+        << std::setprecision(2) << report.before.acmr / report.after.acmr << "x fewer vertex shader runs)" << std::endl;
+    std::cout << std::setprecision(3) << "ATVR " << report.before.atvr << " -> " << report.after.atvr
+        << " (FIFO cache of " << VERTEX_CACHE_SIZE << ")" << std::endl;
+
+    int failures = 0;
+    if (report.after.acmr >= report.before.acmr || report.after.atvr >= report.before.atvr)
+    {
+        std::cout << "ERROR::MESH_OPTIMIZER_CHECK::NO_GAIN" << std::endl;
+        failures++;
+    }
+    if (report.after.acmr > MAX_ACMR)
+    {
+        std::cout << "ERROR::MESH_OPTIMIZER_CHECK::ACMR_TOO_HIGH " << report.after.acmr << " > " << MAX_ACMR << std::endl;
+        failures++;
+    }
+    if (vertices.size() != (size_t)(size + 1) * (size + 1) || indices.size() != triangleCount * 3)
+    {
+        std::cout << "ERROR::MESH_OPTIMIZER_CHECK::SIZE_CHANGED " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
+        failures++;
+    }
+    else if (countTriangles(vertices, indices) != expected)
+    {
+        std::cout << "ERROR::MESH_OPTIMIZER_CHECK::TRIANGLES_CHANGED" << std::endl;
+        failures++;
+    }
+
+    size_t flipped = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        if (signedArea(vertices, &indices[i]) <= 0.0f)
+            flipped++;
+    }
+    if (flipped != 0)
+    {
+        std::cout << "ERROR::MESH_OPTIMIZER_CHECK::WINDING_FLIPPED " << flipped << " of " << triangleCount << std::endl;
+        failures++;
+    }
+
+    std::cout << (failures == 0 ? "All mesh optimizer checks passed" : "Mesh optimizer checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// Normal matrix benchmark: computes the normal matrices of random model matrices with the kernels of
+// NormalMatrix.h and with the scalar glm expression the vertex shader used, reports their throughput
+// in ns/matrix and checks them against glm. Headless, no OpenGL.
+//
+//   normal_matrix_bench [--count n]          10k matrices by default, exits with 1 if a result differs
+//
+//   glm                   glm::transpose(glm::inverse(glm::mat3(model))), one matrix at a time
+//   computeNormalMatrix   the cross product form, one matrix at a time (SSE when available)
+//   batch SoA             computeNormalMatrices on Mat3SoA arrays: 8 matrices per iteration with
+//                         -mavx, 4 with SSE2 (x86-64 default)
+//   batch instances       computeNormalMatrices on InstanceData, the gather and scatter included
+//                         (what main.cpp calls)
+// Built from learn_opengl/ with the include paths of the app (glm, glad), e.g.
+//   g++ -std=c++17 -O2 -mavx tools/normal_matrix_bench.cpp src/NormalMatrix.cpp -o normal_matrix_bench
+
+#include "../header/NormalMatrix.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+// Float results against glm's, relative to the largest element of the matrix
+const float MAX_RELATIVE_ERROR = 1e-4f;
+
+// Runs "compute" for at least "minSeconds", in ns/matrix
+static double timeMatrices(const std::function<void()>& compute, size_t count, double minSeconds)
+{
+    int runs = 0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        compute();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return seconds * 1e9 / ((double)count * runs);
+}
+
+static const char* getKernelName()
+{
+#if defined(__AVX__)
+    return "AVX, 8 matrices per iteration";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2, 4 matrices per iteration";
+#else
+    return "scalar";
+#endif
+}
+
+// Number of matrices off the reference by more than MAX_RELATIVE_ERROR
+static size_t countWrongMatrices(const std::vector<glm::mat3>& results, const std::vector<glm::mat3>& reference)
+{
+    size_t wrong = 0;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        float largest = 0.0f;
+        float error = 0.0f;
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                largest = std::max(largest, std::fabs(reference[i][column][row]));
+                error = std::max(error, std::fabs(results[i][column][row] - reference[i][column][row]));
+            }
+        }
+        if (error > MAX_RELATIVE_ERROR * largest)
+            wrong++;
+    }
+    return wrong;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 10000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            count = (size_t)std::strtoull(argv[++i], nullptr, 10);
+    }
+
+    // Fixed seed: translated, turned and non-uniformly scaled objects (where the normal matrix
+    // differs from the model matrix)
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.2f, 5.0f);
+    std::vector<InstanceData> instances(count);
+    Mat3SoA models;
+    models.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        glm::vec3 rotationAxis(axis(random), axis(random), axis(random));
+        if (glm::length(rotationAxis) < 0.01f)
+            rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+        model = glm::rotate(model, glm::radians(angle(random)), rotationAxis);
+        instances[i].model = glm::scale(model, glm::vec3(scale(random), scale(random), scale(random)));
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+                models.m[column * 3 + row][i] = instances[i].model[column][row];
+        }
+    }
+
+    std::vector<glm::mat3> reference(count);
+    std::vector<glm::mat3> single(count);
+    std::vector<glm::mat3> batchSoA(count);
+    std::vector<glm::mat3> batchInstances(count);
+    Mat3SoA normalMatrices;
+
+    double glmTime = timeMatrices([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            reference[i] = glm::transpose(glm::inverse(glm::mat3(instances[i].model)));
+    }, count, MIN_SECONDS);
+    double singleTime = timeMatrices([&]()
+    {
+        for (size_t i = 0; i < count; i++)
+            single[i] = computeNormalMatrix(instances[i].model);
+    }, count, MIN_SECONDS);
+    double batchSoATime = timeMatrices([&]() { computeNormalMatrices(models, normalMatrices); }, count, MIN_SECONDS);
+    double batchInstancesTime = timeMatrices([&]() { computeNormalMatrices(instances); }, count, MIN_SECONDS);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+                batchSoA[i][column][row] = normalMatrices.m[column * 3 + row][i];
+        }
+        batchInstances[i] = instances[i].normalMatrix;
+    }
+
+    struct Result
+    {
+        const char* name;
+        double nsPerMatrix;
+        const std::vector<glm::mat3>* matrices;
+    };
+    const Result results[] = {
+        { "glm", glmTime, &reference },
+        { "computeNormalMatrix", singleTime, &single },
+        { "batch SoA", batchSoATime, &batchSoA },
+        { "batch instances", batchInstancesTime, &batchInstances },
+    };
+
+    std::cout << count << " matrices, " << getKernelName() << std::endl;
+    std::cout << std::left << std::setw(22) << "path" << std::right << std::setw(12) << "ns/matrix" << std::setw(10) << "speedup" << std::endl;
+    int failures = 0;
+    for (const Result& result : results)
+    {
+        std::cout << std::left << std::setw(22) << result.name << std::right << std::fixed << std::setprecision(2) << std::setw(12)
+            << result.nsPerMatrix << std::setw(9) << std::setprecision(1) << glmTime / result.nsPerMatrix << "x" << std::endl;
+        size_t wrong = countWrongMatrices(*result.matrices, reference);
+        if (wrong != 0)
+        {
+            std::cout << "ERROR::NORMAL_MATRIX_BENCH::RESULTS_DIFFER " << result.name << ": " << wrong << " of " << count << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
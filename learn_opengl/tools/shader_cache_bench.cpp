@@ -0,0 +1,159 @@
+// Shader cache benchmark: builds variants of the lighting program of main.cpp (1.colors.vs/.fs) twice,
+// first with the program binary cache empty (cold start: compiled from source, the binaries saved),
+// then with it filled (warm start: loaded back), and reports the time of each pass.
+// Run from learn_opengl/, where the shader files are. Needs an OpenGL 3.3 context: opens a hidden window.
+//
+//   shader_cache_bench [--count n]          16 programs by default, exits with 1 if the cache is unsupported
+//                                           or a pass did not come from where it should
+//
+// The programs are built Immediate, so a pass is over when every program is linked (or loaded) and
+// checked. Every run injects a define of its own into the sources, so that a cache of the driver
+// (Mesa's on-disk one, for instance) cannot turn the cold pass into a warm one. The cache directory
+// is a temporary one, emptied before and removed after.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/shader_cache_bench.cpp src/Shader.cpp src/ShaderPreprocessor.cpp
+//       src/ShaderCompileWorker.cpp src/ShaderFileWatcher.cpp src/GLExtensions.cpp src/GLState.cpp src/glad.c -lglfw
+//       -o shader_cache_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../header/GLExtensions.h"
+#include "../header/Shader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+const char* PATH_COLOR_VS = "1.colors.vs";
+const char* PATH_COLOR_FS = "1.colors.fs";
+
+// The defines of variant "index": the switches of lighting.glsl, then the index itself so that any
+// count of programs differs
+static ShaderDefines getVariantDefines(unsigned int index, const std::string& run)
+{
+    ShaderDefines defines;
+    defines["NR_POINT_LIGHTS"] = std::to_string(index % 5);
+    defines["USE_DIR_LIGHT"] = (index / 5) % 2 ? "1" : "0";
+    defines["USE_SPOT_LIGHT"] = (index / 10) % 2 ? "1" : "0";
+    defines["HAS_SPECULAR_MAP"] = (index / 20) % 2 ? "0" : "1";
+    defines["BENCH_VARIANT"] = std::to_string(index);
+    defines["BENCH_RUN"] = run;
+    return defines;
+}
+
+// Builds the "count" variants, in ms. "fromCache" counts the programs loaded from the binary cache,
+// "failed" the ones without a program
+static double buildPrograms(unsigned int count, const std::string& run, unsigned int& fromCache, unsigned int& failed)
+{
+    fromCache = 0;
+    failed = 0;
+    std::vector<std::unique_ptr<Shader>> shaders;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++)
+        shaders.emplace_back(new Shader(PATH_COLOR_VS, PATH_COLOR_FS, nullptr, ShaderBuildMode::Immediate, getVariantDefines(i, run)));
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::unique_ptr<Shader>& shader : shaders)
+    {
+        GLint linked = 0;
+        if (shader->m_ID != 0)
+            glGetProgramiv(shader->m_ID, GL_LINK_STATUS, &linked);
+        if (!linked)
+            failed++;
+        if (shader->isFromBinaryCache())
+            fromCache++;
+        glDeleteProgram(shader->m_ID);
+    }
+    return milliseconds;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int count = 16;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            count = (unsigned int)std::max(1, std::atoi(argv[++i]));
+    }
+
+    if (!std::filesystem::exists(PATH_COLOR_VS) || !std::filesystem::exists(PATH_COLOR_FS))
+    {
+        std::cout << "ERROR::SHADER_CACHE_BENCH::FILE_NOT_FOUND: run from learn_opengl/" << std::endl;
+        return 1;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::SHADER_CACHE_BENCH::NO_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::SHADER_CACHE_BENCH::NO_GLAD" << std::endl;
+        return 1;
+    }
+    GLExt::load((GLADloadproc)glfwGetProcAddress);
+
+    int failures = 0;
+    if (!GLExt::programBinary)
+    {
+        std::cout << "ERROR::SHADER_CACHE_BENCH::NO_PROGRAM_BINARY: the driver has no program binary format" << std::endl;
+        failures++;
+    }
+    else
+    {
+        std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "shader_cache_bench";
+        std::error_code error;
+        std::filesystem::remove_all(cacheDirectory, error);
+        Shader::setBinaryCacheDirectory(cacheDirectory.string());
+        std::string run = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+        unsigned int coldFromCache = 0, coldFailed = 0, warmFromCache = 0, warmFailed = 0;
+        double cold = buildPrograms(count, run, coldFromCache, coldFailed);
+        double warm = buildPrograms(count, run, warmFromCache, warmFailed);
+
+        std::cout << count << " programs, " << (const char*)glGetString(GL_RENDERER) << std::endl;
+        std::cout << std::left << std::setw(8) << "start" << std::right << std::setw(12) << "total ms" << std::setw(14) << "ms/program"
+            << std::setw(14) << "from cache" << std::endl;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << std::left << std::setw(8) << "cold" << std::right << std::setw(12) << cold << std::setw(14) << cold / count
+            << std::setw(11) << coldFromCache << "/" << count << std::endl;
+        std::cout << std::left << std::setw(8) << "warm" << std::right << std::setw(12) << warm << std::setw(14) << warm / count
+            << std::setw(11) << warmFromCache << "/" << count << std::endl;
+        std::cout << std::setprecision(1) << "warm start " << cold / warm << "x faster" << std::endl;
+
+        if (coldFailed != 0 || warmFailed != 0)
+        {
+            std::cout << "ERROR::SHADER_CACHE_BENCH::BUILD_FAILED" << std::endl;
+            failures++;
+        }
+        if (coldFromCache != 0 || warmFromCache != count)
+        {
+            std::cout << "ERROR::SHADER_CACHE_BENCH::WRONG_SOURCE: the cold pass must compile, the warm pass load" << std::endl;
+            failures++;
+        }
+
+        Shader::setBinaryCacheDirectory("");
+        std::filesystem::remove_all(cacheDirectory, error);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// std140 packer check: the layout rules of Std140Buffer, the offsets of LightBlock against the
+// std140 layout of the LightBlock uniform block in lighting.glsl, and the dirty range the uploads
+// rely on. Headless, no OpenGL: the buffer is only read back on the CPU.
+//
+//   std140_check             exits with 1 if a check fails
+//
+// Built from learn_opengl/ with the include paths of the app (glm), e.g.
+//   g++ -std=c++17 -O2 tools/std140_check.cpp src/Std140.cpp src/LightBlock.cpp -o std140_check
+
+#include "../header/LightBlock.h"
+#include "../header/Std140.h"
+
+#include <cstring>
+#include <iostream>
+
+static int failures = 0;
+
+static void checkEqual(size_t value, size_t expected, const char* what)
+{
+    if (value == expected)
+        return;
+    std::cout << "ERROR::STD140_CHECK::" << what << " " << value << " != " << expected << std::endl;
+    failures++;
+}
+
+static float readFloat(const Std140Buffer& buffer, size_t offset)
+{
+    float value;
+    std::memcpy(&value, buffer.data() + offset, sizeof(float));
+    return value;
+}
+
+// The float at "offset" holds the value written there (exact: small integers)
+static void checkFloatAt(const Std140Buffer& buffer, size_t offset, float expected, const char* what)
+{
+    float value = readFloat(buffer, offset);
+    if (value == expected)
+        return;
+    std::cout << "ERROR::STD140_CHECK::" << what << " at " << offset << ": " << value << " != " << expected << std::endl;
+    failures++;
+}
+
+// ------------------------------------------------------------------------
+// layout rules
+static void checkLayoutRules()
+{
+    Std140Buffer buffer;
+    // A scalar after a vec3 fills its 4 padding bytes
+    checkEqual(buffer.pushVec3(), 0, "VEC3_OFFSET");
+    checkEqual(buffer.pushFloat(), 12, "FLOAT_AFTER_VEC3");
+    // vec2 on 8, vec3 and vec4 on 16
+    checkEqual(buffer.pushVec2(), 16, "VEC2_OFFSET");
+    checkEqual(buffer.pushFloat(), 24, "FLOAT_AFTER_VEC2");
+    checkEqual(buffer.pushVec3(), 32, "VEC3_ALIGNED_16");
+    checkEqual(buffer.pushVec4(), 48, "VEC4_OFFSET");
+    // Matrix columns are vec4-padded: a mat3 takes 48 bytes
+    checkEqual(buffer.pushMat3(), 64, "MAT3_OFFSET");
+    checkEqual(buffer.pushFloat(), 112, "FLOAT_AFTER_MAT3");
+    checkEqual(buffer.pushMat4(), 128, "MAT4_OFFSET");
+    // A struct starts on 16 and the member after it too
+    checkEqual(buffer.pushFloat(), 192, "FLOAT_BEFORE_STRUCT");
+    checkEqual(buffer.beginStruct(), 208, "STRUCT_OFFSET");
+    checkEqual(buffer.pushFloat(), 208, "STRUCT_MEMBER");
+    buffer.endStruct();
+    checkEqual(buffer.pushFloat(), 224, "FLOAT_AFTER_STRUCT");
+    checkEqual(buffer.size(), 228, "SIZE");
+
+    // mat3 columns land on 16-byte boundaries
+    glm::mat3 mat(1.0f);
+    mat[2][2] = 5.0f;
+    buffer.setMat3(64, mat);
+    checkFloatAt(buffer, 64, 1.0f, "MAT3_COLUMN0");
+    checkFloatAt(buffer, 64 + 16 + 4, 1.0f, "MAT3_COLUMN1");
+    checkFloatAt(buffer, 64 + 32 + 8, 5.0f, "MAT3_COLUMN2");
+}
+
+// ------------------------------------------------------------------------
+// LightBlock offsets
+static void checkLightBlock()
+{
+    LightBlock block;
+    Std140Buffer& buffer = block.getBuffer();
+    // DirLight: 4 vec3 = 64 bytes, 4 PointLight of 80, SpotLight of 96
+    checkEqual(buffer.size(), 64 + LightBlock::MAX_POINT_LIGHTS * 80 + 96, "LIGHT_BLOCK_SIZE");
+
+    DirLight dirLight = { glm::vec3(1.0f, 2.0f, 3.0f), glm::vec3(4.0f), glm::vec3(5.0f), glm::vec3(6.0f) };
+    block.setDirLight(dirLight);
+    checkFloatAt(buffer, 0, 1.0f, "DIR_DIRECTION");
+    checkFloatAt(buffer, 8, 3.0f, "DIR_DIRECTION_Z");
+    checkFloatAt(buffer, 16, 4.0f, "DIR_AMBIENT");
+    checkFloatAt(buffer, 32, 5.0f, "DIR_DIFFUSE");
+    checkFloatAt(buffer, 48, 6.0f, "DIR_SPECULAR");
+
+    // PointLight fields at 0/12/16/20/32/48/64 of an 80-byte array element
+    const size_t pointLights = 64;
+    const size_t pointLightStride = 80;
+    for (unsigned int i = 0; i < LightBlock::MAX_POINT_LIGHTS; i++)
+    {
+        float base = 10.0f * (i + 1);
+        PointLight light = { glm::vec3(base + 1.0f), base + 2.0f, base + 3.0f, base + 4.0f,
+            glm::vec3(base + 5.0f), glm::vec3(base + 6.0f), glm::vec3(base + 7.0f) };
+        block.setPointLight(i, light);
+
+        size_t offset = pointLights + i * pointLightStride;
+        checkFloatAt(buffer, offset + 0, base + 1.0f, "POINT_POSITION");
+        checkFloatAt(buffer, offset + 8, base + 1.0f, "POINT_POSITION_Z");
+        checkFloatAt(buffer, offset + 12, base + 2.0f, "POINT_CONSTANT");
+        checkFloatAt(buffer, offset + 16, base + 3.0f, "POINT_LINEAR");
+        checkFloatAt(buffer, offset + 20, base + 4.0f, "POINT_QUADRATIC");
+        checkFloatAt(buffer, offset + 32, base + 5.0f, "POINT_AMBIENT");
+        checkFloatAt(buffer, offset + 48, base + 6.0f, "POINT_DIFFUSE");
+        checkFloatAt(buffer, offset + 64, base + 7.0f, "POINT_SPECULAR");
+    }
+
+    // SpotLight after the array: vec3, vec3, 5 floats (the first filling the vec3 padding), 3 vec3
+    const size_t spotLight = pointLights + LightBlock::MAX_POINT_LIGHTS * pointLightStride;
+    SpotLight spot = { glm::vec3(101.0f), glm::vec3(102.0f), 103.0f, 104.0f, 105.0f, 106.0f, 107.0f,
+        glm::vec3(108.0f), glm::vec3(109.0f), glm::vec3(110.0f) };
+    block.setSpotLight(spot);
+    checkFloatAt(buffer, spotLight + 0, 101.0f, "SPOT_POSITION");
+    checkFloatAt(buffer, spotLight + 16, 102.0f, "SPOT_DIRECTION");
+    checkFloatAt(buffer, spotLight + 28, 103.0f, "SPOT_CUTOFF");
+    checkFloatAt(buffer, spotLight + 32, 104.0f, "SPOT_OUTER_CUTOFF");
+    checkFloatAt(buffer, spotLight + 36, 105.0f, "SPOT_CONSTANT");
+    checkFloatAt(buffer, spotLight + 40, 106.0f, "SPOT_LINEAR");
+    checkFloatAt(buffer, spotLight + 44, 107.0f, "SPOT_QUADRATIC");
+    checkFloatAt(buffer, spotLight + 48, 108.0f, "SPOT_AMBIENT");
+    checkFloatAt(buffer, spotLight + 64, 109.0f, "SPOT_DIFFUSE");
+    checkFloatAt(buffer, spotLight + 80, 110.0f, "SPOT_SPECULAR");
+
+    // Same light again: nothing to upload
+    buffer.clearDirty();
+    block.setSpotLight(spot);
+    checkEqual(buffer.isDirty(), false, "UNCHANGED_LIGHT_DIRTY");
+}
+
+// ------------------------------------------------------------------------
+// dirty range
+static void checkDirtyRange()
+{
+    Std140Buffer buffer;
+    size_t first = buffer.pushVec4();
+    size_t second = buffer.pushFloat();
+    size_t third = buffer.pushVec3();
+    size_t last = buffer.pushMat3();
+
+    // Never uploaded: all of it
+    checkEqual(buffer.isDirty(), true, "NEW_LAYOUT_CLEAN");
+    checkEqual(buffer.getDirtyBegin(), 0, "NEW_LAYOUT_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), buffer.size(), "NEW_LAYOUT_END");
+
+    buffer.clearDirty();
+    checkEqual(buffer.isDirty(), false, "CLEARED_DIRTY");
+    checkEqual(buffer.getDirtyBegin(), 0, "CLEARED_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), 0, "CLEARED_END");
+
+    // Writing the bytes already there does not dirty anything
+    buffer.setFloat(second, 0.0f);
+    buffer.setMat3(last, glm::mat3(0.0f));
+    checkEqual(buffer.isDirty(), false, "SAME_VALUE_DIRTY");
+
+    // One member: exactly its bytes
+    buffer.setFloat(second, 1.0f);
+    checkEqual(buffer.getDirtyBegin(), second, "ONE_MEMBER_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), second + 4, "ONE_MEMBER_END");
+
+    // Two members apart: one range covering both (and whatever lies between)
+    buffer.setVec3(third, glm::vec3(1.0f));
+    checkEqual(buffer.getDirtyBegin(), second, "MERGED_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), third + 12, "MERGED_END");
+    buffer.setVec4(first, glm::vec4(2.0f));
+    checkEqual(buffer.getDirtyBegin(), first, "MERGED_BEFORE_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), third + 12, "MERGED_BEFORE_END");
+
+    // A mat3 where only the last column changed: from that column only
+    buffer.clearDirty();
+    glm::mat3 mat(0.0f);
+    mat[2][1] = 3.0f;
+    buffer.setMat3(last, mat);
+    checkEqual(buffer.getDirtyBegin(), last + 32, "MAT3_COLUMN_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), last + 32 + 12, "MAT3_COLUMN_END");
+
+    // Cleared again: the next change starts a fresh range
+    buffer.clearDirty();
+    buffer.setVec4(first, glm::vec4(4.0f));
+    checkEqual(buffer.getDirtyBegin(), first, "AFTER_CLEAR_BEGIN");
+    checkEqual(buffer.getDirtyEnd(), first + 16, "AFTER_CLEAR_END");
+}
+
+int main()
+{
+    checkLayoutRules();
+    checkLightBlock();
+    checkDirtyRange();
+
+    std::cout << (failures == 0 ? "All std140 checks passed" : "std140 checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Offline texture cooker: encodes a JPG/PNG into a block-compressed .ktx2 with its mip chain,
+// and reports the quality (PSNR) and encode throughput of each level. Headless, no OpenGL.
+//
+//   texture_cooker <input> [output.ktx2] [--format bc1|bc3|bc4|bc5|bc7] [--srgb] [--mips box|kaiser] [--no-mips]
+//   texture_cooker <input> --report      every format and mip filter on the image, nothing written
+//
+// --srgb marks the colors as sRGB-encoded: the mips are filtered in linear space, and the file says so.
+// Built from learn_opengl/ with the encoders and containers of the app, e.g.
+//   g++ -std=c++17 -O2 -mavx tools/texture_cooker.cpp src/BlockCompression.cpp src/CompressedImage.cpp src/MappedFile.cpp src/MipGenerator.cpp src/stb_image.cpp -o texture_cooker -pthread
+
+#include "../header/BlockCompression.h"
+#include "../header/CompressedImage.h"
+#include "../header/MappedFile.h"
+#include "../header/MipGenerator.h"
+#include "../header/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct EncodeResult
+{
+    double psnr;
+    double megapixelsPerSecond;
+};
+
+// Encodes the level into "blocks" (repeated for at least "minSeconds", to time it), then decodes it for the PSNR
+static EncodeResult encodeLevel(Block_Format format, const std::vector<unsigned char>& rgba, int width, int height, double minSeconds, 
+    std::vector<unsigned char>& blocks)
+{
+    blocks.resize(getCompressedSize(format, width, height));
+
+    int runs = 0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        encodeBlocks(format, rgba.data(), width, height, blocks.data());
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+
+    std::vector<unsigned char> decoded((size_t)width * height * 4);
+    decodeBlocks(format, blocks.data(), width, height, decoded.data());
+
+    EncodeResult result;
+    result.psnr = computePSNR(rgba.data(), decoded.data(), (size_t)width * height, getBlockFormatChannels(format));
+    result.megapixelsPerSecond = (double)width * height * runs / seconds / 1e6;
+    return result;
+}
+
+// Builds the chain below the image (repeated for at least "minSeconds", to time it), in source MPix/s
+static double generateMips(const std::vector<unsigned char>& rgba, int width, int height, const MipOptions& options, double minSeconds, 
+    std::vector<MipLevel>& levels)
+{
+    int runs = 0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        levels = generateMipChain(rgba.data(), width, height, options);
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return (double)width * height * runs / seconds / 1e6;
+}
+
+static const char* getMipFilterName(Mip_Filter filter)
+{
+    return filter == Mip_Filter::BOX ? "box" : "Kaiser";
+}
+
+static bool parseFormat(const std::string& name, Block_Format& format)
+{
+    const Block_Format formats[] = { Block_Format::BC1, Block_Format::BC3, Block_Format::BC4, Block_Format::BC5, Block_Format::BC7 };
+    for (Block_Format candidate : formats)
+    {
+        std::string candidateName = getBlockFormatName(candidate);
+        std::transform(candidateName.begin(), candidateName.end(), candidateName.begin(), ::tolower);
+        if (name == candidateName)
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printResult(Block_Format format, int width, int height, const EncodeResult& result)
+{
+    std::cout << std::fixed << std::setprecision(2) << getBlockFormatName(format) << " " << width << "x" << height
+        << "  PSNR " << result.psnr << " dB  " << result.megapixelsPerSecond << " MPix/s  "
+        << getCompressedSize(format, width, height) / 1024 << " KiB" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string input, output;
+    bool formatGiven = false, sRGB = false, mips = true, report = false;
+    Block_Format format = Block_Format::BC1;
+    MipOptions mipOptions;
+    mipOptions.filter = Mip_Filter::KAISER;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc)
+        {
+            if (!parseFormat(argv[++i], format))
+            {
+                std::cout << "ERROR::TEXTURE_COOKER::UNKNOWN_FORMAT " << argv[i] << std::endl;
+                return 1;
+            }
+            formatGiven = true;
+        }
+        else if (argument == "--srgb")
+            sRGB = true;
+        else if (argument == "--mips" && i + 1 < argc)
+        {
+            std::string filter = argv[++i];
+            if (filter != "box" && filter != "kaiser")
+            {
+                std::cout << "ERROR::TEXTURE_COOKER::UNKNOWN_MIP_FILTER " << filter << std::endl;
+                return 1;
+            }
+            mipOptions.filter = filter == "box" ? Mip_Filter::BOX : Mip_Filter::KAISER;
+        }
+        else if (argument == "--no-mips")
+            mips = false;
+        else if (argument == "--report")
+            report = true;
+        else if (input.empty())
+            input = argument;
+        else
+            output = argument;
+    }
+    if (input.empty())
+    {
+        std::cout << "usage: texture_cooker <input> [output.ktx2] [--format bc1|bc3|bc4|bc5|bc7] [--srgb] [--mips box|kaiser] [--no-mips] [--report]" << std::endl;
+        return 1;
+    }
+
+    // Always decoded to RGBA, the encoders take 4 channels
+    int width, height, components;
+    unsigned char* pixels = loadImageMapped(input, &width, &height, &components, 4);
+    if (pixels == nullptr)
+    {
+        std::cout << "ERROR::TEXTURE_COOKER::FILE_NOT_READ " << input << std::endl;
+        return 1;
+    }
+    std::vector<unsigned char> rgba(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+
+    mipOptions.sRGB = sRGB;
+
+    std::vector<unsigned char> blocks;
+    std::vector<MipLevel> mipLevels;
+    if (report)
+    {
+        const Block_Format formats[] = { Block_Format::BC1, Block_Format::BC3, Block_Format::BC4, Block_Format::BC5, Block_Format::BC7 };
+        for (Block_Format candidate : formats)
+            printResult(candidate, width, height, encodeLevel(candidate, rgba, width, height, 0.5, blocks));
+
+        const Mip_Filter filters[] = { Mip_Filter::BOX, Mip_Filter::KAISER };
+        for (Mip_Filter filter : filters)
+        {
+            mipOptions.filter = filter;
+            std::cout << "mips " << getMipFilterName(filter) << (sRGB ? " (sRGB)" : "") << "  " 
+                << generateMips(rgba, width, height, mipOptions, 0.5, mipLevels) << " MPix/s" << std::endl;
+        }
+        return 0;
+    }
+
+    // By default: BC4 for grey images, BC7 when there is alpha, BC1 otherwise
+    if (!formatGiven)
+        format = components == 1 ? Block_Format::BC4 : (components == 3 ? Block_Format::BC1 : Block_Format::BC7);
+    if (output.empty())
+        output = input.substr(0, input.find_last_of('.')) + ".ktx2";
+
+    if (mips)
+    {
+        double megapixelsPerSecond = generateMips(rgba, width, height, mipOptions, 0.0, mipLevels);
+        std::cout << std::fixed << std::setprecision(2) << mipLevels.size() << " mips (" << getMipFilterName(mipOptions.filter) 
+            << (sRGB ? ", sRGB" : "") << ")  " << megapixelsPerSecond << " MPix/s" << std::endl;
+    }
+
+    CompressedImage image;
+    image.format = format;
+    image.sRGB = sRGB;
+    image.width = width;
+    image.height = height;
+    for (size_t i = 0; i <= mipLevels.size(); i++)
+    {
+        const std::vector<unsigned char>& pixels = i == 0 ? rgba : mipLevels[i - 1].rgba;
+        int levelWidth = i == 0 ? width : mipLevels[i - 1].width;
+        int levelHeight = i == 0 ? height : mipLevels[i - 1].height;
+
+        // only the full-size level is timed
+        EncodeResult result = encodeLevel(format, pixels, levelWidth, levelHeight, i == 0 ? 0.1 : 0.0, blocks);
+        printResult(format, levelWidth, levelHeight, result);
+
+        CompressedLevel level = { levelWidth, levelHeight, image.data.size(), blocks.size() };
+        image.levels.push_back(level);
+        image.data.insert(image.data.end(), blocks.begin(), blocks.end());
+    }
+
+    if (!saveKTX2(output, image))
+        return 1;
+    std::cout << output << ": " << image.levels.size() << " levels, " << image.data.size() / 1024 << " KiB" << std::endl;
+    return 0;
+}
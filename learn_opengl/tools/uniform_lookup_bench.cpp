@@ -0,0 +1,305 @@
+// Uniform lookup benchmark: replays the uniforms the render loop of main.cpp set on the lighting
+// program before the light block existed (57 setters a frame: the spot, directional and 4 point
+// lights, material, view, projection and 11 model matrices) through each way of finding a location,
+// and counts the lookups of one frame. Needs an OpenGL 3.3 context: opens a hidden window.
+//
+//   uniform_lookup_bench          exits with 1 if a count or a location is wrong
+//
+//   glGetUniformLocation   the original Shader setters: the driver looks every name up
+//   by name                Shader's string setters: one hash lookup in the location cache
+//   handle                 Shader's handle setters: an index into the cached locations
+//
+// Every path issues the same glUniform* calls, so the difference is the cost of the lookups.
+// Built from learn_opengl/ with the include paths and libraries of the app (glm, glad, glfw), e.g.
+//   g++ -std=c++17 -O2 tools/uniform_lookup_bench.cpp src/Shader.cpp src/ShaderPreprocessor.cpp
+//       src/ShaderCompileWorker.cpp src/ShaderFileWatcher.cpp src/GLExtensions.cpp src/GLState.cpp src/glad.c -lglfw
+//       -o uniform_lookup_bench
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../header/GLExtensions.h"
+#include "../header/Shader.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const double MIN_SECONDS = 0.5;
+
+// Every uniform of the old frame, declared and used so that none is optimized out
+const char* VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
+)";
+
+const char* FRAGMENT_SOURCE = R"(#version 330 core
+out vec4 FragColor;
+struct Material { sampler2D diffuse; sampler2D specular; float shininess; };
+struct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };
+struct PointLight { vec3 position; float constant; float linear; float quadratic; vec3 ambient; vec3 diffuse; vec3 specular; };
+struct SpotLight { vec3 position; vec3 direction; float cutOff; float outerCutOff; float constant; float linear; float quadratic;
+    vec3 ambient; vec3 diffuse; vec3 specular; };
+uniform vec3 viewPos;
+uniform Material material;
+uniform DirLight dirLight;
+uniform PointLight pointLights[4];
+uniform SpotLight light;
+void main()
+{
+    vec3 sum = viewPos + dirLight.direction + dirLight.ambient + dirLight.diffuse + dirLight.specular;
+    for (int i = 0; i < 4; i++)
+        sum += pointLights[i].position * (pointLights[i].constant + pointLights[i].linear + pointLights[i].quadratic)
+            + pointLights[i].ambient + pointLights[i].diffuse + pointLights[i].specular;
+    sum += light.position + light.direction * (light.cutOff + light.outerCutOff + light.constant + light.linear + light.quadratic)
+        + light.ambient + light.diffuse + light.specular;
+    FragColor = vec4(sum * material.shininess, 1.0) + texture(material.diffuse, vec2(0.0)) + texture(material.specular, vec2(0.0));
+}
+)";
+
+// One setter call of the frame: a float, a vec3 or a mat4
+struct FrameUniform
+{
+    std::string name;
+    int components;
+    float value[16];
+};
+
+static void addUniform(std::vector<FrameUniform>& frame, const std::string& name, int components)
+{
+    FrameUniform uniform;
+    uniform.name = name;
+    uniform.components = components;
+    // Distinct values, so that a uniform written through the wrong location shows on read back
+    for (int i = 0; i < 16; i++)
+        uniform.value[i] = (float)frame.size() + i * 0.01f;
+    frame.push_back(uniform);
+}
+
+// The setters of one frame of the old main.cpp, in its order
+static std::vector<FrameUniform> buildFrame()
+{
+    std::vector<FrameUniform> frame;
+    addUniform(frame, "light.position", 3);
+    addUniform(frame, "light.direction", 3);
+    addUniform(frame, "light.cutOff", 1);
+    addUniform(frame, "light.outerCutOff", 1);
+    addUniform(frame, "viewPos", 3);
+    addUniform(frame, "light.ambient", 3);
+    addUniform(frame, "light.diffuse", 3);
+    addUniform(frame, "light.specular", 3);
+    addUniform(frame, "light.constant", 1);
+    addUniform(frame, "light.linear", 1);
+    addUniform(frame, "light.quadratic", 1);
+    addUniform(frame, "material.shininess", 1);
+    addUniform(frame, "dirLight.direction", 3);
+    addUniform(frame, "dirLight.ambient", 3);
+    addUniform(frame, "dirLight.diffuse", 3);
+    addUniform(frame, "dirLight.specular", 3);
+    for (int i = 0; i < 4; i++)
+    {
+        std::string pointLight = "pointLights[" + std::to_string(i) + "].";
+        addUniform(frame, pointLight + "position", 3);
+        addUniform(frame, pointLight + "ambient", 3);
+        addUniform(frame, pointLight + "diffuse", 3);
+        addUniform(frame, pointLight + "specular", 3);
+        addUniform(frame, pointLight + "constant", 1);
+        addUniform(frame, pointLight + "linear", 1);
+        addUniform(frame, pointLight + "quadratic", 1);
+    }
+    addUniform(frame, "projection", 16);
+    addUniform(frame, "view", 16);
+    // One model matrix for the scene, then one per container
+    for (int i = 0; i < 11; i++)
+        addUniform(frame, "model", 16);
+    return frame;
+}
+
+static void upload(GLint location, const FrameUniform& uniform)
+{
+    if (uniform.components == 1)
+        glUniform1f(location, uniform.value[0]);
+    else if (uniform.components == 3)
+        glUniform3fv(location, 1, uniform.value);
+    else
+        glUniformMatrix4fv(location, 1, GL_FALSE, uniform.value);
+}
+
+// Runs "frame" for at least "minSeconds", in microseconds per frame
+static double timeFrames(const std::function<void()>& frame, double minSeconds)
+{
+    int runs = 0;
+    double seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        frame();
+        runs++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < minSeconds);
+    return seconds * 1e6 / runs;
+}
+
+static bool writeFile(const std::string& path, const char* source)
+{
+    std::ofstream file(path);
+    file << source;
+    return (bool)file;
+}
+
+int main()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::UNIFORM_LOOKUP_BENCH::NO_CONTEXT" << std::endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "ERROR::UNIFORM_LOOKUP_BENCH::GLAD" << std::endl;
+        return 1;
+    }
+    GLExt::load((GLADloadproc)glfwGetProcAddress);
+
+    // Shader builds from files
+    std::filesystem::path folder = std::filesystem::temp_directory_path();
+    std::string vertexPath = (folder / "uniform_lookup_bench.vs").string();
+    std::string fragmentPath = (folder / "uniform_lookup_bench.fs").string();
+    if (!writeFile(vertexPath, VERTEX_SOURCE) || !writeFile(fragmentPath, FRAGMENT_SOURCE))
+    {
+        std::cout << "ERROR::UNIFORM_LOOKUP_BENCH::WRITE " << folder.string() << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+        shader.use();
+        std::vector<FrameUniform> frame = buildFrame();
+
+        std::vector<UniformHandle> handles;
+        for (const FrameUniform& uniform : frame)
+            handles.push_back(shader.getUniformHandle(uniform.name));
+
+        // The driver: one glGetUniformLocation per setter
+        const GLuint program = shader.m_ID;
+        unsigned int driverLookups = 0;
+        std::function<void()> driverFrame = [&]()
+        {
+            for (const FrameUniform& uniform : frame)
+            {
+                upload(glGetUniformLocation(program, uniform.name.c_str()), uniform);
+                driverLookups++;
+            }
+        };
+        std::function<void()> nameFrame = [&]()
+        {
+            for (const FrameUniform& uniform : frame)
+            {
+                if (uniform.components == 1)
+                    shader.setFloat(uniform.name, uniform.value[0]);
+                else if (uniform.components == 3)
+                    shader.setVec3(uniform.name, glm::vec3(uniform.value[0], uniform.value[1], uniform.value[2]));
+                else
+                    shader.setMat4(uniform.name, glm::make_mat4(uniform.value));
+            }
+        };
+        std::function<void()> handleFrame = [&]()
+        {
+            for (size_t i = 0; i < frame.size(); i++)
+            {
+                const FrameUniform& uniform = frame[i];
+                if (uniform.components == 1)
+                    shader.setFloat(handles[i], uniform.value[0]);
+                else if (uniform.components == 3)
+                    shader.setVec3(handles[i], glm::vec3(uniform.value[0], uniform.value[1], uniform.value[2]));
+                else
+                    shader.setMat4(handles[i], glm::make_mat4(uniform.value));
+            }
+        };
+
+        // Lookups of one frame
+        driverLookups = 0;
+        driverFrame();
+        unsigned int driverCount = driverLookups;
+        shader.resetUniformLookupCount();
+        nameFrame();
+        unsigned int nameCount = shader.getUniformLookupCount();
+        shader.resetUniformLookupCount();
+        handleFrame();
+        unsigned int handleCount = shader.getUniformLookupCount();
+
+        // The handles write where the driver says the names are
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            const FrameUniform& uniform = frame[i];
+            GLint location = glGetUniformLocation(program, uniform.name.c_str());
+            float value[16] = {};
+            if (location >= 0)
+                glGetUniformfv(program, location, value);
+            // "model" is set 11 times, the last value stays
+            const FrameUniform& last = uniform.name == "model" ? frame.back() : uniform;
+            if (location < 0 || std::memcmp(value, last.value, sizeof(float) * uniform.components) != 0)
+            {
+                std::cout << "ERROR::UNIFORM_LOOKUP_BENCH::WRONG_LOCATION " << uniform.name << std::endl;
+                failures++;
+            }
+        }
+        if (nameCount != frame.size() || handleCount != 0)
+        {
+            std::cout << "ERROR::UNIFORM_LOOKUP_BENCH::LOOKUP_COUNT by name " << nameCount << " (expected " << frame.size()
+                << "), by handle " << handleCount << " (expected 0)" << std::endl;
+            failures++;
+        }
+
+        struct Path
+        {
+            const char* name;
+            unsigned int lookups;
+            const std::function<void()>* frame;
+        };
+        const Path paths[] = {
+            { "glGetUniformLocation", driverCount, &driverFrame },
+            { "by name", nameCount, &nameFrame },
+            { "handle", handleCount, &handleFrame },
+        };
+
+        std::cout << frame.size() << " uniforms set per frame, " << glGetString(GL_RENDERER) << std::endl;
+        std::cout << std::left << std::setw(22) << "path" << std::right << std::setw(16) << "lookups/frame"
+            << std::setw(12) << "us/frame" << std::setw(14) << "ns/uniform" << std::endl;
+        for (const Path& path : paths)
+        {
+            double us = timeFrames(*path.frame, MIN_SECONDS);
+            std::cout << std::left << std::setw(22) << path.name << std::right << std::setw(16) << path.lookups << std::fixed
+                << std::setprecision(2) << std::setw(12) << us << std::setw(14) << std::setprecision(1) << us * 1000.0 / frame.size() << std::endl;
+        }
+    }
+
+    std::filesystem::remove(vertexPath);
+    std::filesystem::remove(fragmentPath);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures == 0 ? 0 : 1;
+}